@@ -0,0 +1,106 @@
+// Formulas parseadas al compilar (ct_expr.hpp) contra las formas de tiempo de ejecucion:
+// Evaluator (arbol), VM (bytecode) y JIT, evaluando la misma formula sobre muchas filas de
+// variables. Las filas se generan una sola vez; cada camino suma sus resultados y la suma
+// tiene que ser la misma bit a bit. Salida en JSON: ns por evaluacion (mejor de --reps pasadas).
+// g++ -std=c++11 -O2 -Iinclude -o ct_bench bench/ct_bench.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/bytecode.cpp src/jit.cpp
+//
+// ./ct_bench                   10^6 filas, 5 pasadas
+// ./ct_bench --rows N --reps N
+#include "ct_expr.hpp"
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+using namespace std;
+
+EDACAL_FORMULA(Small, "x*y + 1");
+EDACAL_FORMULA(Hyp, "sqrt(x^2 + y^2) / (1 + z)");
+EDACAL_FORMULA(Trig, "sin(x)*cos(y) + tan(z/7)");
+EDACAL_FORMULA(Poly, "((x+1)*(x-1) + (y+2)*(y-2))^2 / (z*z+1) + ln(x+z) - log(y+1) + 3*x*y*z - x/y");
+EDACAL_FORMULA(Chain, "a + b*2 - c/4 + d*d - e*0.5 + f*g - h + a*b*c - d/(e+1) + f*f*g - h*0.25");
+
+static size_t rows=1000000;
+static int reps=5;
+
+template<class F> static double best(F f){
+    double b=1e300;
+    for(int r=0;r<reps;++r){
+        chrono::steady_clock::time_point t0=chrono::steady_clock::now();
+        f();
+        b=min(b, chrono::duration<double>(chrono::steady_clock::now()-t0).count());
+    }
+    return b*1e9/(double)rows;
+}
+
+template<class Formula> static void run(const char* name, bool last){
+    const unsigned nv=Formula::variables;
+    mt19937 rng(17);
+    vector<double> vals(rows*nv+1);
+    for(double& v: vals) v=1.0+(double)(rng()%9000)/1000.0;   // [1,10): sin errores de dominio
+
+    Tokenizer tk; ShuntingYard sy; Compiler comp;
+    ExprTree tree;
+    auto inf=tk.tokenize(Formula::source()); auto post=sy.toPostfix(inf); tree.buildFromPostfix(post);
+    Program prog=comp.compile(tree);
+    vector<uint32_t> slots;
+    for(unsigned i=0;i<nv;++i) slots.push_back(Symbols::intern(Formula::variable(i)));
+    VarEnv env; Evaluator ev(&env); VM vm(&env);
+
+    // el JIT recibe las variables en el orden de prog.slots
+    vector<unsigned> perm;
+    for(uint32_t s: prog.slots) perm.push_back((unsigned)(find(slots.begin(), slots.end(), s)-slots.begin()));
+    vector<double> jitVals(rows*perm.size()+1);
+    for(size_t r=0;r<rows;++r) for(size_t k=0;k<perm.size();++k) jitVals[r*perm.size()+k]=vals[r*nv+perm[k]];
+    JitFunction fn;
+    bool jit=JitFunction::supported() && fn.compile(prog);
+
+    double sumCt=0, sumTree=0, sumVm=0, sumJit=0;
+    double nsCt=best([&]{ double s=0; for(size_t r=0;r<rows;++r) s+=Formula::eval(&vals[r*nv]); sumCt=s; });
+    double nsTree=best([&]{
+        double s=0;
+        for(size_t r=0;r<rows;++r){ for(unsigned i=0;i<nv;++i) env.set(slots[i], vals[r*nv+i]); s+=ev.eval(tree); }
+        sumTree=s;
+    });
+    double nsVm=best([&]{
+        double s=0;
+        for(size_t r=0;r<rows;++r){ for(unsigned i=0;i<nv;++i) env.set(slots[i], vals[r*nv+i]); s+=vm.run(prog); }
+        sumVm=s;
+    });
+    double nsJit=0;
+    if(jit) nsJit=best([&]{
+        double s=0; int err=0;
+        for(size_t r=0;r<rows;++r) s+=fn.call(&jitVals[r*perm.size()], &err);
+        sumJit=s;
+    });
+    bool same=memcmp(&sumCt, &sumTree, sizeof sumCt)==0 && memcmp(&sumCt, &sumVm, sizeof sumCt)==0
+           && (!jit || memcmp(&sumCt, &sumJit, sizeof sumCt)==0);
+
+    printf("    {\"name\": \"%s\", \"formula\": \"%s\", \"vars\": %u, \"rows\": %zu,\n", name, Formula::source(), nv, rows);
+    printf("     \"ns_per_eval\": {\"ct\": %.2f, \"eval_tree\": %.2f, \"eval_vm\": %.2f", nsCt, nsTree, nsVm);
+    if(jit) printf(", \"jit\": %.2f", nsJit);
+    printf("},\n     \"speedup_vs_tree\": %.1f, \"speedup_vs_vm\": %.1f, \"same_result\": %s}%s\n",
+           nsTree/nsCt, nsVm/nsCt, same ? "true" : "false", last ? "" : ",");
+}
+
+int main(int argc, char** argv){
+    for(int i=1;i<argc;++i){
+        string a=argv[i];
+        if(a=="--rows" && i+1<argc) rows=(size_t)strtoull(argv[++i], nullptr, 10);
+        else if(a=="--reps" && i+1<argc) reps=max(1, atoi(argv[++i]));
+        else { fprintf(stderr, "uso: ct_bench [--rows N] [--reps N]\n"); return 2; }
+    }
+    printf("{\n  \"formulas\": [\n");
+    run<Small>("small", false);
+    run<Hyp>("hyp", false);
+    run<Trig>("trig", false);
+    run<Poly>("poly", false);
+    run<Chain>("chain", true);
+    printf("  ]\n}\n");
+    return 0;
+}
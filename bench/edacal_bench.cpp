@@ -0,0 +1,367 @@
+// Benchmark de EdaCal: genera corpus de expresiones reproducibles (misma semilla, mismo
+// corpus en cualquier plataforma) y mide cada etapa por separado y la REPL completa.
+// Salida en JSON (ns/op, asignaciones/op, percentiles) para comparar entre commits.
+// g++ -std=c++11 -O2 -pthread -Iinclude -o edacal_bench bench/edacal_bench.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/batch.cpp src/fast_io.cpp src/expr_cache.cpp src/formulas.cpp src/session.cpp src/sweep.cpp src/snapshot.cpp src/stats.cpp src/thread_pool.cpp src/parallel_script.cpp
+//
+// ./edacal_bench                       suite por defecto, JSON a stdout
+// ./edacal_bench --out base.json       JSON a un archivo
+// ./edacal_bench --depth 8 --width 2 --funcs 0.3 --vars 20 --errors 0.1 --ops "+*^"
+//                                      un solo corpus con esos parametros
+// ./edacal_bench --dump script.txt     escribe el corpus como script para la REPL
+// ./edacal_bench --nest 100000          expresiones generadas con 10^5 niveles de anidamiento
+// ./edacal_bench --error-sweep         el mismo corpus con 0%, 1%, 5%, 10%, 25% y 50% de errores
+// --count N (expresiones por corpus), --reps N (pasadas), --seed N, --quick
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "session.hpp"
+#include "stats.hpp"
+#include "alloc_count.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+using namespace std;
+
+// -------------------- Conteo de asignaciones --------------------
+// el operator new de alloc_count.hpp cuenta por hilo todo lo que piden el parser, el arbol, la VM...
+// (con -DEDACAL_NO_STATS no hay conteo y allocs_per_op sale 0)
+static uint64_t allocCount(){ return stats::snapshot().counters[stats::Allocations]; }
+
+// -------------------- Generador de corpus --------------------
+struct Spec {
+    string name;
+    int count{2000};      // expresiones distintas
+    int depth{4};         // anidamiento maximo
+    int width{2};         // operandos por nivel (a op b op c ...)
+    string ops{"+-*/^"};  // mezcla de operadores binarios (repetir uno le da mas peso)
+    double funcs{0.15};   // probabilidad de sqrt/sin/... en cada nivel
+    int vars{8};          // variables v0..v{vars-1} (0 = solo numeros)
+    double errors{0.0};   // fraccion de expresiones con un error a proposito
+    int nest{0};          // >0: cadenas de nest niveles (parentesis, ^, -(...), sqrt(...)) en vez de gen()
+};
+
+// xorshift64*: la secuencia no depende de la biblioteca estandar
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed):s(seed*2654435761u+0x9E3779B97F4A7C15ull){ if(!s) s=1; }
+    uint64_t next(){ s^=s>>12; s^=s<<25; s^=s>>27; return s*2685821657736338717ull; }
+    unsigned below(unsigned n){ return (unsigned)(next()%n); }
+    double unit(){ return (double)(next()>>11)/9007199254740992.0; }
+};
+
+class Generator {
+public:
+    Generator(const Spec& spec, uint64_t seed):sp(spec),rng(seed){}
+    string expr(){
+        string e = sp.nest>0 ? nested() : gen(sp.depth, true);
+        if(rng.unit()<sp.errors) e=inject(e);
+        return e;
+    }
+private:
+    const Spec& sp;
+    Rng rng;
+
+    string leaf(){
+        if(sp.vars>0 && rng.below(2)) return "v"+to_string(rng.below((unsigned)sp.vars));
+        if(rng.below(3)) return to_string(1+rng.below(99));
+        return to_string(rng.below(100))+"."+to_string(rng.below(100));
+    }
+    string gen(int d, bool top){
+        if(d<=0 || (!top && rng.below(5)==0)) return leaf();
+        static const char* fns[]={"sqrt","sin","cos","tan","log","ln"};
+        double r=rng.unit();
+        if(r<sp.funcs) return string(fns[rng.below(6)])+"("+gen(d-1, false)+")";
+        if(r<sp.funcs+0.05) return "-"+operand(d-1);
+        string out=operand(d-1);
+        for(int w=1; w<sp.width; ++w){
+            out+=' '; out+=sp.ops[rng.below((unsigned)sp.ops.size())]; out+=' ';
+            out+=operand(d-1);
+        }
+        return out;
+    }
+    // como las que arma otro programa: un solo camino de nest niveles
+    string nested(){
+        string v=leaf(), open, close, out;
+        unsigned shape=rng.below(5);
+        switch(shape){
+            case 0: open="(";     close=")"; break;
+            case 1: open=leaf()+" + ("; close=")"; break;
+            case 2: open="-(";    close=")"; break;
+            case 3: open="sqrt("; close=")"; break;
+            default: open=v+" ^ "; break;             // ^ asocia a derecha: sin parentesis
+        }
+        out.reserve((size_t)sp.nest*(open.size()+close.size())+v.size());
+        for(int i=0;i<sp.nest;++i) out+=open;
+        out+=v;
+        for(int i=0;i<sp.nest;++i) out+=close;
+        return out;
+    }
+    // los compuestos van entre parentesis: la precedencia no cambia la forma generada
+    string operand(int d){
+        string e=gen(d, false);
+        bool simple=true;
+        for(char c: e) if(c==' '){ simple=false; break; }
+        return simple ? e : "("+e+")";
+    }
+    // un error de cada etapa: tokenizer, parentesis, arbol, variable, dominio
+    string inject(const string& e){
+        switch(rng.below(6)){
+            case 0:  return e+" # 2";
+            case 1:  return "("+e;
+            case 2:  return e+" *";
+            case 3:  return e+" + u"+to_string(rng.below(10));
+            case 4:  return "("+e+") / 0";
+            default: return "sqrt(-1) + "+e;
+        }
+    }
+};
+
+static vector<string> makeCorpus(const Spec& sp, uint64_t seed){
+    Generator g(sp, seed);
+    vector<string> out; out.reserve((size_t)sp.count);
+    for(int i=0;i<sp.count;++i) out.push_back(g.expr());
+    return out;
+}
+
+// asignaciones de v0..v{n-1} y despues el corpus: se puede pasar tal cual a edacal
+static vector<string> makeScript(const Spec& sp, const vector<string>& corpus){
+    vector<string> lines;
+    for(int v=0; v<sp.vars; ++v) lines.push_back("v"+to_string(v)+" = "+to_string(v%7+1)+".25");
+    lines.insert(lines.end(), corpus.begin(), corpus.end());
+    return lines;
+}
+
+// -------------------- Medicion --------------------
+typedef chrono::steady_clock Clock;
+static inline long long nsSince(Clock::time_point t0){ return (long long)chrono::duration_cast<chrono::nanoseconds>(Clock::now()-t0).count(); }
+
+struct Result {
+    string stage;
+    size_t ops{0}, errors{0};
+    double nsPerOp{0}, allocsPerOp{0};
+    long long p50{0}, p90{0}, p99{0}, max{0};
+};
+
+// f(i) hace la operacion i y devuelve false si termino en error.
+// Primero reps pasadas sin reloj por operacion (ns/op y asignaciones), despues una
+// pasada midiendo cada operacion (percentiles).
+template<class F>
+static Result measure(const string& stage, size_t n, int reps, F f){
+    Result r; r.stage=stage;
+    if(n==0) return r;
+    for(size_t i=0;i<n;++i) r.errors += f(i) ? 0 : 1;             // calentamiento
+    uint64_t a0=allocCount();
+    Clock::time_point t0=Clock::now();
+    for(int k=0;k<reps;++k) for(size_t i=0;i<n;++i) f(i);
+    long long total=nsSince(t0);
+    r.ops=n*(size_t)reps;
+    r.nsPerOp=(double)total/(double)r.ops;
+    r.allocsPerOp=(double)(allocCount()-a0)/(double)r.ops;
+    vector<long long> lat(n);
+    for(size_t i=0;i<n;++i){ Clock::time_point t=Clock::now(); f(i); lat[i]=nsSince(t); }
+    sort(lat.begin(), lat.end());
+    auto pct=[&](double p){ return lat[min(n-1, (size_t)(p*(double)n))]; };
+    r.p50=pct(0.50); r.p90=pct(0.90); r.p99=pct(0.99); r.max=lat.back();
+    return r;
+}
+
+// streambuf que descarta: mide el formateo sin la escritura a disco
+struct NullBuf : std::streambuf {
+    int overflow(int c){ return c; }
+    std::streamsize xsputn(const char*, std::streamsize n){ return n; }
+};
+
+static volatile double sink;
+
+static vector<Result> runCorpus(const Spec& sp, const vector<string>& corpus, int reps){
+    vector<Result> res;
+    size_t n=corpus.size();
+    VarEnv env;
+    env.set("pi", 3.14159265358979323846); env.set("e", 2.71828182845904523536);
+    for(int v=0; v<sp.vars; ++v) env.set("v"+to_string(v), v%7+1.25);
+
+    // cada etapa recibe la salida de la anterior, ya calculada (solo las que no fallaron)
+    Tokenizer tk; ShuntingYard sy;
+    vector<Token> tokens;
+    res.push_back(measure("tokenize", n, reps, [&](size_t i){
+        try{ tk.tokenize(corpus[i], tokens); return true; } catch(const exception&){ return false; }
+    }));
+
+    vector<vector<Token>> infix;
+    for(const string& s: corpus){ try{ tk.tokenize(s, tokens); infix.push_back(tokens); } catch(const exception&){} }
+    vector<Token> post;
+    res.push_back(measure("postfix", infix.size(), reps, [&](size_t i){
+        try{ sy.toPostfix(infix[i], post); return true; } catch(const exception&){ return false; }
+    }));
+
+    vector<vector<Token>> posts;
+    for(const auto& in: infix){ try{ sy.toPostfix(in, post); posts.push_back(post); } catch(const exception&){} }
+    ExprTree tree;
+    res.push_back(measure("build_tree", posts.size(), reps, [&](size_t i){
+        try{ tree.buildFromPostfix(posts[i]); return true; } catch(const exception&){ return false; }
+    }));
+
+    // las tres etapas anteriores en una pasada, como las usa la REPL (mismas lineas: todo el corpus)
+    Error perr;
+    res.push_back(measure("parse", n, reps, [&](size_t i){ sy.parse(corpus[i], perr); return !perr; }));
+
+    vector<ExprTree> trees;
+    for(const auto& p: posts){ try{ tree.buildFromPostfix(p); trees.push_back(tree); } catch(const exception&){} }
+    Evaluator ev(&env);
+    vector<double> values(trees.size(), 0.0);
+    res.push_back(measure("eval_tree", trees.size(), reps, [&](size_t i){
+        try{ values[i]=ev.eval(trees[i]); return true; } catch(const exception&){ return false; }
+    }));
+
+    NullBuf nb; ostream null(&nb);
+    res.push_back(measure("prefix", trees.size(), reps, [&](size_t i){
+        trees[i].printPrefix(null, trees[i].root); return true;
+    }));
+
+    Compiler comp; VM vm(&env);
+    vector<Program> progs;
+    for(const auto& t: trees) progs.push_back(comp.compile(t));
+    // errores como codigo (lo que usa la REPL) contra la interfaz que lanza; los dos escriben el texto
+    res.push_back(measure("eval_vm", progs.size(), reps, [&](size_t i){
+        Error e; sink=vm.run(progs[i], e);
+        if(e){ e.print(null); return false; }
+        return true;
+    }));
+    res.push_back(measure("eval_vm_throw", progs.size(), reps, [&](size_t i){
+        try{ sink=vm.run(progs[i]); return true; } catch(const exception& ex){ null << ex.what(); return false; }
+    }));
+
+    res.push_back(measure("format", values.size(), reps, [&](size_t i){
+        Session::printValue(null, "ans", values[i]); return true;
+    }));
+
+    // REPL completa (Session::handle): con la cache por defecto y sin cache
+    vector<string> script=makeScript(sp, corpus);
+    for(int cached=1; cached>=0; --cached){
+        Session s(null, null);
+        if(!cached) s.cache.setCapacity(0);
+        res.push_back(measure(cached ? "repl" : "repl_nocache", script.size(), reps, [&](size_t i){
+            s.handle(script[i]); return true;
+        }));
+    }
+    return res;
+}
+
+// -------------------- JSON --------------------
+static string jsonStr(const string& s){
+    string o="\"";
+    for(char c: s){
+        if(c=='"' || c=='\\'){ o+='\\'; o+=c; }
+        else if((unsigned char)c<0x20){ char b[8]; snprintf(b, sizeof b, "\\u%04x", c); o+=b; }
+        else o+=c;
+    }
+    return o+"\"";
+}
+
+static void writeJson(ostream& os, uint64_t seed, int reps, const vector<Spec>& specs,
+                      const vector<vector<string>>& corpora, const vector<vector<Result>>& results){
+    char b[64];
+    os << "{\n  \"version\": 1,\n  \"seed\": " << seed << ",\n  \"reps\": " << reps << ",\n  \"corpora\": [\n";
+    for(size_t c=0;c<specs.size();++c){
+        const Spec& sp=specs[c];
+        size_t chars=0; for(const string& s: corpora[c]) chars+=s.size();
+        snprintf(b, sizeof b, "%.1f", corpora[c].empty() ? 0.0 : (double)chars/(double)corpora[c].size());
+        os << "    {\n      \"name\": " << jsonStr(sp.name) << ",\n"
+           << "      \"params\": {\"count\": " << sp.count << ", \"depth\": " << sp.depth << ", \"width\": " << sp.width
+           << ", \"ops\": " << jsonStr(sp.ops) << ", \"funcs\": " << sp.funcs << ", \"vars\": " << sp.vars
+           << ", \"errors\": " << sp.errors << ", \"nest\": " << sp.nest << "},\n"
+           << "      \"avg_chars\": " << b << ",\n      \"stages\": {\n";
+        for(size_t k=0;k<results[c].size();++k){
+            const Result& r=results[c][k];
+            os << "        " << jsonStr(r.stage) << ": {\"ops\": " << r.ops << ", \"errors\": " << r.errors;
+            snprintf(b, sizeof b, "%.1f", r.nsPerOp);     os << ", \"ns_per_op\": " << b;
+            snprintf(b, sizeof b, "%.3f", r.allocsPerOp); os << ", \"allocs_per_op\": " << b;
+            os << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90 << ", \"p99_ns\": " << r.p99 << ", \"max_ns\": " << r.max << "}"
+               << (k+1<results[c].size() ? ",\n" : "\n");
+        }
+        os << "      }\n    }" << (c+1<specs.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+// -------------------- main --------------------
+static vector<Spec> defaultSuite(int count){
+    vector<Spec> v;
+    Spec s; s.count=count;
+    s.name="mixed";      v.push_back(s);
+    s.name="shallow";    s.depth=2; s.width=3; v.push_back(s);
+    s.name="deep";       s.depth=10; s.width=2; s.funcs=0.3; v.push_back(s);
+    s.name="wide";       s.depth=2; s.width=12; s.funcs=0.05; v.push_back(s);
+    s=Spec(); s.count=count;
+    s.name="arith";      s.ops="++--**/"; s.funcs=0.0; v.push_back(s);
+    s.name="functions";  s.ops="+*"; s.funcs=0.5; v.push_back(s);
+    s=Spec(); s.count=count;
+    s.name="many_vars";  s.vars=64; s.depth=5; v.push_back(s);
+    s.name="errors_20";  s.vars=8; s.depth=4; s.errors=0.2; v.push_back(s);
+    s=Spec(); s.count=max(4, count/100);
+    s.name="nested_10k"; s.nest=10000; v.push_back(s);
+    return v;
+}
+
+int main(int argc, char** argv){
+    uint64_t seed=1; int reps=5, count=2000;
+    string outPath, dumpPath;
+    Spec custom; bool hasCustom=false, sweep=false;
+    for(int i=1;i<argc;++i){
+        string a=argv[i];
+        bool more=i+1<argc;
+        if(a=="--seed" && more) seed=strtoull(argv[++i], nullptr, 10);
+        else if(a=="--reps" && more) reps=max(1, atoi(argv[++i]));
+        else if(a=="--count" && more) count=max(1, atoi(argv[++i]));
+        else if(a=="--quick"){ count=300; reps=2; }
+        else if(a=="--out" && more) outPath=argv[++i];
+        else if(a=="--dump" && more) dumpPath=argv[++i];
+        else if(a=="--depth" && more){ custom.depth=atoi(argv[++i]); hasCustom=true; }
+        else if(a=="--width" && more){ custom.width=max(1, atoi(argv[++i])); hasCustom=true; }
+        else if(a=="--ops" && more){ custom.ops=argv[++i]; hasCustom=true; }
+        else if(a=="--funcs" && more){ custom.funcs=atof(argv[++i]); hasCustom=true; }
+        else if(a=="--vars" && more){ custom.vars=max(0, atoi(argv[++i])); hasCustom=true; }
+        else if(a=="--errors" && more){ custom.errors=atof(argv[++i]); hasCustom=true; }
+        else if(a=="--nest" && more){ custom.nest=max(0, atoi(argv[++i])); hasCustom=true; }
+        else if(a=="--error-sweep") sweep=true;
+        else { fprintf(stderr, "opcion desconocida: %s\n", a.c_str()); return 1; }
+    }
+    if(custom.ops.empty() || custom.ops.find_first_not_of("+-*/^")!=string::npos){ fprintf(stderr, "--ops: solo + - * / ^\n"); return 1; }
+
+    vector<Spec> specs;
+    if(sweep){
+        // con los demas parametros (o los de por defecto) fijos: solo cambia la tasa de errores
+        static const int rates[]={0, 1, 5, 10, 25, 50};
+        for(int r: rates){
+            Spec s=custom; s.count=count; s.errors=r/100.0; s.name="errors_"+to_string(r);
+            specs.push_back(s);
+        }
+    }
+    else if(hasCustom){ custom.name="custom"; custom.count=count; specs.push_back(custom); }
+    else specs=defaultSuite(count);
+
+    vector<vector<string>> corpora;
+    vector<vector<Result>> results;
+    for(size_t c=0;c<specs.size();++c){
+        corpora.push_back(makeCorpus(specs[c], sweep ? seed : seed+c));   // barrido: misma semilla, cambia la tasa
+        if(!dumpPath.empty()) continue;
+        fprintf(stderr, "%s...\n", specs[c].name.c_str());
+        results.push_back(runCorpus(specs[c], corpora.back(), reps));
+    }
+
+    if(!dumpPath.empty()){
+        ofstream f(dumpPath);
+        if(!f){ fprintf(stderr, "no se pudo abrir %s\n", dumpPath.c_str()); return 1; }
+        for(size_t c=0;c<specs.size();++c) for(const string& l: makeScript(specs[c], corpora[c])) f << l << "\n";
+        return 0;
+    }
+    if(outPath.empty()){ writeJson(cout, seed, reps, specs, corpora, results); return 0; }
+    ofstream f(outPath);
+    if(!f){ fprintf(stderr, "no se pudo abrir %s\n", outPath.c_str()); return 1; }
+    writeJson(f, seed, reps, specs, corpora, results);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Generador de carga para edacal --serve: abre muchas conexiones a la vez y en cada una
+// mantiene hasta --window pedidos en vuelo (pipelining). Cada pedido es una linea que
+// responde con una sola linea (asignacion o expresion), asi la latencia es el tiempo entre
+// mandar la linea y recibir su salto de linea. Salida en JSON, como edacal_bench.
+// g++ -std=c++11 -O2 -pthread -o edacal_loadgen bench/edacal_loadgen.cpp
+//
+// ./edacal --serve /tmp/edacal.sock &
+// ./edacal_loadgen --socket /tmp/edacal.sock --conns 64 --requests 20000 --window 32
+// --distinct N: expresiones distintas por conexion (pocas = casi todo sale de la cache)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct Options {
+    string socket;
+    int conns{64}, requests{20000}, window{32}, distinct{200};
+};
+
+struct ConnResult {
+    vector<long long> lat;     // ns por pedido
+    size_t errors{0};          // respuestas "Error: ..."
+    string failure;
+};
+
+static int connectTo(const string& path){
+    int fd=socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un a; memset(&a, 0, sizeof a); a.sun_family=AF_UNIX;
+    if(path.size()>=sizeof a.sun_path){ close(fd); return -1; }
+    memcpy(a.sun_path, path.c_str(), path.size()+1);
+    if(fd<0 || connect(fd, (sockaddr*)&a, sizeof a)!=0){ if(fd>=0) close(fd); return -1; }
+    return fd;
+}
+
+static string request(int conn, int i, int distinct){
+    if(i==0) return "x = "+to_string(conn%97+1)+"\n";
+    int k=i%distinct;
+    return "x*"+to_string(k)+" + ("+to_string(k%7)+" - x)/3 + sqrt(x+"+to_string(k)+")\n";
+}
+
+static void runConn(const Options& o, int conn, ConnResult& r){
+    int fd=connectTo(o.socket);
+    if(fd<0){ r.failure="no se pudo conectar a "+o.socket; return; }
+    r.lat.reserve((size_t)o.requests);
+    deque<Clock::time_point> inflight;
+    string out; char buf[65536];
+    bool lineStart=true;
+    int sent=0, done=0;
+    while(done<o.requests){
+        out.clear();
+        Clock::time_point now=Clock::now();
+        while(sent<o.requests && (int)inflight.size()<o.window){ out+=request(conn, sent++, o.distinct); inflight.push_back(now); }
+        for(size_t off=0; off<out.size(); ){
+            ssize_t k=send(fd, out.data()+off, out.size()-off, MSG_NOSIGNAL);
+            if(k<=0){ r.failure="send fallo"; close(fd); return; }
+            off+=(size_t)k;
+        }
+        ssize_t k=recv(fd, buf, sizeof buf, 0);
+        if(k<=0){ r.failure="el servidor cerro la conexion"; close(fd); return; }
+        Clock::time_point t=Clock::now();
+        for(ssize_t i=0;i<k;++i){
+            if(lineStart && buf[i]=='E') ++r.errors;
+            lineStart = buf[i]=='\n';
+            if(!lineStart) continue;
+            r.lat.push_back(chrono::duration_cast<chrono::nanoseconds>(t-inflight.front()).count());
+            inflight.pop_front(); ++done;
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv){
+    Options o;
+    for(int i=1;i<argc;++i){
+        string a=argv[i];
+        bool more=i+1<argc;
+        if(a=="--socket" && more) o.socket=argv[++i];
+        else if(a=="--conns" && more) o.conns=max(1, atoi(argv[++i]));
+        else if(a=="--requests" && more) o.requests=max(1, atoi(argv[++i]));
+        else if(a=="--window" && more) o.window=max(1, atoi(argv[++i]));
+        else if(a=="--distinct" && more) o.distinct=max(1, atoi(argv[++i]));
+        else { fprintf(stderr, "opcion desconocida: %s\n", a.c_str()); return 1; }
+    }
+    if(o.socket.empty()){ fprintf(stderr, "falta --socket\n"); return 1; }
+
+    vector<ConnResult> res((size_t)o.conns);
+    Clock::time_point t0=Clock::now();
+    vector<thread> threads;
+    for(int c=0;c<o.conns;++c) threads.emplace_back(runConn, std::cref(o), c, std::ref(res[(size_t)c]));
+    for(thread& t: threads) t.join();
+    double secs=chrono::duration<double>(Clock::now()-t0).count();
+
+    vector<long long> lat; size_t errors=0;
+    for(const ConnResult& r: res){
+        if(!r.failure.empty()){ fprintf(stderr, "%s\n", r.failure.c_str()); return 1; }
+        lat.insert(lat.end(), r.lat.begin(), r.lat.end()); errors+=r.errors;
+    }
+    sort(lat.begin(), lat.end());
+    auto pct=[&](double p){ return lat[min(lat.size()-1, (size_t)(p*(double)lat.size()))]; };
+    printf("{\n  \"conns\": %d, \"requests_per_conn\": %d, \"window\": %d, \"distinct\": %d,\n",
+           o.conns, o.requests, o.window, o.distinct);
+    printf("  \"requests\": %zu, \"errors\": %zu, \"seconds\": %.3f, \"requests_per_s\": %.0f,\n",
+           lat.size(), errors, secs, (double)lat.size()/secs);
+    printf("  \"p50_ns\": %lld, \"p90_ns\": %lld, \"p99_ns\": %lld, \"max_ns\": %lld\n}\n",
+           pct(0.50), pct(0.90), pct(0.99), lat.back());
+    return 0;
+}
@@ -1,10 +1,25 @@
 #include "common.hpp"
 #include "token.hpp"
-#include "linked_list.hpp"
-#include "stack.hpp"
 #include "tokenizer.hpp"
 #include "shunting_yard.hpp"
-#include <memory>
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "optimizer.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "batch.hpp"
+#include "session.hpp"
+#include "thread_pool.hpp"
+#include "parallel_script.hpp"
+#include "fast_io.hpp"
+#include "stats.hpp"
+#include "alloc_count.hpp"      // solo en el ejecutable: la biblioteca no cuenta asignaciones
+#include "server.hpp"
+#include "snapshot.hpp"
+#include <csignal>
+#include <fstream>
+#include <cstring>
+#include <iterator>
 #ifdef _WIN32
   #include <io.h>
   #define isatty _isatty
@@ -13,320 +28,192 @@
 using namespace std;
 
 
-// -------------------- Helpers de operadores --------------------
-static inline int precedence(const Token& t){ return t.precedence; }
-static inline bool rightAssoc(const Token& t){ return t.rightAssoc; }
-
-
-// -------------------- Arbol de Expresion --------------------
-struct ExprNode {
-    Token tok; ExprNode* left{nullptr}; ExprNode* right{nullptr};
-    explicit ExprNode(const Token& t):tok(t){}
-};
-
-class ExprTree {
-public:
-    ExprNode* root{nullptr};
-    ~ExprTree(){ clear(root); }
-    void clear(ExprNode* n){ if(!n) return; clear(n->left); clear(n->right); delete n; }
-
-    void buildFromPostfix(LinkedList<Token>& post){
-        Stack<ExprNode*> st;
-        for(auto it=post.begin(); it!=post.end(); ++it){ Token t=*it;
-            if(t.type==TokenType::Number || t.type==TokenType::Identifier){
-                st.push(new ExprNode(t));
-            } else if(t.type==TokenType::Operator){
-                ExprNode* node=new ExprNode(t);
-                if(t.unary){
-                    if(st.empty()) throw runtime_error("Operador unario sin operando");
-                    node->right = st.top(); st.pop();
-                } else {
-                    if(st.size()<2) throw runtime_error("Operador binario con operandos insuficientes");
-                    ExprNode* r=st.top(); st.pop(); ExprNode* l=st.top(); st.pop();
-                    node->left=l; node->right=r;
-                }
-                st.push(node);
-            }
-        }
-        if(st.size()!=1) throw runtime_error("Expresion invalida");
-        root=st.top(); st.pop();
+// -------------------- Modo por columnas --------------------
+// edacal --eval "expr" --columns datos.csv: una linea de salida por fila del CSV
+static int runColumns(const string& expr, const string& path, Session& session){
+    ExprTree tree;
+    ShuntingYard sy; Error e;
+    sy.parse(expr.data(), expr.size(), tree, e);
+    if(e){ cout << "Error: "; e.print(cout); cout << "\n"; return 1; }
+
+    ifstream in(path);
+    if(!in){ cout << "Error: no se pudo abrir " << path << "\n"; return 1; }
+    Table table;
+    try{ table = readCsv(in); }
+    catch(const exception& ex){ cout << "Error: " << ex.what() << "\n"; return 1; }
+
+    // una columna llamada pi o e tapa a la constante: esa no se pliega
+    unordered_map<string,double> constants=session.constants;
+    for(const string& name: table.names) constants.erase(name);
+    Optimizer opt; opt.constants=&constants;
+    Compiler comp; ExprTree optTree;
+    opt.run(tree, optTree);
+    Program prog = comp.compile(optTree);
+    VarEnv& env=session.env;
+
+    BatchEvaluator be(&env);
+    vector<double> out; vector<unsigned char> err;
+    be.run(prog, table, out, err);
+    BlockWriter w(stdout); ostream os(&w);
+    for(size_t r=0;r<table.rows;++r){
+        if(err[r]){ os << "Error: "; be.error(err[r], r).print(os); os << "\n"; }
+        else Session::printValue(os, "ans", out[r]);
     }
+    return 0;
+}
 
-    // recorridos para prefix/posfix y "tree"
-    void printPrefix(ExprNode* n){ if(!n) return; cout << tokenToStr(n->tok) << ' '; printPrefix(n->left); printPrefix(n->right); }
-    void printPostfix(ExprNode* n){ if(!n) return; printPostfix(n->left); printPostfix(n->right); cout << tokenToStr(n->tok) << ' '; }
-    void printTree(ExprNode* n, int depth=0){ if(!n) return; printTree(n->right, depth+1); cout << string(2*depth, ' ') << tokenToStr(n->tok) << "\n"; printTree(n->left, depth+1); }
+// --restore F: la sesion arranca con el snapshot F (save F)
+static bool restoreSession(Session& session, const string& path){
+    if(path.empty()) return true;
+    try{ loadSnapshot(session, path); return true; }
+    catch(const exception& ex){ cout << "Error: " << ex.what() << "\n"; return false; }
+}
 
-    static string tokenToStr(const Token& t){
-        switch(t.type){
-            case TokenType::Number: { ostringstream os; os<<t.value; return os.str(); }
-            case TokenType::Identifier: return t.text;
-            case TokenType::Operator: return t.text;
-            case TokenType::LParen: return "(";
-            case TokenType::RParen: return ")";
-            default: return "?";
-        }
+// -------------------- Modo archivo --------------------
+// edacal --file script.txt: el script se mapea en memoria y cada linea se pasa a la
+// sesion como puntero+largo; la salida se junta en bloques grandes (BlockWriter)
+static int runFile(const string& path, unsigned jobs, bool useJit, unsigned jitThreshold, long cacheSize, const string& restore){
+    MappedFile f;
+    if(!f.open(path)){ cout << "Error: no se pudo abrir " << path << "\n"; return 1; }
+    BlockWriter w(stdout); ostream os(&w);
+    Session session(os, os);
+    session.useJit=useJit; session.setJitThreshold(jitThreshold);
+    if(cacheSize>=0) session.cache.setCapacity((size_t)cacheSize);
+    if(!restoreSession(session, restore)) return 1;
+
+    const char* p=f.data(); const char* end=p+f.size();
+    if(jobs>0){ runScriptParallel(session, p, (size_t)(end-p), jobs); return 0; }
+    while(p<end){
+        const char* nl=(const char*)memchr(p, '\n', (size_t)(end-p));
+        const char* e = nl ? nl : end;
+        if(!session.handle(p, (size_t)(e-p))) break;
+        p = nl ? nl+1 : end;
     }
-};
+    return 0;
+}
 
-// -------------------- Evaluador con entorno de variables --------------------
-struct VarEnv {
-    unordered_map<string,double> vars;
-    bool has(const string& k) const { return vars.find(k)!=vars.end(); }
-    double get(const string& k) const { auto it=vars.find(k); if(it==vars.end()) throw runtime_error("Variable no definida: "+k); return it->second; }
-    void set(const string& k, double v){ vars[k]=v; }
-};
+// -------------------- Barrido --------------------
+// edacal --sweep "sum x^2 for x=0:1e8": la misma linea que "sweep ..." en el REPL, en --jobs
+// hilos (por defecto todos los nucleos) y con la tabla escrita en bloques grandes
+static int runSweepLine(const string& args, unsigned jobs, const string& restore){
+    BlockWriter w(stdout); ostream os(&w);
+    Session session(os, os);
+    session.sweepThreads=jobs;
+    if(!restoreSession(session, restore)) return 1;
+    session.handle("sweep "+args);
+    return 0;
+}
 
-class Evaluator {
-public:
-    explicit Evaluator(VarEnv* env):env(env){}
-    double eval(ExprNode* n){ if(!n) throw runtime_error("Arbol vacio"); return evalNode(n); }
-private:
-    VarEnv* env;
-    double evalNode(ExprNode* n){
-        if(n->tok.type==TokenType::Number) return n->tok.value;
-        if(n->tok.type==TokenType::Identifier){
-            if(env){
-                if(env->has(n->tok.text)) return env->get(n->tok.text);
-                throw runtime_error("Variable no definida: "+n->tok.text);
-            }
-            throw runtime_error("Variable no soportada: "+n->tok.text);
-        }
-        // Operadores
-        if(n->tok.unary){
-            double a = evalNode(n->right);
-            if(n->tok.text=="-") return -a;
-            if(n->tok.text=="+") return +a;
-            if(n->tok.text=="sqrt"){ if(a<0) throw runtime_error("sqrt de negativo"); return sqrt(a);}            
-            if(n->tok.text=="sin") return sin(a);
-            if(n->tok.text=="cos") return cos(a);
-            if(n->tok.text=="tan") return tan(a);
-            if(n->tok.text=="log") { if(a<=0) throw runtime_error("log de no-positivo"); return log10(a); }
-            if(n->tok.text=="ln")  { if(a<=0) throw runtime_error("ln de no-positivo");  return log(a); }
-        } else {
-            double a = evalNode(n->left);
-            double b = evalNode(n->right);
-            if(n->tok.text=="+") return a+b;
-            if(n->tok.text=="-") return a-b;
-            if(n->tok.text=="*") return a*b;
-            if(n->tok.text=="/") { if(b==0) throw runtime_error("division por cero"); return a/b; }
-            if(n->tok.text=="^") return pow(a,b);
-        }
-        throw runtime_error(string("Operador desconocido: ")+n->tok.text);
-    }
-};
+// -------------------- Servidor --------------------
+// edacal --serve /tmp/edacal.sock: una Session por conexion, lineas evaluadas en un pool
+// de --jobs hilos (por defecto todos los nucleos). SIGINT/SIGTERM lo detienen.
+static Server* serving = nullptr;
+static void stopServing(int){ if(serving) serving->stop(); }
+
+static int runServe(const string& path, unsigned jobs, bool useJit, unsigned jitThreshold, long cacheSize, const string& restore){
+    // el snapshot se carga una sola vez (un error se informa al arrancar) y cada conexion copia la sesion
+    ostringstream sink; Session initial(sink, sink);
+    if(!restoreSession(initial, restore)) return 1;
+    Server server(jobs ? jobs : ThreadPool::defaultSize());
+    server.useJit=useJit; server.jitThreshold=jitThreshold; server.cacheSize=cacheSize;
+    if(!restore.empty()) server.initial=&initial;
+    string error;
+    if(!server.listen(path, error)){ cout << "Error: " << error << "\n"; return 1; }
+    serving=&server;
+    std::signal(SIGINT, stopServing); std::signal(SIGTERM, stopServing);
+    cerr << "EdaCal v2.1 - escuchando en " << path << "\n";
+    server.run();
+    serving=nullptr;
+    return 0;
+}
+
+// al salir: cierra la traza y, con --stats, imprime los contadores en stderr
+static int finish(int rc, bool showStats){
+    stats::closeTrace();
+    if(showStats) stats::print(cerr);
+    return rc;
+}
 
 // -------------------- REPL --------------------
 int main(int argc, char** argv){
     ios::sync_with_stdio(false); cin.tie(nullptr);
     bool interactive = isatty(fileno(stdin));
     if (argc>1 && string(argv[1])=="--version") { cout << "EdaCal v2.1" << "\n"; return 0; }
-    if (interactive) cout << "EdaCal v2.1 - escribe una expresion o 'exit'\n";
-
-    string line; Tokenizer tk; ShuntingYard sy; 
-    VarEnv env; env.set("ans", 0.0); env.set("pi", 3.14159265358979323846); env.set("e", 2.71828182845904523536);
-    Evaluator ev(&env);
-
-    // almacenamos la ultima expresion en posfija para prefix/posfix/tree
-    vector<Token> lastPostfix;
-    auto savePostfix = [&](LinkedList<Token>& post){
-        lastPostfix.clear();
-        for(auto it=post.begin(); it!=post.end(); ++it) lastPostfix.push_back(*it);
-    };
-
-    auto rebuildTreeFromLast = [&](){
-        if(lastPostfix.empty()) throw runtime_error("No hay expresion previa");
-        LinkedList<Token> post;
-        for(const auto& t: lastPostfix) post.push_back(t);
-        ExprTree* tree = new ExprTree();
-        tree->buildFromPostfix(post);
-        return tree; // caller borra
-    };
-
-    auto printPosfixFromLast = [&](){
-        if(lastPostfix.empty()) throw runtime_error("No hay expresion previa");
-        for(const auto& t: lastPostfix) cout << ExprTree::tokenToStr(t) << ' ';
-        cout << "\n";
-    };
+    // --jit[=N]: compila a codigo nativo las expresiones evaluadas N veces (por defecto 64)
+    bool useJit=false; unsigned jitThreshold=64;
+    // --eval "expr" --columns datos.csv: evalua expr sobre todas las filas del CSV
+    string evalExpr, columnsPath;
+    // --jobs N: script no interactivo evaluado en N hilos (0 = todos los nucleos)
+    unsigned jobs=0;
+    // --cache N: capacidad de la cache de expresiones compiladas (0 = sin cache)
+    long cacheSize=-1;
+    // --file script.txt: lee el script con mmap y escribe la salida en bloques
+    string filePath;
+    // --stats: contadores y latencias al salir; --trace F: tiempos por linea en formato Chrome trace
+    bool showStats=false; string tracePath;
+    // --serve S: servidor de lineas en el socket Unix S
+    string servePath;
+    // --restore F: arranca con la sesion guardada en F (save F)
+    string restorePath;
+    // --sweep L: ejecuta "sweep L" y termina
+    string sweepArgs;
+    for(int i=1;i<argc;++i){
+        string a=argv[i];
+        if(a=="--jit") useJit=true;
+        else if(a.rfind("--jit=",0)==0){ useJit=true; jitThreshold=(unsigned)std::strtoul(a.c_str()+6, nullptr, 10); }
+        else if(a=="--eval" && i+1<argc) evalExpr=argv[++i];
+        else if(a=="--columns" && i+1<argc) columnsPath=argv[++i];
+        else if(a=="--jobs" && i+1<argc){ jobs=(unsigned)std::strtoul(argv[++i], nullptr, 10); if(!jobs) jobs=ThreadPool::defaultSize(); }
+        else if(a=="--file" && i+1<argc) filePath=argv[++i];
+        else if(a=="--cache" && i+1<argc) cacheSize=std::strtol(argv[++i], nullptr, 10);
+        else if(a=="--stats") showStats=true;
+        else if(a=="--trace" && i+1<argc) tracePath=argv[++i];
+        else if(a=="--serve" && i+1<argc) servePath=argv[++i];
+        else if(a=="--restore" && i+1<argc) restorePath=argv[++i];
+        else if(a=="--sweep" && i+1<argc) sweepArgs=argv[++i];
+    }
+    if(showStats) stats::setTiming(true);
+    if(!tracePath.empty() && !stats::openTrace(tracePath)){ cout << "Error: no se pudo abrir " << tracePath << "\n"; return 1; }
+
+    if(!sweepArgs.empty()) return finish(runSweepLine(sweepArgs, jobs, restorePath), showStats);
+    if(!servePath.empty()) return finish(runServe(servePath, jobs, useJit, jitThreshold, cacheSize, restorePath), showStats);
+    if(!filePath.empty()) return finish(runFile(filePath, jobs, useJit, jitThreshold, cacheSize, restorePath), showStats);
+
+    Session session(cout, interactive ? cerr : cout);
+    session.useJit=useJit; session.setJitThreshold(jitThreshold);
+    if(cacheSize>=0) session.cache.setCapacity((size_t)cacheSize);
+    if(!restoreSession(session, restorePath)) return finish(1, showStats);
+    if(!evalExpr.empty() || !columnsPath.empty()){
+        if(evalExpr.empty() || columnsPath.empty()){ cout << "Error: --eval y --columns van juntos\n"; return finish(1, showStats); }
+        return finish(runColumns(evalExpr, columnsPath, session), showStats);
+    }
 
-    auto findTopLevelEq = [&](const string& s)->int{
-        int bal=0; for(int i=0;i<(int)s.size();++i){ char c=s[i];
-            if(c=='(') ++bal; else if(c==')') --bal; else if(c=='=' && bal==0) return i;
-        } return -1;
-    };
+    string line;
+    if(jobs>0){
+        // --jobs N: se lee el script completo y se evalua con el grafo de dependencias
+        string script((std::istreambuf_iterator<char>(cin)), std::istreambuf_iterator<char>());
+        runScriptParallel(session, script.data(), script.size(), jobs);
+        cout.flush();
+        return finish(0, showStats);
+    }
 
+    if (interactive) cout << "EdaCal v2.1 - escribe una expresion o 'exit'\n";
     while(true){
         if (interactive) cout << ">> ";
         if(!getline(cin, line)) break;
-        line = trim(line);
-        if(line=="exit") break;
-        if(line.empty()) continue;
-
-        // ayuda
-        if(line=="help"){
-            cout << "Comandos disponibles:\n"
-                 << "  help               -> esta ayuda\n"
-                 << "  --version          -> imprime la version y termina\n"
-                 << "  show <var>         -> muestra valor de variable\n"
-                 << "  let x = expr       -> alias de asignacion\n"
-                 << "  vars               -> lista variables definidas\n"
-                 << "  del <var>          -> elimina variable (excepto pi, e, ans)\n"
-                 << "  posfix [expr]      -> imprime notacion posfija (de expr o ultima)\n"
-                 << "  prefix [expr]      -> imprime notacion prefija (de expr o ultima)\n"
-                 << "  tree   [expr]      -> imprime arbol (de expr o ultima)\n"
-                 << "Asignacion: x = expresion\n"
-                 << "Funciones: sqrt, sin, cos, tan, log(base10), ln\n"
-                 << "Constantes: pi, e (radianes)\n";
-            continue;
-        }
-
-        // comandos que usan la ultima expresion (ahora con argumento opcional)
-        auto hasArg = [&](const string& cmd)->bool {
-            return line.size() > cmd.size() && line.substr(0, cmd.size()) == cmd && !trim(line.substr(cmd.size())).empty();
-        };
-        auto argOf = [&](size_t k)->string { return trim(line.substr(k)); };
-
-        // posfix
-        if(line=="posfix" || line.rfind("posfix",0)==0){
-            try{
-                if(hasArg("posfix")){
-                    string expr = argOf(6); // despues de "posfix"
-                    auto infix = tk.tokenize(expr);
-                    auto postfix = sy.toPostfix(infix);
-                    for(auto it=postfix.begin(); it!=postfix.end(); ++it) cout << ExprTree::tokenToStr(*it) << ' ';
-                    cout << "\n";
-                }else{
-                    printPosfixFromLast();
-                }
-            } catch(const exception& ex){
-                if(interactive) cerr << "Error: " << ex.what() << "\n";
-                else cout << "Error: " << ex.what() << "\n";
-            }
-            continue;
-        }
-
-        // prefix
-        if(line=="prefix" || line.rfind("prefix",0)==0){
-            try{
-                unique_ptr<ExprTree> t;
-                if(hasArg("prefix")){
-                    string expr = argOf(6); // despues de "prefix"
-                    auto infix = tk.tokenize(expr);
-                    auto postfix = sy.toPostfix(infix);
-                    t.reset(new ExprTree());
-                    t->buildFromPostfix(postfix);
-                }else{
-                    t.reset(rebuildTreeFromLast());
-                }
-                t->printPrefix(t->root); cout << "\n";
-            } catch(const exception& ex){
-                if(interactive) cerr << "Error: " << ex.what() << "\n";
-                else cout << "Error: " << ex.what() << "\n";
-            }
-            continue;
-        }
-
-        // tree
-        if(line=="tree" || line.rfind("tree",0)==0){
-            try{
-                unique_ptr<ExprTree> t;
-                if(hasArg("tree")){
-                    string expr = argOf(4); // despues de "tree"
-                    auto infix = tk.tokenize(expr);
-                    auto postfix = sy.toPostfix(infix);
-                    t.reset(new ExprTree());
-                    t->buildFromPostfix(postfix);
-                }else{
-                    t.reset(rebuildTreeFromLast());
-                }
-                t->printTree(t->root);
-            } catch(const exception& ex){
-                if(interactive) cerr << "Error: " << ex.what() << "\n";
-                else cout << "Error: " << ex.what() << "\n";
-            }
-            continue;
-        }
-
-        // vars: lista todas las variables ordenadas alfabeticamente 
-        if (line == "vars") {
-            std::vector<std::pair<std::string,double>> kv(env.vars.begin(), env.vars.end());
-            std::sort(kv.begin(), kv.end(),
-                [](const std::pair<std::string,double>& a, const std::pair<std::string,double>& b){
-                    return a.first < b.first;
-                }
-            );
-            for (const auto& p : kv) {
-                cout << p.first << " -> " << std::fixed << std::setprecision(10) << p.second << "\n";
-            }
-            continue;
-        }
-
-
-        // del <var>: elimina una variable (protegemos pi, e, ans)
-        if (line.rfind("del ", 0) == 0) {
-            string var = trim(line.substr(4));
-            if (var.empty()) { cout << "Error: nombre vacio\n"; continue; }
-            if (var == "pi" || var == "e" || var == "ans") {
-                cout << "Error: variable protegida\n"; 
-                continue;
-            }
-            auto it = env.vars.find(var);
-            if (it == env.vars.end()) {
-                cout << "Error: variable no existe\n";
-            } else {
-                env.vars.erase(it);
-                cout << "ok\n";
-            }
-            continue;
-        }
-
-        // show <var>
-        if(line.size()>5 && line.substr(0,5)=="show "){
-            string var = trim(line.substr(5));
-            try{ double v = env.get(var); cout << var << " -> " << fixed << setprecision(10) << v << "\n"; }
-            catch(const exception& ex){ if(interactive) cerr<<"Error: "<<ex.what() << "\n"; else cout<<"Error: "<<ex.what() << "\n"; }
-            continue;
-        }
-
-        // alias: let x = expr  (reescribimos la linea y dejamos que siga el flujo normal)
-        if (line.rfind("let ", 0) == 0) {
-            line = trim(line.substr(4));
-        }
-        int posEq = findTopLevelEq(line);
-        if(posEq>0){
-            string lhs = trim(line.substr(0,posEq));
-            string rhs = trim(line.substr(posEq+1));
-            if(lhs.empty() || !isAlphaC(lhs[0])){ if(interactive) cerr<<"Error: LHS invalido" << "\n"; else cout<<"Error: LHS invalido\n"; continue; }
-            try{
-                auto infix = tk.tokenize(rhs);
-                auto postfix = sy.toPostfix(infix);
-                savePostfix(postfix);
-                ExprTree tree; tree.buildFromPostfix(postfix);
-                double res = ev.eval(tree.root);
-                env.set(lhs, res);
-                env.set("ans", res);
-                cout << lhs << " -> " << fixed << setprecision(10) << res << "\n";
-            } catch(const exception& ex){ if(interactive) cerr<<"Error: "<<ex.what() << "\n"; else cout<<"Error: "<<ex.what() << "\n"; }
-            continue;
-        }
-
-        // evaluacion normal
-        try{
-            auto infix = tk.tokenize(line);
-            auto postfix = sy.toPostfix(infix);
-            savePostfix(postfix);
-            ExprTree tree; tree.buildFromPostfix(postfix);
-            double res = ev.eval(tree.root);
-            env.set("ans", res);
-            cout << "ans -> " << fixed << setprecision(10) << res << "\n";
-        } catch(const exception& ex){ if (interactive) cerr << "Error: " << ex.what() << "\n"; else cout << "Error: " << ex.what() << "\n"; }
+        if(!session.handle(line)) break;
     }
-    return 0;
+    cout.flush();
+    return finish(0, showStats);
 }
 
 // ================================
 // Notas de diseno
-// - Cumple con: lista enlazada propia, pila propia, shunting yard (cap. 5), arbol de expresion.
+// - Cumple con: SmallVector propio (include/small_vector.hpp: buffer interno y heap al crecer)
+//   como pila de operadores del shunting yard (cap. 5), de la construccion del arbol y de
+//   los recorridos del optimizador y el compilador; arbol de expresion en un pool de nodos
+//   contiguos en post-orden, con los hijos como indices de 32 bits en vez de punteros
+//   (include/expr_tree.hpp).
 // - Tests sugeridos:
 //   1) 6+5 -> 11
 //   2) 5+3*5+2 -> 22
@@ -0,0 +1,39 @@
+#ifndef ALLOC_COUNT_HPP
+#define ALLOC_COUNT_HPP
+
+#include "stats.hpp"
+#include <cstdlib>
+#include <new>
+
+// -------------------- Conteo de asignaciones (stats: "asignaciones") --------------------
+// Reemplaza el operator new global del programa: se incluye en UN solo .cpp de un
+// ejecutable (edacal.cpp, el bench), nunca desde src/, asi la biblioteca no le cambia
+// el allocator a quien la embebe. Cada asignacion se cuenta en el bloque del hilo.
+#ifndef EDACAL_NO_STATS
+void* operator new(size_t n){
+    if(!n) n=1;
+    void* p;
+    // como el operator new estandar: sin memoria se llama al new_handler hasta que alcance
+    while(!(p=std::malloc(n))){
+        std::new_handler h=std::get_new_handler();
+        if(!h) throw std::bad_alloc();
+        h();
+    }
+    stats::Block* b=stats::current();
+    if(!b){
+        // el primer new del hilo crea su bloque; lo que pida esa creacion no se cuenta
+        static thread_local bool creating=false;
+        if(creating) return p;
+        creating=true; b=&stats::local(); creating=false;
+    }
+    stats::bump(b->counters[stats::Allocations], 1);
+    return p;
+}
+// sin inline: GCC veria el free() contra la memoria de operator new y avisaria mismatched-new-delete
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+#endif
+
+#endif // ALLOC_COUNT_HPP
@@ -0,0 +1,40 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "common.hpp"
+#include "bytecode.hpp"
+#include "evaluator.hpp"
+
+// -------------------- Evaluacion por columnas --------------------
+// Una tabla CSV (encabezado con nombres + filas numericas) guardada por columnas.
+struct Table {
+    std::vector<string> names;
+    std::vector<std::vector<double>> cols;
+    size_t rows{0};
+    int find(const string& name) const;
+};
+
+Table readCsv(std::istream& in);
+
+// Ejecuta un Program sobre todas las filas de una vez: cada instruccion procesa
+// un bloque de filas con kernels SIMD. Los errores se guardan por fila y no cortan el lote.
+class BatchEvaluator {
+public:
+    enum Isa { Scalar, SSE2, AVX2 };
+    explicit BatchEvaluator(VarEnv* env, Isa isa=best()):env(env),isa(isa){}
+    // err[fila]: un ErrCode (0 = sin error); error() lo completa para imprimirlo sin armar strings
+    void run(const Program& p, const Table& t, std::vector<double>& out, std::vector<unsigned char>& err);
+    ::Error error(unsigned char err, size_t row) const { ::Error e; e.set((ErrCode)err, (uint32_t)row, undefSlot); return e; }
+    string message(unsigned char err) const { return error(err, 0).message(); }
+
+    static Isa best();
+    static bool supported(Isa isa);
+    static const char* isaName(Isa isa);
+private:
+    VarEnv* env;
+    Isa isa;
+    uint32_t undefSlot{0};      // primera variable no definida del programa
+    std::vector<double> stack;  // maxStack bloques de kChunk filas (menos si el programa es muy profundo)
+};
+
+#endif // BATCH_HPP
@@ -0,0 +1,49 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include "common.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "ops.hpp"
+
+// -------------------- Bytecode --------------------
+// El arbol se baja a un arreglo plano de instrucciones para una maquina de pila.
+// Las constantes van dentro de la instruccion y las variables como indice en slots.
+// Usa los mismos OpCode del arbol (ops.hpp).
+struct Instr {
+    OpCode op; int arg; double num;          // arg: indice en slots (Var) o temporal (Save/Load), num: valor (Const)
+};
+
+struct Program {
+    std::vector<Instr> code;
+    std::vector<uint32_t> slots;             // slot en VarEnv de cada identificador referenciado
+    int maxStack{0};
+    int temps{0};                            // temporales de Save/Load (nodos compartidos del DAG)
+    bool empty() const { return code.empty(); }
+};
+
+// Acepta arboles o DAGs (ver Optimizer): un nodo usado mas de una vez se calcula
+// la primera vez, se guarda con Save y las siguientes se recupera con Load.
+class Compiler {
+public:
+    Program compile(const ExprTree& t);
+private:
+    struct Frame { uint32_t node; int state; };
+    SmallVector<Frame, 64> work;             // recorrido iterativo: sin recursion por profundidad
+    std::vector<unsigned> uses;
+    std::vector<int> slot;
+};
+
+// Interprete: un unico switch sobre el arreglo de instrucciones
+class VM {
+public:
+    explicit VM(VarEnv* env):env(env){}
+    // sin excepciones: con error devuelve 0 y e dice que paso y en que instruccion
+    double run(const Program& p, Error& e);
+    double run(const Program& p){ Error e; double r=run(p, e); if(e) e.raise(); return r; }
+private:
+    VarEnv* env;
+    std::vector<double> stack, temps;
+};
+
+#endif // BYTECODE_HPP
@@ -11,11 +11,14 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 #ifdef _WIN32
   #include <io.h>
   #define isatty _isatty
   #define fileno _fileno
+#else
+  #include <unistd.h>
 #endif
 
 using std::string;
@@ -25,6 +28,12 @@ static inline bool isDigitC(char c){ return c>='0' && c<='9'; }
 static inline bool isAlphaC(char c){ return (c>='a'&&c<='z')||(c>='A'&&c<='Z')||c=='_'; }
 static inline string ltrim(string s){ size_t i=0; while(i<s.size() && isSpace(s[i])) ++i; return s.substr(i); }
 static inline string rtrim(string s){ int i=(int)s.size()-1; while(i>=0 && isSpace(s[i])) --i; return s.substr(0,i+1); }
-static inline string trim (string s){ return rtrim(ltrim(s)); }
+// una sola copia (antes eran dos substr)
+static inline string trim(const string& s){
+    size_t b=0, e=s.size();
+    while(b<e && isSpace(s[b])) ++b;
+    while(e>b && isSpace(s[e-1])) --e;
+    return s.substr(b, e-b);
+}
 
 #endif // COMMON_HPP
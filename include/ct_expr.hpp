@@ -0,0 +1,302 @@
+#ifndef CT_EXPR_HPP
+#define CT_EXPR_HPP
+
+#include "ops.hpp"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// -------------------- Formulas fijas parseadas al compilar (solo header) --------------------
+// EDACAL_FORMULA(Nombre, "texto") parsea el texto con constexpr + plantillas y deja un tipo
+// cuyo eval() es codigo en linea, sin arbol ni bytecode en tiempo de ejecucion:
+//
+//   EDACAL_FORMULA(Hyp, "sqrt(x^2 + y^2)");
+//   double r = Hyp::call(3.0, 4.0);          // valores en orden de primera aparicion: x, y
+//   double v[] = {3, 4}; r = Hyp::eval(v);   // lo mismo, desde un arreglo
+//
+// Misma gramatica que Tokenizer + ShuntingYard: numeros con a lo sumo un punto (sin
+// exponente), + y - unarios, sqrt/sin/cos/tan/log/ln como operadores prefijos (con o sin
+// parentesis), unarios y funciones antes que ^, ^ asociativo a la derecha, * / antes que + -.
+// Un texto mal formado no compila: static_assert con el mismo mensaje que el REPL
+// ("Parentesis desbalanceados", "Caracter no reconocido", "Expresion invalida").
+// Los numeros se leen con el camino exacto de parseDecimal; los que necesitarian strtod
+// (mas de 19 cifras o exponente > 22) tambien se rechazan al compilar.
+// Los errores de evaluacion (division por cero, sqrt de negativo, log/ln de no-positivo)
+// lanzan runtime_error con el texto de la VM, en el mismo orden de evaluacion.
+// Compilar en modo C++11 alcanza; formulas de hasta unos 200 tokens (profundidad constexpr).
+
+#if defined(__GNUC__)
+  #define EDACAL_CT_INLINE inline __attribute__((always_inline))
+  #define EDACAL_CT_COLD __attribute__((noinline, cold))
+#else
+  #define EDACAL_CT_INLINE inline
+  #define EDACAL_CT_COLD
+#endif
+
+// Solo el texto (un literal no puede ser argumento de plantilla en C++11): sirve para
+// consultar Syntax<Name>::error sin romper la compilacion.
+#define EDACAL_FORMULA_TEXT(Name, text) \
+    struct Name { \
+        static constexpr const char* str(){ return text; } \
+        static constexpr unsigned size(){ return sizeof(text)-1; } \
+    }
+
+// El sizeof instancia Formula ahi mismo: un texto mal formado falla en la declaracion
+#define EDACAL_FORMULA(Name, text) \
+    EDACAL_FORMULA_TEXT(Name##_text, text); \
+    typedef ::edacal::ct::Formula<Name##_text> Name; \
+    static_assert(sizeof(Name)>0, "EdaCal: formula")
+
+namespace edacal {
+namespace ct {
+
+enum Error { Ok = 0, BadChar, Unbalanced, Invalid, BadNumber, InexactNumber };
+
+namespace detail {
+
+// ---- lexico: mismas reglas que Tokenizer ----
+enum Kind { End, Number, Ident, Func, LParen, RParen, Plus, Minus, Star, Slash, Caret, Bad };
+
+constexpr bool space(char c){ return c==' ' || c=='\t' || c=='\n' || c=='\r'; }
+constexpr bool digit(char c){ return c>='0' && c<='9'; }
+constexpr bool alpha(char c){ return (c>='a' && c<='z') || (c>='A' && c<='Z') || c=='_'; }
+
+constexpr unsigned skip(const char* s, unsigned n, unsigned p){ return p<n && space(s[p]) ? skip(s, n, p+1) : p; }
+constexpr unsigned identEnd(const char* s, unsigned n, unsigned p){ return p<n && (alpha(s[p]) || digit(s[p])) ? identEnd(s, n, p+1) : p; }
+constexpr unsigned numEnd(const char* s, unsigned n, unsigned p, bool dot){
+    return p<n && (digit(s[p]) || (!dot && s[p]=='.')) ? numEnd(s, n, p+1, dot || s[p]=='.') : p;
+}
+constexpr bool word(const char* s, unsigned p, unsigned len, const char* w){
+    return len==0 ? *w=='\0' : (*w!='\0' && s[p]==*w && word(s, p+1, len-1, w+1));
+}
+// OpCode::Const: no es funcion
+constexpr OpCode funcOp(const char* s, unsigned p, unsigned len){
+    return word(s, p, len, "sqrt") ? OpCode::Sqrt : word(s, p, len, "sin") ? OpCode::Sin
+         : word(s, p, len, "cos") ? OpCode::Cos : word(s, p, len, "tan") ? OpCode::Tan
+         : word(s, p, len, "log") ? OpCode::Log : word(s, p, len, "ln") ? OpCode::Ln : OpCode::Const;
+}
+
+constexpr Kind kindAt(const char* s, unsigned n, unsigned p){
+    return p>=n ? End
+         : digit(s[p]) || s[p]=='.' ? Number
+         : alpha(s[p]) ? (funcOp(s, p, identEnd(s, n, p)-p)!=OpCode::Const ? Func : Ident)
+         : s[p]=='(' ? LParen : s[p]==')' ? RParen
+         : s[p]=='+' ? Plus : s[p]=='-' ? Minus : s[p]=='*' ? Star : s[p]=='/' ? Slash : s[p]=='^' ? Caret
+         : Bad;
+}
+constexpr unsigned tokEnd(const char* s, unsigned n, unsigned p){
+    return p>=n ? p
+         : kindAt(s, n, p)==Number ? numEnd(s, n, p+1, s[p]=='.')
+         : alpha(s[p]) ? identEnd(s, n, p+1) : p+1;
+}
+constexpr unsigned next(const char* s, unsigned n, unsigned p){ return skip(s, n, tokEnd(s, n, p)); }
+
+constexpr int binPrec(Kind k){ return k==Plus || k==Minus ? 1 : k==Star || k==Slash ? 2 : k==Caret ? 3 : -1; }
+constexpr OpCode binOp(Kind k){
+    return k==Plus ? OpCode::Add : k==Minus ? OpCode::Sub : k==Star ? OpCode::Mul : k==Slash ? OpCode::Div : OpCode::Pow;
+}
+
+// ---- numeros: el mismo algoritmo que parseDecimal (camino rapido de Clinger) ----
+struct Dec {
+    uint64_t m; int digits, exp10; bool any, afterDot, exact;
+    constexpr Dec(uint64_t m=0, int digits=0, int exp10=0, bool any=false, bool afterDot=false, bool exact=true)
+        :m(m),digits(digits),exp10(exp10),any(any),afterDot(afterDot),exact(exact){}
+};
+constexpr Dec digitStep(Dec d, unsigned c){
+    return d.digits<19
+        ? Dec((d.m || c) ? d.m*10+c : d.m, (d.m || c) ? d.digits+1 : d.digits, d.afterDot ? d.exp10-1 : d.exp10, true, d.afterDot, d.exact)
+        : Dec(d.m, d.digits, d.afterDot ? d.exp10 : d.exp10+1, true, d.afterDot, d.exact && c==0);
+}
+constexpr Dec scan(const char* s, unsigned i, unsigned e, Dec d){
+    return i>=e ? d
+         : s[i]=='.' ? scan(s, i+1, e, Dec(d.m, d.digits, d.exp10, d.any, true, d.exact))
+         : scan(s, i+1, e, digitStep(d, (unsigned)(s[i]-'0')));
+}
+constexpr double pow10(int k){ return k==0 ? 1.0 : 10.0*pow10(k-1); }   // exacto hasta 1e22
+constexpr bool fast(Dec d){ return d.exact && d.m<=(1ull<<53) && d.exp10>=-22 && d.exp10<=22; }
+constexpr double decValue(Dec d){ return !fast(d) ? 0.0 : d.exp10<0 ? (double)d.m/pow10(-d.exp10) : (double)d.m*pow10(d.exp10); }
+constexpr int numberError(Dec d){ return !d.any ? BadNumber : !fast(d) ? InexactNumber : Ok; }
+
+// primer error lexico (como Tokenizer, antes que cualquier error de sintaxis)
+constexpr int lexError(const char* s, unsigned n, unsigned p){
+    return p>=n ? Ok
+         : kindAt(s, n, p)==Bad ? BadChar
+         : kindAt(s, n, p)==Number && numberError(scan(s, p, tokEnd(s, n, p), Dec()))!=Ok ? numberError(scan(s, p, tokEnd(s, n, p), Dec()))
+         : lexError(s, n, next(s, n, p));
+}
+// parentesis balanceados (como ShuntingYard, antes que el arbol)
+constexpr bool balanced(const char* s, unsigned n, unsigned p, int depth){
+    return p>=n ? depth==0
+         : s[p]==')' ? depth>0 && balanced(s, n, p+1, depth-1)
+         : balanced(s, n, p+1, s[p]=='(' ? depth+1 : depth);
+}
+
+// ---- variables: indice = orden de primera aparicion en el texto ----
+constexpr bool sameRange(const char* s, unsigned a, unsigned b, unsigned len){ return len==0 || (s[a]==s[b] && sameRange(s, a+1, b+1, len-1)); }
+constexpr bool sameIdent(const char* s, unsigned n, unsigned a, unsigned b){
+    return identEnd(s, n, a)-a==identEnd(s, n, b)-b && sameRange(s, a, b, identEnd(s, n, a)-a);
+}
+// posicion del primer uso del identificador que esta en p (recorriendo tokens desde q)
+constexpr unsigned firstUse(const char* s, unsigned n, unsigned q, unsigned p){
+    return q>=p ? p : kindAt(s, n, q)==Ident && sameIdent(s, n, q, p) ? q : firstUse(s, n, next(s, n, q), p);
+}
+constexpr bool isFirst(const char* s, unsigned n, unsigned q){ return kindAt(s, n, q)==Ident && firstUse(s, n, skip(s, n, 0), q)==q; }
+// nombres distintos que aparecen por primera vez antes de p
+constexpr unsigned distinctBefore(const char* s, unsigned n, unsigned q, unsigned p){
+    return q>=p || q>=n ? 0 : (isFirst(s, n, q) ? 1 : 0) + distinctBefore(s, n, next(s, n, q), p);
+}
+constexpr unsigned varIndex(const char* s, unsigned n, unsigned p){ return distinctBefore(s, n, skip(s, n, 0), firstUse(s, n, skip(s, n, 0), p)); }
+constexpr unsigned nthVar(const char* s, unsigned n, unsigned q, unsigned i){
+    return q>=n ? n : isFirst(s, n, q) ? (i==0 ? q : nthVar(s, n, next(s, n, q), i-1)) : nthVar(s, n, next(s, n, q), i);
+}
+
+EDACAL_CT_COLD inline void fail(const char* what){ throw std::runtime_error(what); }
+
+// ---- nodos: eval() de cada uno queda en linea dentro del de su padre ----
+template<class S, unsigned B, unsigned E> struct Num {
+    static constexpr double value = decValue(scan(S::str(), B, E, Dec()));
+    static EDACAL_CT_INLINE double eval(const double*){ return value; }
+};
+template<unsigned I> struct Var {
+    static EDACAL_CT_INLINE double eval(const double* v){ return v[I]; }
+};
+struct Missing {
+    static EDACAL_CT_INLINE double eval(const double*){ return 0.0; }
+};
+
+template<OpCode Op> struct Fn;
+template<> struct Fn<OpCode::Neg>  { static EDACAL_CT_INLINE double apply(double a){ return -a; } };
+template<> struct Fn<OpCode::Pos>  { static EDACAL_CT_INLINE double apply(double a){ return a; } };
+template<> struct Fn<OpCode::Sqrt> { static EDACAL_CT_INLINE double apply(double a){ if(a<0) fail("sqrt de negativo"); return std::sqrt(a); } };
+template<> struct Fn<OpCode::Sin>  { static EDACAL_CT_INLINE double apply(double a){ return std::sin(a); } };
+template<> struct Fn<OpCode::Cos>  { static EDACAL_CT_INLINE double apply(double a){ return std::cos(a); } };
+template<> struct Fn<OpCode::Tan>  { static EDACAL_CT_INLINE double apply(double a){ return std::tan(a); } };
+template<> struct Fn<OpCode::Log>  { static EDACAL_CT_INLINE double apply(double a){ if(a<=0) fail("log de no-positivo"); return std::log10(a); } };
+template<> struct Fn<OpCode::Ln>   { static EDACAL_CT_INLINE double apply(double a){ if(a<=0) fail("ln de no-positivo"); return std::log(a); } };
+template<> struct Fn<OpCode::Add>  { static EDACAL_CT_INLINE double apply(double a, double b){ return a+b; } };
+template<> struct Fn<OpCode::Sub>  { static EDACAL_CT_INLINE double apply(double a, double b){ return a-b; } };
+template<> struct Fn<OpCode::Mul>  { static EDACAL_CT_INLINE double apply(double a, double b){ return a*b; } };
+template<> struct Fn<OpCode::Div>  { static EDACAL_CT_INLINE double apply(double a, double b){ if(b==0) fail("division por cero"); return a/b; } };
+template<> struct Fn<OpCode::Pow>  { static EDACAL_CT_INLINE double apply(double a, double b){ return std::pow(a, b); } };
+
+template<OpCode Op, class A> struct Unary {
+    static EDACAL_CT_INLINE double eval(const double* v){ return Fn<Op>::apply(A::eval(v)); }
+};
+// izquierdo antes que derecho: el primer error es el mismo que en la VM
+template<OpCode Op, class A, class B> struct Binary {
+    static EDACAL_CT_INLINE double eval(const double* v){ double a=A::eval(v); double b=B::eval(v); return Fn<Op>::apply(a, b); }
+};
+
+// ---- parser por precedencia: cada paso deja type, end (posicion siguiente) y error ----
+template<class S, unsigned P> constexpr Kind kind(){ return kindAt(S::str(), S::size(), P); }
+template<class S, unsigned P> constexpr unsigned after(){ return next(S::str(), S::size(), P); }
+
+template<class S, unsigned P, int Min> struct ParseExpr;
+
+// operando: numero, variable o (expr); cualquier otra cosa es una expresion invalida
+template<class S, unsigned P, Kind K> struct ParsePrimary {
+    typedef Missing type;
+    static constexpr unsigned end = P;
+    static constexpr int error = K==Bad ? BadChar : Invalid;
+};
+template<class S, unsigned P> struct ParsePrimary<S, P, Number> {
+    typedef Num<S, P, tokEnd(S::str(), S::size(), P)> type;
+    static constexpr unsigned end = after<S, P>();
+    static constexpr int error = numberError(scan(S::str(), P, tokEnd(S::str(), S::size(), P), Dec()));
+};
+template<class S, unsigned P> struct ParsePrimary<S, P, Ident> {
+    typedef Var<varIndex(S::str(), S::size(), P)> type;
+    static constexpr unsigned end = after<S, P>();
+    static constexpr int error = Ok;
+};
+template<class S, unsigned P> struct ParsePrimary<S, P, LParen> {
+    typedef ParseExpr<S, after<S, P>(), 1> E;
+    static constexpr bool closed = kind<S, E::end>()==RParen;
+    typedef typename E::type type;
+    static constexpr unsigned end = closed ? after<S, E::end>() : E::end;
+    static constexpr int error = E::error ? E::error : closed ? Ok : kind<S, E::end>()==End ? Unbalanced : Invalid;
+};
+
+// + - unarios y funciones: prefijos que se aplican al operando (antes que ^, como en ShuntingYard)
+template<class S, unsigned P, Kind K = kind<S, P>()> struct ParseUnary : ParsePrimary<S, P, K> {};
+template<class S, unsigned P, OpCode Op> struct ParsePrefix {
+    typedef ParseUnary<S, after<S, P>()> A;
+    typedef Unary<Op, typename A::type> type;
+    static constexpr unsigned end = A::end;
+    static constexpr int error = A::error;
+};
+template<class S, unsigned P> struct ParseUnary<S, P, Plus> : ParsePrefix<S, P, OpCode::Pos> {};
+template<class S, unsigned P> struct ParseUnary<S, P, Minus> : ParsePrefix<S, P, OpCode::Neg> {};
+template<class S, unsigned P> struct ParseUnary<S, P, Func>
+    : ParsePrefix<S, P, funcOp(S::str(), P, identEnd(S::str(), S::size(), P)-P)> {};
+
+// lhs (op rhs)* con precedencia >= Min; ^ es asociativo a la derecha
+template<class S, class L, unsigned P, int Min, int Err, bool Go = (Err==Ok && binPrec(kind<S, P>())>=Min)>
+struct ParseRest {
+    typedef L type;
+    static constexpr unsigned end = P;
+    static constexpr int error = Err;
+};
+template<class S, class L, unsigned P, int Min>
+struct ParseRest<S, L, P, Min, Ok, true> {
+    static constexpr Kind op = kind<S, P>();
+    typedef ParseExpr<S, after<S, P>(), op==Caret ? binPrec(op) : binPrec(op)+1> R;
+    typedef ParseRest<S, Binary<binOp(op), L, typename R::type>, R::end, Min, R::error> Next;
+    typedef typename Next::type type;
+    static constexpr unsigned end = Next::end;
+    static constexpr int error = Next::error;
+};
+
+template<class S, unsigned P, int Min> struct ParseExpr {
+    typedef ParseUnary<S, P> L;
+    typedef ParseRest<S, typename L::type, L::end, Min, L::error> R;
+    typedef typename R::type type;
+    static constexpr unsigned end = R::end;
+    static constexpr int error = R::error;
+};
+
+} // namespace detail
+
+// Resultado del parser sin static_assert: error() dice por que un texto no compilaria
+template<class S> struct Syntax {
+    static constexpr unsigned start = detail::skip(S::str(), S::size(), 0);
+    typedef detail::ParseExpr<S, start, 1> E;
+    typedef typename E::type type;
+    static constexpr int lexical = detail::lexError(S::str(), S::size(), start);
+    static constexpr int syntax = E::error ? E::error
+                                : detail::kind<S, E::end>()==detail::End ? Ok
+                                : detail::kind<S, E::end>()==detail::RParen ? Unbalanced : Invalid;
+    static constexpr int error = lexical ? lexical : !detail::balanced(S::str(), S::size(), 0, 0) ? Unbalanced : syntax;
+};
+
+template<class S> class Formula {
+    typedef Syntax<S> Parsed;
+    static_assert(Parsed::error!=BadChar, "EdaCal: Caracter no reconocido");
+    static_assert(Parsed::error!=Unbalanced, "EdaCal: Parentesis desbalanceados");
+    static_assert(Parsed::error!=Invalid, "EdaCal: Expresion invalida");
+    static_assert(Parsed::error!=BadNumber, "EdaCal: numero invalido");
+    static_assert(Parsed::error!=InexactNumber, "EdaCal: numero con mas de 19 cifras o exponente mayor a 22 (usar el parser en tiempo de ejecucion)");
+public:
+    typedef typename Parsed::type Tree;
+    static constexpr unsigned variables = detail::distinctBefore(S::str(), S::size(), Parsed::start, S::size());
+
+    static const char* source(){ return S::str(); }
+    // nombre de la variable i (orden de primera aparicion)
+    static std::string variable(unsigned i){
+        unsigned p=detail::nthVar(S::str(), S::size(), Parsed::start, i);
+        return std::string(S::str()+p, detail::identEnd(S::str(), S::size(), p)-p);
+    }
+
+    static EDACAL_CT_INLINE double eval(const double* vars){ return Tree::eval(vars); }
+    template<class... A> static EDACAL_CT_INLINE double call(A... values){
+        static_assert(sizeof...(A)==variables, "EdaCal: la formula recibe un valor por variable");
+        const double v[sizeof...(A)+1]={(double)values..., 0.0};
+        return Tree::eval(v);
+    }
+};
+
+} // namespace ct
+} // namespace edacal
+
+#endif // CT_EXPR_HPP
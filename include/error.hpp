@@ -0,0 +1,84 @@
+#ifndef ERROR_HPP
+#define ERROR_HPP
+
+#include "common.hpp"
+#include "ops.hpp"
+#include "symbols.hpp"
+
+// -------------------- Errores sin excepciones --------------------
+// Tokenizer::next, ShuntingYard::parse, ExprTree, Evaluator, VM y Jit devuelven los errores
+// como un codigo con la posicion donde ocurrieron (y el dato que falta para el texto: el
+// caracter o el slot de la variable). El texto se arma recien al imprimirlo, igual que el
+// what() de antes: una linea con error no desenrolla la pila ni concatena strings.
+enum class ErrCode : unsigned char {
+    None,
+    BadChar,          // Caracter no reconocido: c
+    BadNumber,        // stod (numero sin digitos: ".")
+    NumberRange,      // stod (fuera del rango de double)
+    Unbalanced,       // Parentesis desbalanceados
+    UnaryMissing,     // Operador unario sin operando
+    BinaryMissing,    // Operador binario con operandos insuficientes
+    Invalid,          // Expresion invalida
+    EmptyTree,        // Arbol vacio
+    Undefined,        // Variable no definida: x
+    Unsupported,      // Variable no soportada: x (evaluador sin entorno)
+    SqrtNeg, LogNonPos, LnNonPos, DivZero,
+    BadOp,            // Operador desconocido: op
+    NoPrevious        // No hay expresion previa (posfix/prefix/tree sin argumento)
+};
+
+struct Error {
+    static const uint32_t kNoPos = 0xFFFFFFFFu;
+    ErrCode code{ErrCode::None};
+    uint32_t pos{kNoPos};   // parse: byte de la linea; Evaluator: nodo del pool; VM: instruccion
+    uint32_t arg{0};        // BadChar: el caracter; Undefined/Unsupported: slot; BadOp: OpCode
+
+    explicit operator bool() const { return code!=ErrCode::None; }
+    void set(ErrCode c, uint32_t p, uint32_t a=0){ code=c; pos=p; arg=a; }
+    void clear(){ code=ErrCode::None; pos=kNoPos; arg=0; }
+    // error de lectura (caracter, numero o parentesis): la linea no llega a tener posfija
+    bool lexical() const { return code>=ErrCode::BadChar && code<=ErrCode::Unbalanced; }
+    // error al armar el arbol: la posfija queda y cuenta como ultima expresion
+    bool syntax() const { return code>=ErrCode::UnaryMissing && code<=ErrCode::Invalid; }
+
+    void print(std::ostream& os) const {
+        os << text(code);
+        switch(code){
+            case ErrCode::BadChar: os << (char)arg; break;
+            case ErrCode::Undefined: case ErrCode::Unsupported: os << Symbols::name(arg); break;
+            case ErrCode::BadOp: os << opText((OpCode)arg); break;
+            default: break;
+        }
+    }
+    string message() const { std::ostringstream os; print(os); return os.str(); }
+    // para las interfaces que lanzan: el mismo tipo de excepcion y el mismo texto que antes
+    [[noreturn]] void raise() const {
+        if(code==ErrCode::BadNumber) throw std::invalid_argument("stod");
+        if(code==ErrCode::NumberRange) throw std::out_of_range("stod");
+        throw std::runtime_error(message());
+    }
+
+    static const char* text(ErrCode c){
+        switch(c){
+            case ErrCode::BadChar:       return "Caracter no reconocido: ";
+            case ErrCode::BadNumber:     return "stod";
+            case ErrCode::NumberRange:   return "stod";
+            case ErrCode::Unbalanced:    return "Parentesis desbalanceados";
+            case ErrCode::UnaryMissing:  return "Operador unario sin operando";
+            case ErrCode::BinaryMissing: return "Operador binario con operandos insuficientes";
+            case ErrCode::Invalid:       return "Expresion invalida";
+            case ErrCode::EmptyTree:     return "Arbol vacio";
+            case ErrCode::Undefined:     return "Variable no definida: ";
+            case ErrCode::Unsupported:   return "Variable no soportada: ";
+            case ErrCode::SqrtNeg:       return "sqrt de negativo";
+            case ErrCode::LogNonPos:     return "log de no-positivo";
+            case ErrCode::LnNonPos:      return "ln de no-positivo";
+            case ErrCode::DivZero:       return "division por cero";
+            case ErrCode::BadOp:         return "Operador desconocido: ";
+            case ErrCode::NoPrevious:    return "No hay expresion previa";
+            default:                     return "";
+        }
+    }
+};
+
+#endif // ERROR_HPP
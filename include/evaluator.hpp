@@ -0,0 +1,80 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "common.hpp"
+#include "expr_tree.hpp"
+#include "symbols.hpp"
+#include "error.hpp"
+
+// -------------------- Entorno de variables --------------------
+// Cada nombre tiene un slot fijo (su id en Symbols): los valores van en un arreglo plano
+// indexado por slot y un bit por slot indica si la variable esta definida. Arbol y
+// bytecode guardan slots, asi leer una variable no hashea el nombre.
+// Es a proposito que el slot sea el id global y no un indice propio del entorno: un mismo
+// Program sirve para cualquier VarEnv sin traducir. El costo es que cada entorno (sesion,
+// conexion de --serve, hilo de sweep, Bindings) ocupa ~8.1 bytes por id hasta el mayor slot
+// que escribe, aunque tenga pocas variables: con 10^6 nombres internados en el proceso, un
+// nombre nuevo en una sesion vacia reserva ~8 MB. Por eso --serve limita cuantos nombres
+// nuevos interna cada conexion y cuantos todas juntas.
+class VarEnv {
+public:
+    bool has(uint32_t slot) const { return slot<vals.size() && ((bits[slot>>6]>>(slot&63))&1u); }
+    double value(uint32_t slot) const { return vals[slot]; }          // solo si has(slot)
+    double get(uint32_t slot) const { if(!has(slot)) throw std::runtime_error("Variable no definida: "+Symbols::name(slot)); return vals[slot]; }
+    void set(uint32_t slot, double v){
+        if(slot>=vals.size()) grow(slot);
+        uint64_t& w=bits[slot>>6]; uint64_t m=(uint64_t)1<<(slot&63);
+        if(!(w&m)){ w|=m; ++count; }
+        vals[slot]=v;
+    }
+    bool erase(uint32_t slot){
+        if(!has(slot)) return false;
+        bits[slot>>6]&=~((uint64_t)1<<(slot&63)); --count;
+        return true;
+    }
+
+    // por nombre (comandos del REPL): un nombre que nunca se vio no se interna
+    bool has(const string& k) const { return has(Symbols::find(k)); }
+    double get(const string& k) const { uint32_t s=Symbols::find(k); if(!has(s)) throw std::runtime_error("Variable no definida: "+k); return vals[s]; }
+    void set(const string& k, double v){ set(Symbols::intern(k), v); }
+    bool erase(const string& k){ return erase(Symbols::find(k)); }
+
+    size_t size() const { return count; }
+    void clear(){ std::fill(bits.begin(), bits.end(), 0); count=0; }
+    // f(slot, valor) por cada variable definida, en orden de slot
+    template<class F> void forEach(F f) const {
+        for(size_t w=0; w<bits.size(); ++w)
+            for(uint64_t b=bits[w]; b; b&=b-1){ uint32_t s=(uint32_t)(w*64+ctz(b)); f(s, vals[s]); }
+    }
+private:
+    std::vector<double> vals;
+    std::vector<uint64_t> bits;
+    size_t count{0};
+    void grow(uint32_t slot){
+        size_t n=std::max<size_t>((size_t)slot+1, 2*vals.size());
+        vals.resize(n, 0.0); bits.resize((n+63)/64, 0);
+    }
+    static unsigned ctz(uint64_t b){
+#if defined(__GNUC__)
+        return (unsigned)__builtin_ctzll(b);
+#else
+        unsigned n=0; while(!(b&1u)){ b>>=1; ++n; } return n;
+#endif
+    }
+};
+
+// Evaluador de referencia sobre el arbol: como el pool esta en post-orden, cada
+// nodo se calcula una vez recorriendo el arreglo, en el mismo orden que el recorrido recursivo.
+class Evaluator {
+public:
+    explicit Evaluator(VarEnv* env):env(env){}
+    // sin excepciones: con error devuelve 0 y e dice que paso y en que nodo del pool
+    double eval(const ExprTree& t, Error& e);
+    double eval(const ExprTree& t){ Error e; double r=eval(t, e); if(e) e.raise(); return r; }
+private:
+    VarEnv* env;
+    std::vector<double> vals; // valor de cada nodo, indexado igual que el pool
+    ErrCode evalNode(const ExprTree& t, const ExprNode& n, double& r);
+};
+
+#endif // EVALUATOR_HPP
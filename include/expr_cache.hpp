@@ -0,0 +1,62 @@
+#ifndef EXPR_CACHE_HPP
+#define EXPR_CACHE_HPP
+
+#include "common.hpp"
+#include "token.hpp"
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "optimizer.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include <list>
+#include <memory>
+
+// Forma compilada de una expresion: con un hit solo queda evaluar.
+// Si la posfija salio bien pero el arbol no ("1 2"), se guarda el error (codigo y
+// posicion, sin texto): la posfija igual cuenta como "ultima expresion", como sin cache.
+struct CompiledExpr {
+    ExprTree tree;                 // tal como se escribio: posfix (tree.nodes en orden), prefix y tree
+    ExprTree optTree;              // salida del Optimizer (tree opt); prog sale de aca
+    Program prog;
+    Error buildError;              // error del arbol (Error::syntax()); vacio si compilo
+    JitSlot jit;
+};
+
+typedef std::shared_ptr<CompiledExpr> CompiledPtr;
+
+// ShuntingYard::parse + optimizador + bytecode, sin excepciones. Un error lexico o de
+// parentesis devuelve nullptr con e cargado; los errores del arbol van a buildError.
+CompiledPtr compileExpr(const string& expr, ShuntingYard& sy, Optimizer& opt, Compiler& comp, Error& e);
+
+// Cache LRU acotada: texto de la expresion sin espacios redundantes -> forma compilada.
+// Los programas guardan slots de variables, no valores: asignar o hacer del no
+// invalida nada, el valor (o el "Variable no definida") se resuelve al evaluar.
+// La excepcion son las constantes plegadas por el Optimizer (pi, e): la Session
+// vacia la cache cuando una de ellas se reasigna.
+class ExprCache {
+public:
+    explicit ExprCache(size_t capacity=1024):cap(capacity){}
+
+    CompiledPtr find(const string& key);           // nullptr si no esta; cuenta hit/miss
+    bool contains(const string& key) const { return index.count(key)!=0; }  // sin contar ni reordenar
+    void insert(const string& key, const CompiledPtr& c);
+    void clear(){ order.clear(); index.clear(); }
+    void setCapacity(size_t n);
+
+    size_t size() const { return index.size(); }
+    size_t capacity() const { return cap; }
+    size_t hits{0}, misses{0}, evictions{0};
+
+    // quita espacios salvo los que separan dos caracteres de palabra ("1 2", "sin x")
+    static string normalize(const string& expr){ string out; normalize(expr, out); return out; }
+    static void normalize(const string& expr, string& out);   // reutiliza la capacidad de out
+private:
+    typedef std::list<std::pair<string,CompiledPtr>> Order;
+    size_t cap;
+    Order order;                                     // frente = uso mas reciente
+    std::unordered_map<string,Order::iterator> index;
+    void trimTo(size_t n);
+};
+
+#endif // EXPR_CACHE_HPP
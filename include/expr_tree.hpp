@@ -0,0 +1,59 @@
+#ifndef EXPR_TREE_HPP
+#define EXPR_TREE_HPP
+
+#include "common.hpp"
+#include "token.hpp"
+#include "ops.hpp"
+#include "error.hpp"
+#include "small_vector.hpp"
+
+// Nodo compacto (24 bytes): hijos como indices de 32 bits dentro del pool del arbol.
+// Los unarios usan solo right, igual que antes.
+struct ExprNode {
+    double num;                  // Const
+    uint32_t left, right;
+    uint32_t name;               // Var: indice en ExprTree::slots
+    OpCode op;
+};
+
+// Los nodos quedan contiguos en post-orden (hijos antes que el padre, raiz al final):
+// evaluar o imprimir la posfija es recorrer el arreglo de izquierda a derecha.
+// reset() vacia el arbol sin devolver memoria, asi cada linea reutiliza el mismo pool.
+// Si la posfija no arma un arbol ("1 2", "2 +"), nodes igual la guarda entera (los
+// operadores que no encontraron operandos quedan sin hijos) y root queda en kNone:
+// posfix la sigue imprimiendo, prefix y tree informan el error.
+class ExprTree {
+public:
+    static const uint32_t kNone = 0xFFFFFFFFu;
+    std::vector<ExprNode> nodes;
+    std::vector<uint32_t> slots;   // Var: slot (id en Symbols) de cada nombre distinto
+    uint32_t root{kNone};
+
+    void reset(){ nodes.clear(); slots.clear(); root=kNone; }
+    bool empty() const { return root==kNone; }
+    const ExprNode& at(uint32_t i) const { return nodes[i]; }
+
+    void buildFromPostfix(const std::vector<Token>& post);   // lanza el error del arbol
+
+    // construccion incremental (ShuntingYard::parse): start, push por cada token de la
+    // posfija en orden (pos: donde estaba en el texto) y finish, que da false y el error si
+    // no salio un arbol (end: posicion que se informa para "Expresion invalida"). No lanza.
+    void start(){ reset(); work.clear(); pending.clear(); }
+    void push(const Token& t, uint32_t pos);
+    bool finish(Error& e, uint32_t end);
+
+    // recorridos para prefix/posfix y "tree"
+    void printPrefix(std::ostream& os, uint32_t n) const;
+    void printPostfix(std::ostream& os) const;
+    void printTree(std::ostream& os, uint32_t n, int depth=0) const;
+
+    string nodeToStr(const ExprNode& n) const;
+    static string numToStr(double v);
+    static string tokenToStr(const Token& t);
+private:
+    SmallVector<uint32_t, 16> work; // pila de indices durante la construccion
+    Error pending;                  // primer error del arbol; los tokens siguientes solo se guardan
+    uint32_t nameIndex(uint32_t sym);
+};
+
+#endif // EXPR_TREE_HPP
@@ -0,0 +1,53 @@
+#ifndef FAST_IO_HPP
+#define FAST_IO_HPP
+
+#include "common.hpp"
+#include <cstdio>
+#include <streambuf>
+
+// -------------------- E/S rapida (--file) --------------------
+
+// Archivo de solo lectura mapeado en memoria (mmap / MapViewOfFile); las lineas
+// se recorren directo sobre el mapeo, sin copiarlas.
+class MappedFile {
+public:
+    MappedFile(){}
+    ~MappedFile(){ close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path);
+    void close();
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+private:
+    const char* ptr{nullptr};
+    size_t len{0};
+#ifdef _WIN32
+    void* file{nullptr}; void* mapping{nullptr};
+#endif
+};
+
+// Igual que os << std::fixed << std::setprecision(10) << v, byte a byte (incluidos
+// "-0.0000000000", "inf", "-nan"). El caso comun sale exacto con aritmetica de 128 bits;
+// numeros enormes y no finitos van por snprintf. out necesita kFixed10Max bytes.
+static const size_t kFixed10Max = 330;
+size_t formatFixed10(double v, char* out);
+
+// streambuf con un bloque grande: la salida se escribe con fwrite de a kBlock bytes
+class BlockWriter : public std::streambuf {
+public:
+    explicit BlockWriter(FILE* f, size_t block = kBlock);
+    ~BlockWriter(){ sync(); }
+    static const size_t kBlock = 1<<20;
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+private:
+    FILE* f;
+    std::vector<char> buf;
+    void flushBlock();
+};
+
+#endif // FAST_IO_HPP
@@ -0,0 +1,61 @@
+#ifndef FORMULAS_HPP
+#define FORMULAS_HPP
+
+#include "common.hpp"
+#include "expr_cache.hpp"
+#include "symbols.hpp"
+#include <functional>
+
+// -------------------- Formulas vivas (def y = expr) --------------------
+// Grafo de dependencias entre variables, indexado por slot (id en Symbols). Cada variable
+// mencionada tiene un nodo; las que son formula guardan su forma compilada y sus entradas. Cuando cambian variables,
+// propagate() recorre solo lo que esta aguas abajo, en orden topologico, y corta la
+// propagacion en las formulas cuyo valor no cambio.
+class FormulaGraph {
+public:
+    struct Formula {
+        string source;                   // texto del RHS (para defs y para recompilar)
+        CompiledPtr ce;
+    };
+    // recalcula una formula y devuelve true si su valor (o definido/no definido) cambio
+    typedef std::function<bool(uint32_t slot, Formula& f)> Recompute;
+
+    bool empty() const { return count==0; }
+    bool isFormula(uint32_t slot) const;
+    Formula* find(uint32_t slot);
+    const Formula* find(uint32_t slot) const;
+    // variable que es formula o que alguna formula lee: escribirla dispara recalculos
+    bool reactive(uint32_t slot) const;
+
+    // false si define crearia un ciclo; cycle queda "a -> b -> a"
+    bool define(uint32_t slot, const string& source, const CompiledPtr& ce, string& cycle);
+    void remove(uint32_t slot);          // deja de ser formula (asignacion comun o del)
+    // despues de copiar el grafo: cada formula pasa a tener su propia forma compilada
+    // (el contador del JIT se escribe al evaluar y la copia puede ir a otro hilo)
+    void detach();
+
+    void propagate(const uint32_t* changed, size_t nChanged, const Recompute& fn);
+    std::vector<uint32_t> dependentsOf(uint32_t slot) const;   // formulas que leen slot
+    std::vector<uint32_t> list() const;  // formulas definidas, ordenadas por nombre
+private:
+    struct Node {
+        uint32_t slot;
+        bool formula{false};
+        Formula f;
+        std::vector<uint32_t> inputs, dependents;
+        unsigned seen{0}, changed{0};    // marcas por epoca: no hace falta limpiarlas
+    };
+    std::vector<uint32_t> ids;           // slot -> nodo (kNone si no hay)
+    std::vector<Node> nodes;
+    size_t count{0};
+    unsigned epoch{0};
+    std::vector<uint32_t> order, parent;
+    struct Frame { uint32_t id; size_t next; };
+    std::vector<Frame> work;
+
+    uint32_t idOf(uint32_t slot);
+    int lookup(uint32_t slot) const { return slot<ids.size() && ids[slot]!=Symbols::kNone ? (int)ids[slot] : -1; }
+    void unlink(uint32_t id);
+};
+
+#endif // FORMULAS_HPP
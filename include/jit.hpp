@@ -0,0 +1,50 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "common.hpp"
+#include "bytecode.hpp"
+#include <memory>
+
+// -------------------- JIT x86-64 --------------------
+// Traduce un Program a codigo de maquina SSE2 en un buffer ejecutable.
+// Las funciones de libm se llaman desde el codigo generado y los chequeos
+// de dominio/division por cero se hacen en linea (sin excepciones en el codigo nativo).
+class JitFunction {
+public:
+    JitFunction():mem(nullptr),size(0){}
+    ~JitFunction();
+    JitFunction(const JitFunction&) = delete;
+    JitFunction& operator=(const JitFunction&) = delete;
+
+    bool compile(const Program& p);              // false si el host no es soportado o el programa es muy profundo
+    bool ready() const { return mem!=nullptr; }
+    // vars: valores de p.slots en orden; err queda != 0 si hubo error
+    double call(const double* vars, int* err) const;
+
+    static bool supported();
+    static const char* errorMessage(int err);
+private:
+    void* mem; size_t size;
+};
+
+// Estado JIT de una expresion; vive junto a su forma compilada (ver ExprCache).
+struct JitSlot { unsigned hits{0}; bool failed{false}; std::shared_ptr<JitFunction> fn; };
+
+// Contador de evaluaciones por expresion: pasado el umbral se compila a nativo.
+// Si el host no es x86-64 o falta alguna variable se usa la VM.
+class Jit {
+public:
+    Jit(VarEnv* env, unsigned threshold):env(env),threshold(threshold){}
+    double eval(JitSlot& slot, const Program& p, VM& vm, Error& e);   // no lanza, como VM::run
+    // eval() partido en dos para --jobs: count() suma una evaluacion (y compila al llegar al
+    // umbral) en el orden del script y dice si slot ya tiene codigo nativo; call() corre ese
+    // codigo con las variables de env, sin tocar el slot, desde cualquier hilo
+    bool count(JitSlot& slot, const Program& p) const;
+    static double call(const JitFunction& fn, const Program& p, const VarEnv& env, VM& vm, Error& e, std::vector<double>& vars);
+private:
+    VarEnv* env;
+    unsigned threshold;
+    std::vector<double> vars;
+};
+
+#endif // JIT_HPP
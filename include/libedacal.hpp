@@ -0,0 +1,89 @@
+#ifndef LIBEDACAL_HPP
+#define LIBEDACAL_HPP
+
+#include "common.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "symbols.hpp"
+#include <memory>
+
+struct CompiledExpr;
+
+// -------------------- libedacal: API para embeber --------------------
+// Expression::compile pasa el texto por ShuntingYard::parse (texto -> arbol), Optimizer y
+// Compiler una sola vez y devuelve un handle inmutable; copiarlo solo copia un puntero.
+// Para evaluar, cada hilo usa sus propios Bindings (valores de variables + pila de la
+// VM), asi el mismo handle se evalua desde muchos hilos a la vez sin locks.
+// Los errores vuelven como Status; el texto es el mismo que imprime el REPL.
+//
+//   edacal::Expression f;
+//   if(edacal::Expression::compile("sqrt(x^2+y^2)", f)!=edacal::Ok) ...
+//   edacal::Bindings b; b.set("x", 3); b.set("y", 4);
+//   double r; if(f.eval(b, r)==edacal::Ok) ...              // r = 5
+namespace edacal {
+
+enum Status {
+    Ok = 0,
+    SyntaxError,        // caracter invalido, parentesis, expresion incompleta, numero invalido
+    UndefinedVariable,
+    DivisionByZero,
+    DomainError,        // sqrt de negativo, log/ln de no-positivo
+    InternalError,      // cualquier otra falla (sin memoria, handle vacio)
+    TooManyNames        // la tabla de simbolos del proceso no admite nombres nuevos
+};
+const char* statusName(Status s);
+
+// Valores de variables de un hilo. No se comparte entre hilos: uno por hilo (o por tarea).
+// Empieza con pi y e, como el REPL.
+class Bindings {
+public:
+    Bindings();
+    Bindings(const Bindings& o);
+    Bindings& operator=(const Bindings& o);
+
+    void set(const string& name, double v){ env.set(name, v); }
+    void set(uint32_t slot, double v){ env.set(slot, v); }     // slot: Expression::slot(i) o symbol()
+    bool erase(const string& name){ return env.erase(name); }
+    bool get(const string& name, double& v) const { if(!env.has(name)) return false; v=env.get(name); return true; }
+    const VarEnv& vars() const { return env; }
+
+    const string& error() const;                               // texto del ultimo eval que fallo
+    const Error& lastError() const { return last; }            // lo mismo como codigo, sin armar texto
+private:
+    friend class Expression;
+    VarEnv env;
+    VM vm;
+    Error last;
+    mutable string message;                                    // error() lo arma al pedirlo
+};
+
+// slot de un nombre: con set(slot, v) fijar una variable no busca el nombre
+inline uint32_t symbol(const string& name){ return Symbols::intern(name); }
+
+class Expression {
+public:
+    // message (opcional) recibe el texto del error, p. ej. "Parentesis desbalanceados"
+    static Status compile(const string& source, Expression& out, string* message=nullptr);
+
+    bool valid() const { return c!=nullptr; }
+    // const y sin estado compartido: seguro desde varios hilos, cada uno con sus Bindings
+    Status eval(Bindings& b, double& result) const;
+
+    // variables que lee la expresion, en orden de primera aparicion
+    size_t variableCount() const;
+    uint32_t slot(size_t i) const;
+    const string& variable(size_t i) const { return Symbols::name(slot(i)); }
+
+    void printPostfix(std::ostream& os) const;
+    void printPrefix(std::ostream& os) const;
+    void printTree(std::ostream& os) const;
+private:
+    std::shared_ptr<const CompiledExpr> c;
+};
+
+// clasifica un error del pipeline (tokenizer, arbol, VM)
+Status statusOf(const Error& e);
+
+} // namespace edacal
+
+#endif // LIBEDACAL_HPP
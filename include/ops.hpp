@@ -0,0 +1,30 @@
+#ifndef OPS_HPP
+#define OPS_HPP
+
+#include "common.hpp"
+
+// Operadores resueltos una sola vez (al construir el arbol) en vez de comparar strings
+enum class OpCode : unsigned char {
+    Const, Var,                              // hojas
+    Neg, Pos, Sqrt, Sin, Cos, Tan, Log, Ln,  // unarios
+    Add, Sub, Mul, Div, Pow,                 // binarios
+    Save, Load                               // solo bytecode: temporales de subexpresiones compartidas
+};
+
+static inline bool isLeafOp(OpCode op){ return op==OpCode::Const || op==OpCode::Var; }
+static inline bool isBinaryOp(OpCode op){ return op>=OpCode::Add && op<=OpCode::Pow; }
+
+static inline const char* opText(OpCode op){
+    switch(op){
+        case OpCode::Neg: return "-";   case OpCode::Pos: return "+";
+        case OpCode::Sqrt: return "sqrt"; case OpCode::Sin: return "sin";
+        case OpCode::Cos: return "cos"; case OpCode::Tan: return "tan";
+        case OpCode::Log: return "log"; case OpCode::Ln: return "ln";
+        case OpCode::Add: return "+";   case OpCode::Sub: return "-";
+        case OpCode::Mul: return "*";   case OpCode::Div: return "/";
+        case OpCode::Pow: return "^";
+        default: return "?";
+    }
+}
+
+#endif // OPS_HPP
@@ -0,0 +1,43 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "common.hpp"
+#include "expr_tree.hpp"
+
+// -------------------- Optimizador --------------------
+// Reescribe el arbol en un DAG equivalente, entre buildFromPostfix y el Compiler:
+//  - plegado de constantes con las mismas funciones que la VM (mismo resultado bit a bit);
+//    lo que daria error (1/0, sqrt(-1), log(0)) no se pliega: el error sale al evaluar.
+//  - los nombres de constants (pi, e mientras nadie los reasigne) se pliegan como numeros.
+//  - identidades exactas en IEEE: x*1, 1*x, x/1, x-0, x+(-0), -(-x), +x.
+//    x+0 no: (-0)+0 da +0.
+//  - hash-consing: subarboles identicos quedan en un solo nodo, el Compiler lo calcula una vez.
+// El DAG sigue en orden topologico (primera aparicion de cada nodo en la post-orden original),
+// asi que el primer error reportado es el mismo que sin optimizar.
+class Optimizer {
+public:
+    const std::unordered_map<string,double>* constants{nullptr};
+
+    void run(const ExprTree& in, ExprTree& out);
+
+    // "tree opt": como printTree, pero un nodo compartido se imprime entero una vez
+    // con su marca [#k] y despues solo como [#k]
+    static void printDag(std::ostream& os, const ExprTree& t);
+private:
+    // hash-consing en una tabla abierta (id+1 del nodo en el pool de salida, 0 = vacia):
+    // la clave es el nodo mismo, asi no hay un nodo de hash por entrada y la tabla se
+    // reutiliza entre lineas sin pedir memoria
+    std::vector<uint32_t> interned;
+    size_t mask{0};
+    std::vector<uint32_t> map, nameMap, idx;
+    std::vector<char> live;
+    ExprTree* out{nullptr};
+
+    uint32_t node(OpCode op, uint32_t l, uint32_t r, double num, uint32_t name);
+    uint32_t constant(double v){ return node(OpCode::Const, ExprTree::kNone, ExprTree::kNone, v, ExprTree::kNone); }
+    bool isConst(uint32_t i, double v) const;
+    static bool fold(OpCode op, double a, double b, double& r);
+    void compact();
+};
+
+#endif // OPTIMIZER_HPP
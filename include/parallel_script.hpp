@@ -0,0 +1,17 @@
+#ifndef PARALLEL_SCRIPT_HPP
+#define PARALLEL_SCRIPT_HPP
+
+#include "common.hpp"
+#include "session.hpp"
+
+// -------------------- Scripts en paralelo (--jobs N) --------------------
+// Parsea el script completo, arma un grafo de dependencias entre lineas segun las
+// variables que cada una lee y escribe (LHS, ans, del) y evalua las independientes
+// en un ThreadPool. La salida es identica, byte a byte, a la ejecucion secuencial.
+// help/vars y cualquier otra linea que no se pueda analizar cortan el script en
+// segmentos: esas lineas se ejecutan solas con Session::handle.
+// text son las lineas del script separadas por '\n' (el archivo mapeado de --file, o stdin
+// leido entero): se recorren sobre el puntero, sin copiar el script a un string por linea.
+void runScriptParallel(Session& s, const char* text, size_t size, unsigned jobs);
+
+#endif // PARALLEL_SCRIPT_HPP
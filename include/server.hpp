@@ -0,0 +1,65 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "common.hpp"
+#include "thread_pool.hpp"
+
+class Session;
+
+// -------------------- Servidor (--serve) --------------------
+// Escucha en un socket Unix y habla el mismo protocolo de lineas que el REPL: cada
+// linea recibida se pasa a Session::handle y lo que imprime vuelve por el socket
+// (resultados y errores en el mismo flujo, como con la entrada redirigida).
+// Cada conexion tiene su propia Session: variables, formulas, ultima expresion y cache.
+// Un solo hilo atiende epoll (aceptar, leer, escribir) y las lineas se evaluan en un
+// ThreadPool. Un cliente puede mandar muchas lineas sin esperar respuesta (pipelining):
+// se encolan y un worker las procesa en orden, de a lotes; conexiones distintas
+// avanzan en paralelo. "exit" o el fin de la entrada cierran la conexion despues
+// de mandar todas las respuestas. Solo Linux (epoll, eventfd).
+// Lo que un cliente no puede hacer: save/load (no elige archivos del servidor), mandar
+// una linea de mas de 1 MB (se responde "Error: linea demasiado larga" y se cierra),
+// agregar mas de 4096 nombres nuevos a la tabla de simbolos global (ni, entre todas las
+// conexiones del proceso, mas de 2^18: agotado eso nadie crea nombres nuevos), ni abrir hilos: sweep
+// corre en el worker que atiende la conexion, con 10^7 puntos como mucho, y se corta
+// ("Error: barrido cortado: ...") si la conexion se cierra, el servidor se detiene o la
+// salida sin mandar pasa de 4 MB.
+class Server {
+public:
+    explicit Server(unsigned workers);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // opciones de cada Session nueva (mismas que en la linea de comandos)
+    bool useJit{false};
+    unsigned jitThreshold{64};
+    long cacheSize{-1};
+    const Session* initial{nullptr};                   // --restore: cargada una vez; cada conexion arranca con una copia
+
+    bool listen(const string& path, string& error);   // crea el socket (reemplaza uno viejo)
+    void run();                                        // atiende hasta stop()
+    void stop();                                       // se puede llamar desde otro hilo o un manejador de senal
+
+    static bool supported();
+private:
+    struct Conn;
+    typedef std::shared_ptr<Conn> ConnPtr;
+
+    ThreadPool pool;
+    string path;
+    int lfd{-1}, ep{-1}, wakeFd{-1};
+    std::atomic<bool> stopping{false};
+    std::unordered_map<int,ConnPtr> conns;   // solo el hilo de epoll
+    std::mutex m;
+    std::vector<ConnPtr> ready;              // conexiones con salida nueva (protegido por m)
+
+    void accept();
+    void read(const ConnPtr& c);
+    void flush(const ConnPtr& c);
+    void watch(const ConnPtr& c);
+    void close(const ConnPtr& c);
+    void drain(const ConnPtr& c);            // worker: procesa las lineas encoladas de c
+    void notify(const ConnPtr& c);
+};
+
+#endif // SERVER_HPP
@@ -0,0 +1,93 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "common.hpp"
+#include "token.hpp"
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "expr_cache.hpp"
+#include "formulas.hpp"
+#include "fast_io.hpp"
+#include "stats.hpp"
+
+// -------------------- Comandos del REPL --------------------
+// Clasificacion de una linea ya recortada; la usan el REPL y el modo --jobs,
+// asi ambos interpretan cada linea exactamente igual.
+struct Command {
+    enum Kind { Empty, Exit, Help, Posfix, Prefix, Tree, Vars, Cache, Stats, Defs, Del, Show, Save, Load, Sweep, Assign, Def, BadLhs, Eval };
+    Kind kind{Empty};
+    string name;   // Assign/Def: LHS; Show/Del: variable; Save/Load: archivo
+    bool optimized{false};  // "tree opt [expr]": arbol despues del Optimizer
+    string expr;   // Assign/Def: RHS; Eval: linea; Posfix/Prefix/Tree: argumento (puede ir vacio); Cache: "clear" o vacio; Stats: "on"/"off" o vacio; Sweep: lo que sigue a "sweep"
+};
+
+Command parseCommand(const string& line);
+void parseCommand(const string& line, Command& c);   // reusa los strings de c
+
+// -------------------- Sesion --------------------
+// Estado de una sesion (variables + ultima expresion + cache) y manejo de una linea.
+// out recibe los resultados; err los mensajes "Error: ..." (cerr en modo interactivo).
+class Session {
+public:
+    Session(std::ostream& out, std::ostream& err);
+
+    bool handle(const string& line);     // false cuando la linea es "exit"
+    bool handle(const char* p, size_t n);  // linea sin copiar (--file): se recorta sobre el puntero
+
+    VarEnv env;
+    CompiledPtr last;                    // ultima expresion para prefix/posfix/tree (nulo o posfija vacia: no hay)
+    ExprCache cache;
+    std::unordered_map<string,double> constants;  // se pliegan al compilar; salen de aca si se reasignan
+    FormulaGraph formulas;               // def y = expr
+    const uint32_t ansSlot;              // slot de "ans": se escribe en cada linea
+    bool useJit{false};
+    unsigned sweepThreads{0};            // hilos de sweep (0 = todos los nucleos)
+    uint64_t sweepMaxPoints{0};          // puntos por sweep (0 = sin mas tope que 2^53)
+    std::function<const char*()> sweepStop;   // SweepStop: --serve corta los sweeps de una conexion cerrada
+    bool allowFiles{true};               // save/load: --serve los apaga (el cliente no elige archivos del servidor)
+
+    std::ostream& out;
+    std::ostream& err;
+
+    void setJitThreshold(unsigned n){ jit = Jit(&env, n); }
+    // forma compilada de expr (cache o parse+optimizador+bytecode): con un error lexico o de
+    // parentesis devuelve nullptr y e; los del arbol quedan en buildError. No lanza.
+    CompiledPtr compile(const string& expr, Error& e);
+    CompiledPtr compile(const string& expr){ Error e; CompiledPtr c=compile(expr, e); if(!c) e.raise(); return c; }
+    // variables, formulas, constantes y ultima expresion de s (--serve: la sesion que cargo
+    // --restore), sin compartir formas compiladas con s; la cache arranca vacia
+    void copyState(const Session& s);
+    // --jobs: cuenta una evaluacion de c para el JIT (en el orden del script, como handle())
+    // y devuelve su codigo nativo, o nullptr si sigue en la VM
+    std::shared_ptr<JitFunction> jitFor(CompiledExpr& c){ return useJit && jit.count(c.jit, c.prog) ? c.jit.fn : nullptr; }
+    bool isConstant(const string& name) const { return constants.count(name)!=0; }
+    // escribir name obliga a recalcular formulas (o name es una): --jobs no la paraleliza
+    bool isReactive(const string& name) const { return formulas.reactive(Symbols::find(name)); }
+    static void printValue(std::ostream& os, const string& name, double v);
+    static void printPostfix(std::ostream& os, const ExprTree& t);   // posfija guardada (aun si el arbol fallo)
+    static void printHelp(std::ostream& os);
+private:
+    ShuntingYard sy; Optimizer opt; Compiler comp;
+    VM vm; Jit jit;
+
+    string line; Command cmd;            // buffers reusados por handle()
+    string key;                          // clave de cache de la linea actual (sin pedir memoria por linea)
+    uint64_t lineNo{0};                  // numero de linea para --trace
+
+    // los errores de cada linea llegan como Error y el texto se escribe directo en err;
+    // las excepciones quedan para lo raro (archivos de save/load, memoria)
+    void error(const Error& e){ stats::count(stats::Errors); err << "Error: "; e.print(err); err << "\n"; }
+    void error(const std::exception& ex){ stats::count(stats::Errors); err << "Error: " << ex.what() << "\n"; }
+    CompiledPtr treeFor(const Command& c, Error& e);  // arbol del argumento o de la ultima expresion (nullptr: no hay)
+    double evaluate(const string& expr, Error& e);
+    double run(CompiledExpr& c, Error& e){ stats::Timer t(stats::Eval); return useJit ? jit.eval(c.jit, c.prog, vm, e) : vm.run(c.prog, e); }
+    void changed(uint32_t a, uint32_t b=Symbols::kNone);   // recalcula las formulas aguas abajo
+    bool recompute(uint32_t slot, FormulaGraph::Formula& f);
+    void define(const Command& c);
+};
+
+#endif // SESSION_HPP
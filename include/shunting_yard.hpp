@@ -3,12 +3,34 @@
 
 #include "common.hpp"
 #include "token.hpp"
-#include "linked_list.hpp"
-#include "stack.hpp"
+#include "expr_tree.hpp"
+#include "small_vector.hpp"
 
 class ShuntingYard {
 public:
-    LinkedList<Token> toPostfix(LinkedList<Token>& infix);
+    // Vacia out y escribe la posfija de infix; la pila de operadores es un miembro
+    // que se reutiliza, asi una linea tipica no asigna memoria
+    void toPostfix(const std::vector<Token>& infix, std::vector<Token>& out);
+    // usa el buffer propio: la referencia vale hasta la proxima llamada
+    const std::vector<Token>& toPostfix(const std::vector<Token>& infix){ toPostfix(infix, buf); return buf; }
+
+    // Una sola pasada texto -> arbol: los tokens se leen de a uno (Tokenizer::next) y cada
+    // token que la posfija emitiria va directo a ExprTree::push, sin vectores de tokens.
+    // Mismos resultados que tokenize + toPostfix + buildFromPostfix, errores incluidos y en
+    // el mismo orden de prioridad: un caracter o numero invalido en cualquier lugar gana,
+    // despues los parentesis desbalanceados (en los dos casos out queda vacio, e.lexical()),
+    // y al final los errores del arbol, con la posfija guardada en out.nodes. No lanza:
+    // el error vuelve en e con su posicion en el texto (vacio si salio bien).
+    void parse(const char* p, size_t n, ExprTree& out, Error& e);
+    // usa el arbol propio: la referencia vale hasta la proxima llamada
+    const ExprTree& parse(const string& s, Error& e){ parse(s.data(), s.size(), tree, e); return tree; }
+    size_t tokens() const { return lastTokens; }            // tokens leidos por el ultimo parse
+private:
+    SmallVector<Token, 32> ops;
+    SmallVector<uint32_t, 32> opPos;     // parse: posicion en el texto de cada operador de ops
+    std::vector<Token> buf;
+    ExprTree tree;
+    size_t lastTokens{0};
 };
 
 #endif // SHUNTING_YARD_HPP
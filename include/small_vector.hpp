@@ -0,0 +1,142 @@
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include "common.hpp"
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+// -------------------- Vector contiguo con buffer interno --------------------
+// Los primeros N elementos viven dentro del objeto (sin pedir memoria); al pasarse se
+// mueve todo a un bloque del heap que crece al doble. Sirve de pila (push_back/back/pop_back)
+// y de lista (push_back + recorrido). Copia, movimiento y destruccion completos:
+// moverlo roba el bloque del heap, o mueve elemento a elemento si estaba en el buffer.
+template<typename T, size_t N>
+class SmallVector {
+    static_assert(N>0, "SmallVector necesita al menos un elemento interno");
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SmallVector():p(local()),n(0),cap(N){}
+    SmallVector(const SmallVector& o):SmallVector(){ append(o.begin(), o.end()); }
+    SmallVector(SmallVector&& o) noexcept(std::is_nothrow_move_constructible<T>::value):SmallVector(){ take(o); }
+    ~SmallVector(){ release(); }
+
+    SmallVector& operator=(const SmallVector& o){
+        if(this!=&o){ clear(); append(o.begin(), o.end()); }
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& o) noexcept(std::is_nothrow_move_constructible<T>::value){
+        if(this!=&o){ release(); p=local(); n=0; cap=N; take(o); }
+        return *this;
+    }
+
+    // el argumento puede ser un elemento del propio vector: se construye antes de mover los viejos
+    template<class... A> T& emplace_back(A&&... a){
+        if(n==cap) return growEmplace(std::forward<A>(a)...);
+        T* x=::new((void*)(p+n)) T(std::forward<A>(a)...);
+        ++n;
+        return *x;
+    }
+    void push_back(const T& x){ emplace_back(x); }
+    void push_back(T&& x){ emplace_back(std::move(x)); }
+    void pop_back(){ p[--n].~T(); }
+
+    T& back(){ return p[n-1]; }
+    const T& back() const { return p[n-1]; }
+    T& operator[](size_t i){ return p[i]; }
+    const T& operator[](size_t i) const { return p[i]; }
+    T* data(){ return p; }
+    const T* data() const { return p; }
+    iterator begin(){ return p; }
+    iterator end(){ return p+n; }
+    const_iterator begin() const { return p; }
+    const_iterator end() const { return p+n; }
+
+    size_t size() const { return n; }
+    bool empty() const { return n==0; }
+    size_t capacity() const { return cap; }
+    bool isInline() const { return p==local(); }
+
+    // clear() no devuelve memoria: la siguiente linea reutiliza la capacidad
+    void clear(){ destroy(p, p+n); n=0; }
+    void reserve(size_t m){ if(m>cap) relocate(m); }
+    void resize(size_t m){
+        if(m<n){ destroy(p+m, p+n); n=m; return; }
+        reserve(m);
+        for(; n<m; ++n) ::new((void*)(p+n)) T();
+    }
+    void resize(size_t m, const T& v){
+        if(m<n){ destroy(p+m, p+n); n=m; return; }
+        reserve(m);
+        for(; n<m; ++n) ::new((void*)(p+n)) T(v);
+    }
+    void assign(size_t m, const T& v){ clear(); resize(m, v); }
+    // [b,e) puede ser del propio vector: si hay que crecer, se copia al bloque nuevo antes
+    // de mover los viejos y soltar el bloque anterior (como emplace_back)
+    template<class It> void append(It b, It e){
+        size_t k=(size_t)std::distance(b, e);
+        if(n+k<=cap){ for(; b!=e; ++b){ ::new((void*)(p+n)) T(*b); ++n; } return; }
+        size_t m=std::max(n+k, 2*cap), done=0;
+        T* q=allocate(m);
+        try{
+            for(; b!=e; ++b, ++done) ::new((void*)(q+n+done)) T(*b);
+            moveTo(q);
+        } catch(...){ destroy(q+n, q+n+done); ::operator delete(q); throw; }
+        if(!isInline()) ::operator delete(p);
+        p=q; cap=m; n+=k;
+    }
+
+private:
+    T* p;
+    size_t n, cap;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buf[N];
+
+    T* local(){ return reinterpret_cast<T*>(buf); }
+    const T* local() const { return reinterpret_cast<const T*>(buf); }
+    static void destroy(T* b, T* e){ for(; b!=e; ++b) b->~T(); }
+    void release(){ clear(); if(!isInline()) ::operator delete(p); }
+
+    static T* allocate(size_t m){
+        if(m<N || m>SIZE_MAX/sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(::operator new(m*sizeof(T)));
+    }
+    void relocate(size_t m){
+        T* q=allocate(m);
+        try{ moveTo(q); } catch(...){ ::operator delete(q); throw; }
+        if(!isInline()) ::operator delete(p);
+        p=q; cap=m;
+    }
+    // los n elementos a q; si mover puede lanzar se copian (move_if_noexcept), asi una
+    // excepcion a mitad de camino deja el vector como estaba
+    void moveTo(T* q){
+        size_t i=0;
+        try{ for(; i<n; ++i) ::new((void*)(q+i)) T(std::move_if_noexcept(p[i])); }
+        catch(...){ destroy(q, q+i); throw; }
+        destroy(p, p+n);
+    }
+    template<class... A> T& growEmplace(A&&... a){
+        size_t m=2*cap;
+        T* q=allocate(m);
+        T* x;
+        try{ x=::new((void*)(q+n)) T(std::forward<A>(a)...); }
+        catch(...){ ::operator delete(q); throw; }
+        try{ moveTo(q); } catch(...){ x->~T(); ::operator delete(q); throw; }
+        if(!isInline()) ::operator delete(p);
+        p=q; cap=m; ++n;
+        return *x;
+    }
+    void take(SmallVector& o){
+        if(o.isInline()){
+            for(size_t i=0;i<o.n;++i) ::new((void*)(p+i)) T(std::move(o.p[i]));
+            n=o.n; o.clear();
+        } else {
+            p=o.p; n=o.n; cap=o.cap;
+            o.p=o.local(); o.n=0; o.cap=N;
+        }
+    }
+};
+
+#endif // SMALL_VECTOR_HPP
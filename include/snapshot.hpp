@@ -0,0 +1,28 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "common.hpp"
+
+class Session;
+
+// -------------------- Snapshots de sesion (save / load / --restore) --------------------
+// Archivo binario con las variables (VarEnv), las formulas (texto + forma compilada),
+// la ultima expresion y que nombres siguen siendo constantes. Los slots dependen del
+// proceso, asi que todo lo que nombra una variable guarda un indice en la tabla de
+// nombres del archivo y al cargar se traduce con una sola pasada de Symbols::intern.
+//
+// Disposicion (todo alineado a 8, en el orden de bytes del host):
+//   encabezado | valores (double[]) | nombres de variables (u32[]) | datos de cada expresion |
+//   tabla de nombres | textos (fuentes de formulas) | expresiones | formulas
+// Nodos e instrucciones van tal cual estan en memoria: al cargar se leen con
+// memcpy directo desde el mapeo (mmap), sin parsear texto ni recompilar.
+// El encabezado lleva version, tamanos de los structs y un checksum de todo el archivo.
+//
+// Ambas lanzan runtime_error; load deja la sesion intacta si el archivo no sirve.
+void saveSnapshot(const Session& s, const string& path);
+void loadSnapshot(Session& s, const string& path);
+// checksum de la imagen de un snapshot (con el campo del encabezado en cero). No es una
+// firma, cualquiera lo recalcula: load valida todo lo demas igual (tests: archivos editados)
+uint64_t snapshotChecksum(const char* data, size_t size);
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,103 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include "common.hpp"
+#include <atomic>
+#include <chrono>
+
+// -------------------- Estadisticas e instrumentacion --------------------
+// Contadores y histogramas de latencia por etapa del pipeline (comando stats, --stats)
+// y traza por linea en formato Chrome trace-event (--trace out.json, se abre en
+// chrome://tracing o Perfetto). Cada hilo escribe en su propio bloque, sin locks;
+// stats suma los bloques de todos los hilos. Compilando con -DEDACAL_NO_STATS todo
+// queda en funciones vacias y el compilador lo elimina.
+namespace stats {
+
+enum Stage { Line, Parse, Compile, Eval, Output, kStages };   // Parse: texto -> arbol en una pasada
+// Allocations solo cuenta en los programas que incluyen alloc_count.hpp (edacal, el bench):
+// la biblioteca no reemplaza el operator new de quien la usa
+enum Counter { Lines, Tokens, Nodes, Errors, Allocations, kCounters };
+
+// histograma log2: el bucket k cuenta duraciones de menos de 2^k ns (y al menos 2^(k-1))
+struct Histogram {
+    uint64_t count, sum, max;
+    uint64_t buckets[64];
+    uint64_t percentile(double p) const;   // cota superior del bucket (ns)
+};
+
+struct Snapshot {
+    uint64_t counters[kCounters];
+    Histogram stages[kStages];
+};
+
+const char* stageName(Stage s);
+void print(std::ostream& os);              // salida del comando stats
+
+#ifndef EDACAL_NO_STATS
+
+const bool kEnabled=true;
+
+// bloque por hilo: solo su hilo lo escribe (store relajado, sin lock ni RMW) y
+// stats lo lee desde cualquier otro
+struct Block {
+    std::atomic<uint64_t> counters[kCounters];
+    struct { std::atomic<uint64_t> count, sum, max, buckets[64]; } stages[kStages];
+    unsigned tid;
+};
+
+Block* newBlock();
+// bloque del hilo actual (nulo hasta el primer uso)
+inline Block*& current(){ static thread_local Block* b=nullptr; return b; }
+inline Block& local(){ Block*& b=current(); if(!b) b=newBlock(); return *b; }
+
+inline void bump(std::atomic<uint64_t>& a, uint64_t n){ a.store(a.load(std::memory_order_relaxed)+n, std::memory_order_relaxed); }
+inline void count(Counter c, uint64_t n=1){ bump(local().counters[c], n); }
+
+// sin --stats/--trace/"stats on" solo se cuentan eventos: leer el reloj en cada etapa
+// cuesta del orden de 30% en scripts con lineas cortas
+// atomico: "stats on/off" lo cambia mientras los hilos de --jobs y --serve lo leen
+extern std::atomic<bool> timing;
+inline void setTiming(bool on){ timing.store(on, std::memory_order_relaxed); }
+inline bool timingOn(){ return timing.load(std::memory_order_relaxed); }
+inline uint64_t now(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+void record(Stage s, uint64_t t0, uint64_t t1);   // histograma (y traza si esta abierta)
+void setLine(uint64_t line);                       // linea que se informa en la traza
+
+// mide una etapa desde la construccion hasta stop() o el destructor
+class Timer {
+public:
+    explicit Timer(Stage s):s(s),t0(timingOn() ? now() : 0){}
+    ~Timer(){ stop(); }
+    void stop(){ if(t0){ record(s, t0, now()); t0=0; } }
+private:
+    Stage s; uint64_t t0;
+};
+
+bool openTrace(const string& path);
+void closeTrace();
+Snapshot snapshot();
+
+#else // EDACAL_NO_STATS: nada de esto cuesta
+
+const bool kEnabled=false;              // stats, stats on/off y --stats solo lo avisan
+
+inline void count(Counter, uint64_t=1){}
+inline void setTiming(bool){}
+inline void setLine(uint64_t){}
+class Timer {
+public:
+    explicit Timer(Stage){}
+    void stop(){}
+};
+inline bool timingOn(){ return false; }
+inline bool openTrace(const string&){ return false; }
+inline void closeTrace(){}
+Snapshot snapshot();
+
+#endif
+
+} // namespace stats
+
+#endif // STATS_HPP
@@ -0,0 +1,61 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "common.hpp"
+#include "bytecode.hpp"
+#include "evaluator.hpp"
+#include "error.hpp"
+#include <functional>
+
+class Session;
+
+// -------------------- Barridos (sweep) --------------------
+// Una expresion compilada una vez y evaluada en todos los puntos de una grilla:
+// el producto de uno o mas rangos (el primero es el de afuera, como filas de una tabla).
+struct SweepRange {
+    uint32_t slot;                 // variable que recorre el rango
+    double from, step;
+    uint64_t count;                // puntos: from, from+step, ..., from+(count-1)*step
+    double at(uint64_t i) const { return from + (double)i*step; }   // sin acumular el paso
+};
+
+enum class Reduction { Table, Sum, Min, Max, ArgMin, ArgMax, Mean };
+
+struct SweepResult {
+    uint64_t points{0}, valid{0}, errors{0};
+    double value{0.0};             // Sum: suma compensada; Mean: promedio; Min/Max/Arg*: el extremo
+    uint64_t at{0};                // Min/Max/Arg*: indice del punto del extremo (el primero si empatan)
+    bool found{false};             // Min/Max/Arg*: algun punto dio un valor (ni error ni nan); si no, value y at no valen
+    Error first; uint64_t firstAt{0};   // error del primer punto que fallo, en orden de indice
+    const char* stopped{nullptr};  // motivo si stop corto el barrido: lo demas no vale
+};
+
+// corte de un barrido largo (--serve): se consulta antes de cada bloque, desde los hilos
+// del barrido; nullptr para seguir o el motivo para cortar
+typedef std::function<const char*()> SweepStop;
+
+// Los puntos se reparten en bloques de kChunk en un ThreadPool de threads hilos
+// (0 = todos los nucleos): un solo pool por proceso, creado con el primer barrido (y de
+// nuevo si cambia threads); los barridos que lo usan van de a uno. Con threads=1 o un
+// solo bloque no hay pool y todo corre en el hilo que llama (--serve ya esta en un worker).
+// Cada tarea parte su rango de bloques a la mitad y encola una mitad, asi los hilos
+// libres roban trozos grandes. Cada hilo evalua con su propia VM y
+// su copia de las variables que lee el programa (las de env, sin tocar env).
+// Cada bloque deja un parcial (suma de Neumaier, extremo, errores) y los parciales se
+// combinan en un arbol por indice de bloque: el resultado es el mismo bit a bit con
+// cualquier cantidad de hilos. Los puntos con error no entran en la reduccion.
+// Con Reduction::Table cada punto es una fila "x<TAB>y<TAB>valor" (o "Error: ...") en
+// table, en orden; se evalua por tandas de bloques para no juntar toda la salida. Si stop
+// corta, la tabla queda hasta la ultima tanda completa.
+SweepResult sweep(const Program& p, const VarEnv& env, const std::vector<SweepRange>& ranges,
+                  Reduction r, unsigned threads, std::ostream* table, const SweepStop& stop=SweepStop());
+
+// valor de la variable del rango k en el punto i
+double sweepValue(const std::vector<SweepRange>& ranges, uint64_t i, size_t k);
+
+// comando del REPL: "sweep [sum|min|max|argmin|argmax|mean] expr for x=ini:fin[:paso], y=..."
+// (args es lo que sigue a "sweep"). Los extremos de los rangos pueden ser expresiones;
+// no cambia ninguna variable de la sesion. Respeta Session::sweepMaxPoints y sweepStop.
+void runSweep(Session& s, const string& args);
+
+#endif // SWEEP_HPP
@@ -0,0 +1,56 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include "common.hpp"
+#include <cstring>
+
+// Vista (puntero + largo) sobre texto ajeno: no copia ni es duena de nada
+struct StrRef {
+    const char* p;
+    size_t n;
+    bool operator==(const StrRef& o) const { return n==o.n && std::memcmp(p, o.p, n)==0; }
+};
+
+struct StrRefHash {
+    size_t operator()(const StrRef& s) const {
+        uint64_t h=1469598103934665603ull;                       // FNV-1a
+        for(size_t i=0;i<s.n;++i){ h^=(unsigned char)s.p[i]; h*=1099511628211ull; }
+        return (size_t)h;
+    }
+};
+
+// intern() de un nombre nuevo sin lugar: tabla llena ("Demasiados identificadores") o cupo
+// de setQuota agotado ("Demasiados identificadores nuevos")
+class TooManySymbols : public std::runtime_error {
+public:
+    explicit TooManySymbols(const char* what):std::runtime_error(what){}
+};
+
+// -------------------- Tabla de simbolos --------------------
+// Cada identificador distinto recibe un id estable para todo el proceso. Los nombres
+// viven en bloques que nunca se mueven, asi name(id) es una referencia valida siempre.
+// intern() consulta primero una cache por hilo (sin lock ni asignaciones); solo la
+// primera vez que un hilo ve un nombre pasa por la tabla global con mutex.
+// El id tambien es el slot de la variable en VarEnv.
+class Symbols {
+public:
+    static const uint32_t kNone = 0xFFFFFFFFu;
+    static uint32_t intern(const char* p, size_t n);
+    static uint32_t intern(const string& s){ return intern(s.data(), s.size()); }
+    // n nombres de una vez (snapshots): el nombre i es bytes[offs[i], offs[i+1]).
+    // Un solo lock y sin tocar la cache del hilo, que se llena sola al usarlos.
+    static void intern(const char* bytes, const uint32_t* offs, size_t n, uint32_t* ids);
+    // como intern pero sin crear el simbolo: kNone si el nombre nunca se vio
+    static uint32_t find(const char* p, size_t n);
+    static uint32_t find(const string& s){ return find(s.data(), s.size()); }
+    static const string& name(uint32_t id);
+    // cupos de nombres nuevos del hilo actual (--serve: remaining es el de la conexion que
+    // atiende y shared el de todas las conexiones juntas; nullptr = sin limite). Se descuentan
+    // bajo el lock de la tabla; con alguno en 0, intern() de un nombre que nadie vio lanza
+    // "Demasiados identificadores nuevos". La tabla es global y nunca se vacia: shared acota
+    // su tamano (y el de los VarEnv, indexados por id) pero, agotado, ninguna conexion crea
+    // nombres nuevos hasta reiniciar el proceso; los que ya existen se siguen usando.
+    static void setQuota(uint32_t* remaining, uint32_t* shared);
+};
+
+#endif // SYMBOLS_HPP
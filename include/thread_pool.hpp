@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "common.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Pool de hilos con robo de trabajo: cada hilo tiene su propia cola, saca tareas
+// de su extremo (LIFO, lo recien encolado sigue caliente en cache) y, si esta vacia,
+// roba del otro extremo de las colas ajenas.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned n);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);  // desde un worker va a su propia cola
+    void wait();                              // bloquea hasta terminar todo lo encolado
+    unsigned size() const { return (unsigned)threads.size(); }
+    int index() const;                        // worker del hilo actual en este pool (-1 si no es uno)
+
+    static unsigned defaultSize();
+private:
+    struct Queue { std::mutex m; std::deque<std::function<void()>> q; };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex m;
+    std::condition_variable wake, idle;
+    size_t queued{0};                         // tareas en colas (protegido por m)
+    size_t pending{0};                        // encoladas + en ejecucion (protegido por m)
+    bool stop{false};
+    std::atomic<unsigned> next{0};            // reparto round-robin desde fuera del pool
+
+    void worker(unsigned self);
+    bool take(unsigned self, std::function<void()>& task);
+};
+
+#endif // THREAD_POOL_HPP
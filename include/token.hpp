@@ -2,19 +2,42 @@
 #define TOKEN_HPP
 
 #include "common.hpp"
+#include "ops.hpp"
 
-enum class TokenType { Number, Identifier, Operator, LParen, RParen, End };
+enum class TokenType : unsigned char { Number, Identifier, Operator, LParen, RParen, End };
 
+// Token POD de 16 bytes: nada de strings. Los operadores y funciones llevan su OpCode
+// (el +/- unario lo decide ShuntingYard cambiando Add/Sub por Pos/Neg) y los
+// identificadores un id de Symbols. Precedencia y asociatividad salen del OpCode.
 struct Token {
-    TokenType type;
-    string text;     // para operadores e identificadores
     double value;    // para numeros
-    int precedence;  // solo si es operador
-    bool rightAssoc; // ^ es asociativo a derecha
-    bool unary;      // +/− unario o funciones tipo sqrt/sin/etc.
+    uint32_t sym;    // para identificadores: id en Symbols
+    TokenType type;
+    OpCode op;       // para operadores
 
-    Token()
-    : type(TokenType::End), text(), value(0.0), precedence(-1), rightAssoc(false), unary(false) {}
+    bool unary() const { return type==TokenType::Operator && !isBinaryOp(op); }
+    bool rightAssoc() const { return type==TokenType::Operator && (op==OpCode::Pow || unary()); }
+    int precedence() const {
+        if(type!=TokenType::Operator) return -1;
+        switch(op){
+            case OpCode::Add: case OpCode::Sub: return 1;
+            case OpCode::Mul: case OpCode::Div: return 2;
+            case OpCode::Pow: return 3;
+            default: return 4;   // +/- unario y funciones
+        }
+    }
 };
 
+static inline Token makeToken(TokenType type, OpCode op=OpCode::Const){
+    Token t; t.value=0.0; t.sym=0; t.type=type; t.op=op; return t;
+}
+
+// Traduce un token a su OpCode; false si no es numero, identificador ni operador
+static inline bool opFromToken(const Token& t, OpCode& op){
+    if(t.type==TokenType::Number){ op=OpCode::Const; return true; }
+    if(t.type==TokenType::Identifier){ op=OpCode::Var; return true; }
+    if(t.type!=TokenType::Operator) return false;
+    op=t.op; return true;
+}
+
 #endif // TOKEN_HPP
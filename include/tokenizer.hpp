@@ -3,11 +3,28 @@
 
 #include "common.hpp"
 #include "token.hpp"
-#include "linked_list.hpp"
+#include "error.hpp"
 
+// Convierte texto en tokens sin asignar memoria: los tokens son POD, los nombres se
+// internan en Symbols y out conserva su capacidad entre lineas.
 class Tokenizer { 
 public:
-    LinkedList<Token> tokenize(const std::string& s);
+    void tokenize(const char* p, size_t n, std::vector<Token>& out);
+    void tokenize(const std::string& s, std::vector<Token>& out){ tokenize(s.data(), s.size(), out); }
+    // usa el buffer propio del Tokenizer: la referencia vale hasta la proxima llamada
+    const std::vector<Token>& tokenize(const std::string& s){ tokenize(s, buf); return buf; }
+    // un token por llamada (lectura perezosa para ShuntingYard::parse): saltea espacios,
+    // deja i despues del token y devuelve false al final del texto o con un error en e
+    // (caracter o numero invalido, con su posicion); no lanza
+    static bool next(const char* p, size_t n, size_t& i, Token& t, Error& e);
+private:
+    std::vector<Token> buf;
 };
 
+// Numero decimal sin exponente (digitos con a lo sumo un '.'), redondeado correctamente.
+// Devuelve BadNumber si no hay digitos y NumberRange si se sale del rango de double.
+ErrCode parseDecimal(const char* p, size_t n, double& v);
+// lo mismo pero lanza como std::stod: invalid_argument u out_of_range
+double parseDecimal(const char* p, size_t n);
+
 #endif // TOKENIZER_HPP
@@ -0,0 +1,222 @@
+#include "batch.hpp"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  #define EDACAL_BATCH_SIMD 1
+  #include <immintrin.h>
+#endif
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+static const size_t kChunk = 256; // filas por bloque: el stack de bloques cabe en L1/L2
+static const size_t kMaxStackDoubles = 1<<22; // 32 MB: con programas muy profundos el bloque se achica
+
+// envoltorios de la libm (fallback escalar y filas especiales de los kernels)
+static double libSqrt(double a){ return std::sqrt(a); }
+static double libSin(double a){ return std::sin(a); }
+static double libCos(double a){ return std::cos(a); }
+static double libTan(double a){ return std::tan(a); }
+static double libLog10(double a){ return std::log10(a); }
+static double libLn(double a){ return std::log(a); }
+
+// -------------------- Kernels --------------------
+struct Kernels {
+    void (*add)(double*, const double*, size_t);
+    void (*sub)(double*, const double*, size_t);
+    void (*mul)(double*, const double*, size_t);
+    void (*div)(double*, const double*, size_t);
+    void (*neg)(double*, size_t);
+    void (*sqrt)(double*, size_t);
+    void (*powi)(double*, int, size_t);
+    void (*sin)(double*, size_t);
+    void (*cos)(double*, size_t);
+    void (*log10)(double*, size_t);
+    void (*ln)(double*, size_t);
+};
+
+namespace scalar {
+static void kAdd(double* a, const double* b, size_t n){ for(size_t i=0;i<n;++i) a[i]+=b[i]; }
+static void kSub(double* a, const double* b, size_t n){ for(size_t i=0;i<n;++i) a[i]-=b[i]; }
+static void kMul(double* a, const double* b, size_t n){ for(size_t i=0;i<n;++i) a[i]*=b[i]; }
+static void kDiv(double* a, const double* b, size_t n){ for(size_t i=0;i<n;++i) a[i]/=b[i]; }
+static void kNeg(double* a, size_t n){ for(size_t i=0;i<n;++i) a[i]=-a[i]; }
+static void kPowi(double* a, int k, size_t n){ for(size_t i=0;i<n;++i) a[i]=std::pow(a[i], (double)k); }
+template<double (*F)(double)> static void kMap(double* a, size_t n){ for(size_t i=0;i<n;++i) a[i]=F(a[i]); }
+static const Kernels table = { kAdd, kSub, kMul, kDiv, kNeg, kMap<libSqrt>, kPowi, kMap<libSin>, kMap<libCos>, kMap<libLog10>, kMap<libLn> };
+}
+
+#ifdef EDACAL_BATCH_SIMD
+// los vectores de 32 bytes solo pasan entre funciones static inline de este archivo
+#pragma GCC diagnostic ignored "-Wpsabi"
+namespace sse2 {
+  #define KATTR
+  #include "batch_kernels.inc"
+  #undef KATTR
+  static const Kernels table = { kAdd, kSub, kMul, kDiv, kNeg, kSqrt, kPowi, kSin, kCos, kLog10, kLn };
+}
+namespace avx2 {
+  #define KATTR __attribute__((target("avx2")))
+  #define KERNEL_AVX2
+  #include "batch_kernels.inc"
+  #undef KERNEL_AVX2
+  #undef KATTR
+  static const Kernels table = { kAdd, kSub, kMul, kDiv, kNeg, kSqrt, kPowi, kSin, kCos, kLog10, kLn };
+}
+#endif
+
+static const Kernels& kernelsFor(BatchEvaluator::Isa isa){
+#ifdef EDACAL_BATCH_SIMD
+    if(isa==BatchEvaluator::AVX2) return avx2::table;
+    if(isa==BatchEvaluator::SSE2) return sse2::table;
+#endif
+    (void)isa; return scalar::table;
+}
+
+bool BatchEvaluator::supported(Isa isa){
+    if(isa==Scalar) return true;
+#ifdef EDACAL_BATCH_SIMD
+    if(isa==SSE2) return true;
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+BatchEvaluator::Isa BatchEvaluator::best(){
+    if(supported(AVX2)) return AVX2;
+    if(supported(SSE2)) return SSE2;
+    return Scalar;
+}
+
+const char* BatchEvaluator::isaName(Isa isa){
+    switch(isa){ case AVX2: return "avx2"; case SSE2: return "sse2"; default: return "escalar"; }
+}
+
+// -------------------- Tabla CSV --------------------
+int Table::find(const string& name) const {
+    for(size_t i=0;i<names.size();++i) if(names[i]==name) return (int)i;
+    return -1;
+}
+
+static void splitCsv(const string& line, vector<string>& cells){
+    cells.clear();
+    size_t i=0;
+    while(true){
+        size_t j=line.find(',', i);
+        cells.push_back(trim(line.substr(i, j==string::npos ? string::npos : j-i)));
+        if(j==string::npos) break;
+        i=j+1;
+    }
+}
+
+Table readCsv(std::istream& in){
+    Table t; string line; vector<string> cells; size_t lineNo=0;
+    while(std::getline(in, line)){
+        ++lineNo;
+        if(trim(line).empty()) continue;
+        splitCsv(line, cells);
+        if(t.names.empty()){
+            for(const auto& c: cells){
+                if(c.empty() || !isAlphaC(c[0])) throw runtime_error("CSV: nombre de columna invalido: "+c);
+                t.names.push_back(c);
+            }
+            t.cols.resize(t.names.size());
+            continue;
+        }
+        if(cells.size()!=t.names.size()) throw runtime_error("CSV linea "+std::to_string(lineNo)+": cantidad de columnas distinta al encabezado");
+        for(size_t c=0;c<cells.size();++c){
+            const char* s=cells[c].c_str(); char* end=nullptr;
+            double v=std::strtod(s, &end);
+            if(cells[c].empty() || *end!='\0') throw runtime_error("CSV linea "+std::to_string(lineNo)+": valor invalido: "+cells[c]);
+            t.cols[c].push_back(v);
+        }
+        ++t.rows;
+    }
+    if(t.names.empty()) throw runtime_error("CSV vacio");
+    return t;
+}
+
+// -------------------- Ejecucion por bloques --------------------
+// marca el error en las filas que aun no tienen uno (el primero en orden de evaluacion gana)
+template<class Pred>
+static void check(const double* v, unsigned char* err, size_t len, ErrCode code, Pred bad){
+    for(size_t i=0;i<len;++i) if(bad(v[i]) && !err[i]) err[i]=(unsigned char)code;
+}
+
+void BatchEvaluator::run(const Program& p, const Table& t, vector<double>& out, vector<unsigned char>& err){
+    if(p.empty()) throw runtime_error("Arbol vacio");
+    const Kernels& k=kernelsFor(isa);
+    out.assign(t.rows, 0.0); err.assign(t.rows, 0);
+    bool undef=false;
+
+    // cada variable: columna de la tabla, o valor del entorno (pi, e, ans...), o no definida
+    vector<int> col(p.slots.size(), -1);
+    vector<double> fixed(p.slots.size(), 0.0);
+    vector<bool> defined(p.slots.size(), false);
+    for(size_t i=0;i<p.slots.size();++i){
+        col[i]=t.find(Symbols::name(p.slots[i]));
+        if(col[i]>=0){ defined[i]=true; continue; }
+        if(env && env->has(p.slots[i])){ fixed[i]=env->value(p.slots[i]); defined[i]=true; }
+    }
+
+    // filas por bloque: kChunk, salvo que la pila de bloques pase de kMaxStackDoubles
+    size_t depth=(size_t)(p.maxStack+p.temps);
+    size_t chunk=std::max<size_t>(4, std::min(kChunk, (kMaxStackDoubles/depth)&~(size_t)3));
+    stack.resize(depth*chunk);                             // temporales despues de la pila
+    double* temps=stack.data()+(size_t)p.maxStack*chunk;
+    for(size_t r0=0; r0<t.rows; r0+=chunk){
+        size_t len=std::min(chunk, t.rows-r0);
+        size_t n=(len+3)&~(size_t)3;             // los kernels trabajan de a 4 filas
+        unsigned char* e=&err[r0];
+        double* top=stack.data()-chunk;
+        for(size_t pc=0; pc<p.code.size(); ++pc){
+            const Instr& in=p.code[pc];
+            switch(in.op){
+                case OpCode::Const: top+=chunk; std::fill(top, top+n, in.num); break;
+                case OpCode::Var:
+                    top+=chunk;
+                    if(col[in.arg]>=0){
+                        const double* src=t.cols[col[in.arg]].data()+r0;
+                        std::copy(src, src+len, top); std::fill(top+len, top+n, 1.0);
+                    } else {
+                        std::fill(top, top+n, fixed[in.arg]);
+                        if(!defined[in.arg]){
+                            if(!undef){ undef=true; undefSlot=p.slots[in.arg]; }
+                            for(size_t i=0;i<len;++i) if(!e[i]) e[i]=(unsigned char)ErrCode::Undefined;
+                        }
+                    }
+                    break;
+                case OpCode::Pos:  break;
+                case OpCode::Neg:  k.neg(top, n); break;
+                case OpCode::Sqrt: check(top, e, len, ErrCode::SqrtNeg, [](double a){ return a<0; }); k.sqrt(top, n); break;
+                case OpCode::Sin:  k.sin(top, n); break;
+                case OpCode::Cos:  k.cos(top, n); break;
+                case OpCode::Tan:  for(size_t i=0;i<n;++i) top[i]=libTan(top[i]); break;
+                case OpCode::Log:  check(top, e, len, ErrCode::LogNonPos, [](double a){ return a<=0; }); k.log10(top, n); break;
+                case OpCode::Ln:   check(top, e, len, ErrCode::LnNonPos,  [](double a){ return a<=0; }); k.ln(top, n); break;
+                case OpCode::Add:  top-=chunk; k.add(top, top+chunk, n); break;
+                case OpCode::Sub:  top-=chunk; k.sub(top, top+chunk, n); break;
+                case OpCode::Mul:  top-=chunk; k.mul(top, top+chunk, n); break;
+                case OpCode::Div:
+                    check(top, e, len, ErrCode::DivZero, [](double b){ return b==0; });
+                    top-=chunk; k.div(top, top+chunk, n); break;
+                case OpCode::Pow: {
+                    // exponente constante entero (x^2, x^-1...): multiplicaciones vectoriales
+                    const Instr* prev = pc>0 ? &p.code[pc-1] : nullptr;
+                    top-=chunk;
+                    if(prev && prev->op==OpCode::Const && prev->num==std::floor(prev->num) && std::fabs(prev->num)<=64)
+                        k.powi(top, (int)prev->num, n);
+                    else
+                        for(size_t i=0;i<n;++i) top[i]=std::pow(top[i], top[i+chunk]);
+                    break;
+                }
+                case OpCode::Save: std::copy(top, top+n, temps+(size_t)in.arg*chunk); break;
+                case OpCode::Load: top+=chunk; std::copy(temps+(size_t)in.arg*chunk, temps+(size_t)in.arg*chunk+n, top); break;
+            }
+        }
+        std::copy(top, top+len, out.begin()+r0);
+    }
+}
@@ -0,0 +1,90 @@
+#include "bytecode.hpp"
+
+using std::string;
+using std::runtime_error;
+
+// Post-orden desde la raiz; en un arbol sale el mismo orden que el pool.
+// Un nodo compartido se emite la primera vez que se lo alcanza: los errores
+// siguen apareciendo en el mismo orden que al evaluar el arbol sin optimizar.
+Program Compiler::compile(const ExprTree& t){
+    if(t.empty()) throw runtime_error("Arbol vacio");
+    Program p; p.slots=t.slots;
+    const uint32_t kNone=ExprTree::kNone;
+    uses.assign(t.nodes.size(), 0);
+    size_t edges=0;
+    for(const ExprNode& n: t.nodes){
+        if(n.left!=kNone){ ++uses[n.left]; ++edges; }
+        if(n.right!=kNone){ ++uses[n.right]; ++edges; }
+    }
+    // cota: una instruccion por arista (Load o una hoja repetida), la raiz y un Save por nodo
+    p.code.reserve(edges+1+(edges<t.nodes.size() ? 0 : t.nodes.size()));
+    slot.assign(t.nodes.size(), -1);
+    int depth=0;
+    auto emit=[&](OpCode op, int arg, double num){
+        Instr in; in.op=op; in.arg=arg; in.num=num;
+        if(isLeafOp(op) || op==OpCode::Load){ if(++depth>p.maxStack) p.maxStack=depth; }
+        else if(isBinaryOp(op)) --depth;
+        p.code.push_back(in);
+    };
+
+    work.clear(); work.push_back(Frame{t.root, 0});
+    while(!work.empty()){
+        Frame f=work.back();
+        const ExprNode& n=t.nodes[f.node];
+        if(f.state==0){
+            if(slot[f.node]>=0){ emit(OpCode::Load, slot[f.node], 0.0); work.pop_back(); continue; }
+            if(n.op==OpCode::Const){ emit(OpCode::Const, 0, n.num); work.pop_back(); continue; }
+            if(n.op==OpCode::Var){ emit(OpCode::Var, (int)n.name, 0.0); work.pop_back(); continue; }
+            work.back().state=1;
+            if(n.left!=kNone){ work.push_back(Frame{n.left, 0}); continue; }
+        }
+        if(work.back().state==1){ work.back().state=2; work.push_back(Frame{n.right, 0}); continue; }
+        work.pop_back();
+        if(n.op==OpCode::Pos) continue;      // +a no cambia el valor
+        emit(n.op, 0, 0.0);
+        if(uses[f.node]>1){ slot[f.node]=p.temps++; emit(OpCode::Save, slot[f.node], 0.0); }
+    }
+    return p;
+}
+
+// un error sale por fail con el codigo y el slot (si es una variable); la posicion es la instruccion
+double VM::run(const Program& p, Error& e){
+    ErrCode code; uint32_t arg=0;
+    e.clear();
+    if(p.empty()){ e.set(ErrCode::EmptyTree, Error::kNoPos); return 0.0; }
+    if((int)stack.size()<p.maxStack) stack.resize(p.maxStack);
+    if((int)temps.size()<p.temps) temps.resize(p.temps);
+    double* sp=stack.data()-1; // sp apunta al tope
+    const Instr* pc=p.code.data();
+    const Instr* end=pc+p.code.size();
+    for(; pc!=end; ++pc){
+        switch(pc->op){
+            case OpCode::Const: *++sp=pc->num; break;
+            case OpCode::Var: {
+                uint32_t slot=p.slots[pc->arg];
+                if(!env){ code=ErrCode::Unsupported; arg=slot; goto fail; }
+                if(!env->has(slot)){ code=ErrCode::Undefined; arg=slot; goto fail; }
+                *++sp=env->value(slot); break;
+            }
+            case OpCode::Neg:  *sp=-*sp; break;
+            case OpCode::Pos:  break;
+            case OpCode::Sqrt: if(*sp<0){ code=ErrCode::SqrtNeg; goto fail; } *sp=std::sqrt(*sp); break;
+            case OpCode::Sin:  *sp=std::sin(*sp); break;
+            case OpCode::Cos:  *sp=std::cos(*sp); break;
+            case OpCode::Tan:  *sp=std::tan(*sp); break;
+            case OpCode::Log:  if(*sp<=0){ code=ErrCode::LogNonPos; goto fail; } *sp=std::log10(*sp); break;
+            case OpCode::Ln:   if(*sp<=0){ code=ErrCode::LnNonPos; goto fail; }  *sp=std::log(*sp); break;
+            case OpCode::Add: { double b=*sp--; *sp=*sp+b; break; }
+            case OpCode::Sub: { double b=*sp--; *sp=*sp-b; break; }
+            case OpCode::Mul: { double b=*sp--; *sp=*sp*b; break; }
+            case OpCode::Div: { double b=*sp--; if(b==0){ code=ErrCode::DivZero; goto fail; } *sp=*sp/b; break; }
+            case OpCode::Pow: { double b=*sp--; *sp=std::pow(*sp,b); break; }
+            case OpCode::Save: temps[pc->arg]=*sp; break;
+            case OpCode::Load: *++sp=temps[pc->arg]; break;
+        }
+    }
+    return *sp;
+fail:
+    e.set(code, (uint32_t)(pc-p.code.data()), arg);
+    return 0.0;
+}
@@ -0,0 +1,57 @@
+#include "evaluator.hpp"
+
+using std::string;
+
+// el primer nodo que falla en post-orden corta el recorrido: mismo error que el recursivo
+double Evaluator::eval(const ExprTree& t, Error& e){
+    e.clear();
+    if(t.empty()){ e.set(ErrCode::EmptyTree, Error::kNoPos); return 0.0; }
+    vals.resize(t.nodes.size());
+    for(size_t i=0;i<t.nodes.size();++i){
+        ErrCode c=evalNode(t, t.nodes[i], vals[i]);
+        if(c!=ErrCode::None){
+            const ExprNode& n=t.nodes[i];
+            uint32_t arg = n.op==OpCode::Var ? t.slots[n.name] : c==ErrCode::BadOp ? (uint32_t)n.op : 0;
+            e.set(c, (uint32_t)i, arg);
+            return 0.0;
+        }
+    }
+    return vals[t.root];
+}
+
+ErrCode Evaluator::evalNode(const ExprTree& t, const ExprNode& n, double& r){
+    if(n.op==OpCode::Const){ r=n.num; return ErrCode::None; }
+    if(n.op==OpCode::Var){
+        uint32_t slot=t.slots[n.name];
+        if(!env) return ErrCode::Unsupported;
+        if(!env->has(slot)) return ErrCode::Undefined;
+        r=env->value(slot); return ErrCode::None;
+    }
+    // Operadores
+    if(!isBinaryOp(n.op)){
+        double a = vals[n.right];
+        switch(n.op){
+            case OpCode::Neg:  r=-a; break;
+            case OpCode::Pos:  r=+a; break;
+            case OpCode::Sqrt: if(a<0) return ErrCode::SqrtNeg; r=std::sqrt(a); break;
+            case OpCode::Sin:  r=std::sin(a); break;
+            case OpCode::Cos:  r=std::cos(a); break;
+            case OpCode::Tan:  r=std::tan(a); break;
+            case OpCode::Log:  if(a<=0) return ErrCode::LogNonPos; r=std::log10(a); break;
+            case OpCode::Ln:   if(a<=0) return ErrCode::LnNonPos;  r=std::log(a); break;
+            default: return ErrCode::BadOp;
+        }
+    } else {
+        double a = vals[n.left];
+        double b = vals[n.right];
+        switch(n.op){
+            case OpCode::Add: r=a+b; break;
+            case OpCode::Sub: r=a-b; break;
+            case OpCode::Mul: r=a*b; break;
+            case OpCode::Div: if(b==0) return ErrCode::DivZero; r=a/b; break;
+            case OpCode::Pow: r=std::pow(a,b); break;
+            default: return ErrCode::BadOp;
+        }
+    }
+    return ErrCode::None;
+}
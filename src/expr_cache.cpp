@@ -0,0 +1,61 @@
+#include "expr_cache.hpp"
+#include "stats.hpp"
+
+using std::string;
+
+static inline bool isWordC(char c){ return isAlphaC(c) || isDigitC(c) || c=='.'; }
+
+void ExprCache::normalize(const string& expr, string& out){
+    out.clear(); out.reserve(expr.size());
+    bool pendingSpace=false;
+    for(char c: expr){
+        if(isSpace(c)){ pendingSpace=true; continue; }
+        if(pendingSpace && !out.empty() && isWordC(out.back()) && isWordC(c)) out.push_back(' ');
+        pendingSpace=false;
+        out.push_back(c);
+    }
+}
+
+// el arbol se arma en el de sy y se copia: el de la entrada pide memoria una vez, justa
+CompiledPtr compileExpr(const string& expr, ShuntingYard& sy, Optimizer& opt, Compiler& comp, Error& e){
+    stats::Timer tp(stats::Parse);
+    const ExprTree& tree = sy.parse(expr, e);
+    tp.stop();
+    stats::count(stats::Tokens, sy.tokens());
+    if(e.lexical()) return CompiledPtr();
+    stats::count(stats::Nodes, tree.nodes.size());
+    CompiledPtr c=std::make_shared<CompiledExpr>();
+    c->tree = tree;
+    if(e){ c->buildError=e; e.clear(); return c; }
+    stats::Timer tc(stats::Compile);
+    opt.run(c->tree, c->optTree);
+    c->prog = comp.compile(c->optTree);
+    return c;
+}
+
+CompiledPtr ExprCache::find(const string& key){
+    auto it=index.find(key);
+    if(it==index.end()){ ++misses; return CompiledPtr(); }
+    ++hits;
+    order.splice(order.begin(), order, it->second);
+    return it->second->second;
+}
+
+void ExprCache::insert(const string& key, const CompiledPtr& c){
+    if(cap==0) return;
+    auto it=index.find(key);
+    if(it!=index.end()){ it->second->second=c; order.splice(order.begin(), order, it->second); return; }
+    order.emplace_front(key, c);
+    index[key]=order.begin();
+    trimTo(cap);
+}
+
+void ExprCache::trimTo(size_t n){
+    while(index.size()>n){
+        index.erase(order.back().first);
+        order.pop_back();
+        ++evictions;
+    }
+}
+
+void ExprCache::setCapacity(size_t n){ cap=n; trimTo(n); }
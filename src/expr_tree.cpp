@@ -0,0 +1,96 @@
+#include "expr_tree.hpp"
+#include "symbols.hpp"
+#include <cstdio>
+
+using std::string;
+
+const uint32_t ExprTree::kNone;
+
+uint32_t ExprTree::nameIndex(uint32_t sym){
+    for(size_t i=0;i<slots.size();++i) if(slots[i]==sym) return (uint32_t)i;
+    slots.push_back(sym); return (uint32_t)slots.size()-1;
+}
+
+void ExprTree::push(const Token& t, uint32_t pos){
+    if(t.type!=TokenType::Number && t.type!=TokenType::Identifier && t.type!=TokenType::Operator) return;
+    ExprNode n; n.num=0.0; n.left=n.right=kNone; n.name=kNone;
+    opFromToken(t, n.op);
+    if(n.op==OpCode::Const) n.num=t.value;
+    else if(n.op==OpCode::Var) n.name=nameIndex(t.sym);
+    else if(pending) {}
+    else if(t.unary()){
+        if(work.empty()) pending.set(ErrCode::UnaryMissing, pos);
+        else { n.right=work.back(); work.pop_back(); }
+    } else {
+        if(work.size()<2) pending.set(ErrCode::BinaryMissing, pos);
+        else { n.right=work.back(); work.pop_back(); n.left=work.back(); work.pop_back(); }
+    }
+    if(!pending) work.push_back((uint32_t)nodes.size());
+    nodes.push_back(n);
+}
+
+bool ExprTree::finish(Error& e, uint32_t end){
+    if(!pending && work.size()!=1) pending.set(ErrCode::Invalid, end);
+    if(!pending){ root=work.back(); work.clear(); return true; }
+    e=pending; pending.clear(); root=kNone; work.clear();
+    return false;
+}
+
+void ExprTree::buildFromPostfix(const std::vector<Token>& post){
+    start();
+    // un arbol nuevo pide memoria una sola vez para nodos y otra para nombres
+    nodes.reserve(post.size());
+    size_t names=0;
+    for(const auto& t: post) names += t.type==TokenType::Identifier;
+    slots.reserve(names);
+    for(size_t i=0;i<post.size();++i) push(post[i], (uint32_t)i);    // posicion: indice en la posfija
+    Error e;
+    if(!finish(e, (uint32_t)post.size())) e.raise();
+}
+
+// los recorridos usan una pila explicita: la profundidad del arbol no toca la pila nativa
+void ExprTree::printPrefix(std::ostream& os, uint32_t n) const {
+    SmallVector<uint32_t, 64> st;
+    if(n!=kNone) st.push_back(n);
+    while(!st.empty()){
+        const ExprNode& x=nodes[st.back()]; st.pop_back();
+        os << nodeToStr(x) << ' ';
+        if(x.right!=kNone) st.push_back(x.right);
+        if(x.left!=kNone) st.push_back(x.left);
+    }
+}
+// el pool esta en post-orden: la posfija es el arreglo en orden
+void ExprTree::printPostfix(std::ostream& os) const { for(const auto& x: nodes) os << nodeToStr(x) << ' '; }
+// in-orden invertido (derecha, nodo, izquierda): se baja por la derecha apilando y al
+// desapilar se imprime el nodo y se sigue por su hijo izquierdo
+void ExprTree::printTree(std::ostream& os, uint32_t n, int depth) const {
+    struct Item { uint32_t node; int depth; };
+    SmallVector<Item, 64> st;
+    for(;;){
+        for(; n!=kNone; n=nodes[n].right) st.push_back(Item{n, depth++});
+        if(st.empty()) return;
+        Item it=st.back(); st.pop_back();
+        os << string(2*it.depth, ' ') << nodeToStr(nodes[it.node]) << "\n";
+        n=nodes[it.node].left; depth=it.depth+1;
+    }
+}
+
+// igual que os<<v con la precision por defecto (%g), sin armar un ostringstream por nodo
+string ExprTree::numToStr(double v){ char b[32]; int n=snprintf(b, sizeof b, "%g", v); return string(b, (size_t)n); }
+
+string ExprTree::nodeToStr(const ExprNode& n) const {
+    if(n.op==OpCode::Const) return numToStr(n.num);
+    if(n.op==OpCode::Var) return Symbols::name(slots[n.name]);
+    return opText(n.op);
+}
+
+string ExprTree::tokenToStr(const Token& t){
+    switch(t.type){
+        case TokenType::Number: return numToStr(t.value);
+        case TokenType::Identifier: return Symbols::name(t.sym);
+        case TokenType::Operator: return opText(t.op);
+        case TokenType::LParen: return "(";
+        case TokenType::RParen: return ")";
+        default: return "?";
+    }
+}
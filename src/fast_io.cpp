@@ -0,0 +1,137 @@
+#include "fast_io.hpp"
+#include <cstring>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+#endif
+
+using std::string;
+
+// -------------------- MappedFile --------------------
+
+#ifdef _WIN32
+bool MappedFile::open(const string& path){
+    close();
+    HANDLE h=CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(h==INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz; if(!GetFileSizeEx(h, &sz)){ CloseHandle(h); return false; }
+    file=h; len=(size_t)sz.QuadPart;
+    if(len==0) return true;                      // un archivo vacio no se puede mapear
+    mapping=CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping){ close(); return false; }
+    ptr=(const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!ptr){ close(); return false; }
+    return true;
+}
+void MappedFile::close(){
+    if(ptr) UnmapViewOfFile(ptr);
+    if(mapping) CloseHandle(mapping);
+    if(file) CloseHandle(file);
+    ptr=nullptr; mapping=nullptr; file=nullptr; len=0;
+}
+#else
+bool MappedFile::open(const string& path){
+    close();
+    int fd=::open(path.c_str(), O_RDONLY);
+    if(fd<0) return false;
+    struct stat st;
+    if(fstat(fd, &st)!=0){ ::close(fd); return false; }
+    len=(size_t)st.st_size;
+    if(len>0){
+        void* m=mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m==MAP_FAILED){ ::close(fd); len=0; return false; }
+        madvise(m, len, MADV_SEQUENTIAL);
+        ptr=(const char*)m;
+    }
+    ::close(fd);                                 // el mapeo sigue valido sin el descriptor
+    return true;
+}
+void MappedFile::close(){
+    if(ptr) munmap((void*)ptr, len);
+    ptr=nullptr; len=0;
+}
+#endif
+
+// -------------------- formatFixed10 --------------------
+
+static size_t formatSlow(double v, char* out){ return (size_t)std::snprintf(out, kFixed10Max, "%.10f", v); }
+
+#ifdef __SIZEOF_INT128__
+typedef unsigned __int128 u128;
+
+// q = valor*10^10 ya redondeado: parte entera, punto y 10 decimales
+static size_t writeScaled(bool neg, u128 q, char* out){
+    const uint64_t kScale=10000000000ULL;
+    uint64_t frac; char tmp[48]; int n=0;
+    if((uint64_t)(q>>64)==0){                    // lo comun: alcanza con 64 bits (sin divisiones de 128)
+        uint64_t q64=(uint64_t)q, ip=q64/kScale; frac=q64%kScale;
+        do{ tmp[n++]=(char)('0'+ip%10); ip/=10; } while(ip);
+    } else {
+        u128 ip=q/kScale; frac=(uint64_t)(q%kScale);
+        do{ tmp[n++]=(char)('0'+(int)(ip%10)); ip/=10; } while(ip);
+    }
+    char* p=out;
+    if(neg) *p++='-';
+    while(n) *p++=tmp[--n];
+    *p++='.';
+    for(int i=9;i>=0;--i){ p[i]=(char)('0'+frac%10); frac/=10; }
+    return (size_t)(p+10-out);
+}
+
+size_t formatFixed10(double v, char* out){
+    uint64_t bits; std::memcpy(&bits, &v, 8);
+    bool neg = (bits>>63)!=0;
+    int exp = (int)((bits>>52)&0x7FF);
+    uint64_t mant = bits & ((1ULL<<52)-1);
+    if(exp==0x7FF) return formatSlow(v, out);    // inf / nan
+    if(exp==0){ if(mant==0) return writeScaled(neg, 0, out); exp=1; }
+    else mant |= 1ULL<<52;
+    int e = exp-1075;                            // v = mant * 2^e
+    if(e>=0){
+        if(e>40) return formatSlow(v, out);      // mant*2^e*10^10 ya no entra en 128 bits
+        return writeScaled(neg, ((u128)mant<<e)*10000000000ULL, out);
+    }
+    int k=-e;
+    u128 p=(u128)mant*10000000000ULL;            // < 2^87
+    if(k>=120) return writeScaled(neg, 0, out);  // p/2^k < 1/2: redondea a 0
+    u128 q=p>>k, rem=p-(q<<k), half=(u128)1<<(k-1);
+    if(rem>half || (rem==half && (q&1))) ++q;    // al mas cercano, empates al par (como printf)
+    return writeScaled(neg, q, out);
+}
+#else
+size_t formatFixed10(double v, char* out){ return formatSlow(v, out); }
+#endif
+
+// -------------------- BlockWriter --------------------
+
+BlockWriter::BlockWriter(FILE* f, size_t block):f(f),buf(block){ setp(buf.data(), buf.data()+buf.size()); }
+
+void BlockWriter::flushBlock(){
+    size_t n=(size_t)(pptr()-pbase());
+    if(n) std::fwrite(pbase(), 1, n, f);
+    setp(buf.data(), buf.data()+buf.size());
+}
+
+BlockWriter::int_type BlockWriter::overflow(int_type c){
+    flushBlock();
+    if(!traits_type::eq_int_type(c, traits_type::eof())){ *pptr()=(char)c; pbump(1); }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize BlockWriter::xsputn(const char* s, std::streamsize n){
+    std::streamsize done=0;
+    while(done<n){
+        std::streamsize room=epptr()-pptr();
+        if(room==0){ flushBlock(); room=epptr()-pptr(); }
+        std::streamsize k=std::min(room, n-done);
+        std::memcpy(pptr(), s+done, (size_t)k);
+        pbump((int)k); done+=k;
+    }
+    return n;
+}
+
+int BlockWriter::sync(){ flushBlock(); std::fflush(f); return 0; }
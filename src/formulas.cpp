@@ -0,0 +1,134 @@
+#include "formulas.hpp"
+
+using std::string;
+using std::vector;
+
+uint32_t FormulaGraph::idOf(uint32_t slot){
+    int found=lookup(slot);
+    if(found>=0) return (uint32_t)found;
+    uint32_t id=(uint32_t)nodes.size();
+    nodes.push_back(Node()); nodes.back().slot=slot;
+    parent.push_back(0);
+    if(slot>=ids.size()) ids.resize((size_t)slot+1, Symbols::kNone);
+    ids[slot]=id;
+    return id;
+}
+
+bool FormulaGraph::isFormula(uint32_t slot) const { int id=lookup(slot); return id>=0 && nodes[id].formula; }
+
+FormulaGraph::Formula* FormulaGraph::find(uint32_t slot){
+    int id=lookup(slot);
+    return id>=0 && nodes[id].formula ? &nodes[id].f : nullptr;
+}
+
+const FormulaGraph::Formula* FormulaGraph::find(uint32_t slot) const {
+    int id=lookup(slot);
+    return id>=0 && nodes[id].formula ? &nodes[id].f : nullptr;
+}
+
+bool FormulaGraph::reactive(uint32_t slot) const {
+    int id=lookup(slot);
+    return id>=0 && (nodes[id].formula || !nodes[id].dependents.empty());
+}
+
+void FormulaGraph::unlink(uint32_t id){
+    for(uint32_t in: nodes[id].inputs){
+        vector<uint32_t>& d=nodes[in].dependents;
+        d.erase(std::find(d.begin(), d.end(), id));
+    }
+    nodes[id].inputs.clear();
+}
+
+void FormulaGraph::remove(uint32_t slot){
+    int id=lookup(slot);
+    if(id<0 || !nodes[id].formula) return;
+    unlink((uint32_t)id);
+    nodes[id].formula=false; nodes[id].f=Formula();
+    --count;
+}
+
+void FormulaGraph::detach(){
+    for(Node& n: nodes){
+        if(!n.formula || !n.f.ce) continue;
+        n.f.ce=std::make_shared<CompiledExpr>(*n.f.ce);
+        n.f.ce->jit=JitSlot();
+    }
+}
+
+// hay ciclo si alguna entrada nueva ya depende (transitivamente) de slot
+bool FormulaGraph::define(uint32_t slot, const string& source, const CompiledPtr& ce, string& cycle){
+    uint32_t id=idOf(slot);
+    vector<uint32_t> inputs;
+    for(uint32_t in: ce->tree.slots){ uint32_t i=idOf(in); if(std::find(inputs.begin(), inputs.end(), i)==inputs.end()) inputs.push_back(i); }
+
+    ++epoch;
+    for(uint32_t i: inputs) nodes[i].changed=epoch;   // aca "changed" marca las entradas buscadas
+    int hit = nodes[id].changed==epoch ? (int)id : -1;
+    order.clear(); order.push_back(id); nodes[id].seen=epoch;
+    for(size_t k=0; k<order.size() && hit<0; ++k){
+        for(uint32_t d: nodes[order[k]].dependents){
+            if(nodes[d].seen==epoch) continue;
+            nodes[d].seen=epoch; parent[d]=order[k]; order.push_back(d);
+            if(nodes[d].changed==epoch){ hit=(int)d; break; }
+        }
+    }
+    if(hit>=0){
+        cycle=Symbols::name(slot);
+        for(uint32_t at=(uint32_t)hit; ; at=parent[at]){ cycle+=" -> "+Symbols::name(nodes[at].slot); if(at==id) break; }
+        return false;
+    }
+
+    if(nodes[id].formula) unlink(id); else ++count;
+    nodes[id].formula=true;
+    nodes[id].f.source=source; nodes[id].f.ce=ce;
+    nodes[id].inputs=inputs;
+    for(uint32_t i: inputs) nodes[i].dependents.push_back(id);
+    return true;
+}
+
+// DFS iterativo por dependents: la post-orden invertida es un orden topologico del
+// subgrafo alcanzable. Una formula se recalcula solo si alguna entrada cambio de verdad.
+void FormulaGraph::propagate(const uint32_t* changed, size_t nChanged, const Recompute& fn){
+    if(count==0) return;
+    ++epoch;
+    order.clear();
+    for(size_t i=0;i<nChanged;++i){
+        int root=lookup(changed[i]);
+        if(root<0 || nodes[root].dependents.empty()) continue;
+        nodes[root].changed=epoch;
+        if(nodes[root].seen==epoch) continue;
+        nodes[root].seen=epoch;
+        work.clear(); work.push_back(Frame{(uint32_t)root, 0});
+        while(!work.empty()){
+            Frame& f=work.back();
+            const vector<uint32_t>& deps=nodes[f.id].dependents;
+            if(f.next<deps.size()){
+                uint32_t d=deps[f.next++];
+                if(nodes[d].seen!=epoch){ nodes[d].seen=epoch; work.push_back(Frame{d, 0}); }
+                continue;
+            }
+            order.push_back(f.id);
+            work.pop_back();
+        }
+    }
+    for(size_t k=order.size(); k-- > 0; ){
+        Node& n=nodes[order[k]];
+        if(!n.formula || n.changed==epoch) continue;          // raices: ya tienen su valor nuevo
+        bool dirty=false;
+        for(uint32_t in: n.inputs) if(nodes[in].changed==epoch){ dirty=true; break; }
+        if(dirty && fn(n.slot, n.f)) n.changed=epoch;
+    }
+}
+
+vector<uint32_t> FormulaGraph::dependentsOf(uint32_t slot) const {
+    vector<uint32_t> out; int id=lookup(slot);
+    if(id>=0) for(uint32_t d: nodes[id].dependents) out.push_back(nodes[d].slot);
+    return out;
+}
+
+vector<uint32_t> FormulaGraph::list() const {
+    vector<uint32_t> out;
+    for(const Node& n: nodes) if(n.formula) out.push_back(n.slot);
+    std::sort(out.begin(), out.end(), [](uint32_t a, uint32_t b){ return Symbols::name(a) < Symbols::name(b); });
+    return out;
+}
@@ -0,0 +1,232 @@
+#include "jit.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define EDACAL_JIT_X64 1
+  #ifdef _WIN32
+    #include <windows.h>
+  #else
+    #include <sys/mman.h>
+  #endif
+#endif
+
+using std::string;
+using std::vector;
+
+enum JitError { JIT_OK=0, JIT_DIV=1, JIT_SQRT=2, JIT_LOG=3, JIT_LN=4 };
+
+static ErrCode errorCode(int err){
+    switch(err){
+        case JIT_DIV:  return ErrCode::DivZero;
+        case JIT_SQRT: return ErrCode::SqrtNeg;
+        case JIT_LOG:  return ErrCode::LogNonPos;
+        case JIT_LN:   return ErrCode::LnNonPos;
+        default:       return ErrCode::BadOp;
+    }
+}
+
+const char* JitFunction::errorMessage(int err){
+    switch(err){
+        case JIT_DIV:  return "division por cero";
+        case JIT_SQRT: return "sqrt de negativo";
+        case JIT_LOG:  return "log de no-positivo";
+        case JIT_LN:   return "ln de no-positivo";
+        default:       return "error JIT";
+    }
+}
+
+#ifdef EDACAL_JIT_X64
+
+// envoltorios con firma fija: llaman a la misma libm que la VM
+static double jitSin(double a){ return std::sin(a); }
+static double jitCos(double a){ return std::cos(a); }
+static double jitTan(double a){ return std::tan(a); }
+static double jitLog10(double a){ return std::log10(a); }
+static double jitLn(double a){ return std::log(a); }
+static double jitPow(double a, double b){ return std::pow(a,b); }
+
+namespace {
+
+// Emisor minimo. Pila de valores en memoria: slot i en [rsp + base + 8*i].
+// rbx = puntero a vars, r12 = puntero a err.
+struct Emitter {
+    vector<unsigned char> b;
+    struct Fixup { size_t at; int err; };
+    vector<Fixup> fixups;
+
+    void byte(unsigned v){ b.push_back((unsigned char)v); }
+    void bytes(std::initializer_list<unsigned> l){ for(unsigned v: l) byte(v); }
+    void imm32(int32_t v){ for(int i=0;i<4;++i) byte((uint32_t)v>>(8*i)); }
+    void imm64(uint64_t v){ for(int i=0;i<8;++i) byte((unsigned)(v>>(8*i))); }
+
+    // op xmm, [rsp+disp] (prefijo, 0F, opcode)
+    void sseRsp(unsigned prefix, unsigned opc, int xmm, int32_t disp){
+        bytes({prefix, 0x0F, opc, 0x84u|(unsigned)(xmm<<3), 0x24}); imm32(disp);
+    }
+    void loadSlot(int xmm, int32_t disp){ sseRsp(0xF2, 0x10, xmm, disp); }   // movsd xmm,[rsp+d]
+    void storeSlot(int xmm, int32_t disp){ sseRsp(0xF2, 0x11, xmm, disp); }  // movsd [rsp+d],xmm
+    void loadVar(int xmm, int32_t disp){ bytes({0xF2, 0x0F, 0x10, 0x83u|(unsigned)(xmm<<3)}); imm32(disp); } // movsd xmm,[rbx+d]
+    void movRaxImm(uint64_t v){ bytes({0x48, 0xB8}); imm64(v); }
+    void storeRax(int32_t disp){ bytes({0x48, 0x89, 0x84, 0x24}); imm32(disp); }      // mov [rsp+d],rax
+    void xorRax(int32_t disp){ bytes({0x48, 0x31, 0x84, 0x24}); imm32(disp); }        // xor [rsp+d],rax
+    void callAbs(const void* fn){ movRaxImm((uint64_t)(uintptr_t)fn); bytes({0xFF, 0xD0}); }
+    void zeroXmm2(){ bytes({0x66, 0x0F, 0x57, 0xD2}); }                            // xorpd xmm2,xmm2
+    void ucomis(int a, int c){ bytes({0x66, 0x0F, 0x2E, 0xC0u|(unsigned)(a<<3)|(unsigned)c}); }
+    // salto condicional a la salida de error; NaN (PF=1) nunca es error
+    void jumpIfError(unsigned jcc, int err){
+        bytes({0x7A, 0x06});                    // jp +6 (salta el jcc rel32)
+        bytes({0x0F, jcc}); fixups.push_back(Fixup{b.size(), err}); imm32(0);
+    }
+};
+
+typedef double (*Unary)(double);
+
+} // namespace
+
+bool JitFunction::supported(){ return true; }
+
+// la pila de valores vive en el frame nativo: mas alla de 256 KB el programa se queda en la VM
+static const int kMaxFrameSlots = 1<<15;
+
+bool JitFunction::compile(const Program& p){
+    if(p.empty() || p.maxStack+p.temps>kMaxFrameSlots) return false;
+#ifdef _WIN32
+    const int32_t shadow=32;
+#else
+    const int32_t shadow=0;
+#endif
+    int32_t frame = shadow + 8*(p.maxStack+p.temps);   // pila de valores y despues los temporales
+    frame = (frame+15)&~15;
+    Emitter e;
+    // prologo: 3 pushes dejan rsp alineado a 16
+    e.bytes({0x53, 0x41, 0x54, 0x41, 0x55});            // push rbx; push r12; push r13
+#ifdef _WIN32
+    e.bytes({0x48, 0x89, 0xCB, 0x49, 0x89, 0xD4});      // mov rbx,rcx; mov r12,rdx
+#else
+    e.bytes({0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4});      // mov rbx,rdi; mov r12,rsi
+#endif
+    e.bytes({0x48, 0x81, 0xEC}); e.imm32(frame);         // sub rsp,frame
+
+    auto slot=[&](int i){ return shadow + 8*i; };
+    int sp=-1;
+    for(const Instr& in: p.code){
+        switch(in.op){
+            case OpCode::Const: { uint64_t bits; std::memcpy(&bits, &in.num, 8); e.movRaxImm(bits); e.storeRax(slot(++sp)); break; }
+            case OpCode::Var:   e.loadVar(0, 8*in.arg); e.storeSlot(0, slot(++sp)); break;
+            case OpCode::Pos:   break;
+            case OpCode::Neg:   e.movRaxImm(0x8000000000000000ULL); e.xorRax(slot(sp)); break;
+            case OpCode::Sqrt:
+                e.loadSlot(0, slot(sp)); e.zeroXmm2(); e.ucomis(0, 2); e.jumpIfError(0x82, JIT_SQRT); // jb
+                e.bytes({0xF2, 0x0F, 0x51, 0xC0});      // sqrtsd xmm0,xmm0
+                e.storeSlot(0, slot(sp)); break;
+            case OpCode::Log: case OpCode::Ln:
+                e.loadSlot(0, slot(sp)); e.zeroXmm2(); e.ucomis(0, 2);
+                e.jumpIfError(0x86, in.op==OpCode::Log ? JIT_LOG : JIT_LN); // jbe
+                e.callAbs((const void*)(in.op==OpCode::Log ? (Unary)jitLog10 : (Unary)jitLn));
+                e.storeSlot(0, slot(sp)); break;
+            case OpCode::Sin: case OpCode::Cos: case OpCode::Tan: {
+                Unary fn = in.op==OpCode::Sin ? jitSin : in.op==OpCode::Cos ? jitCos : jitTan;
+                e.loadSlot(0, slot(sp)); e.callAbs((const void*)fn); e.storeSlot(0, slot(sp)); break;
+            }
+            case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div: {
+                --sp;
+                unsigned opc = in.op==OpCode::Add ? 0x58 : in.op==OpCode::Sub ? 0x5C : in.op==OpCode::Mul ? 0x59 : 0x5E;
+                if(in.op==OpCode::Div){
+                    e.loadSlot(1, slot(sp+1)); e.zeroXmm2(); e.ucomis(1, 2); e.jumpIfError(0x84, JIT_DIV); // je
+                }
+                e.loadSlot(0, slot(sp)); e.sseRsp(0xF2, opc, 0, slot(sp+1)); e.storeSlot(0, slot(sp));
+                break;
+            }
+            case OpCode::Pow:
+                --sp;
+                e.loadSlot(0, slot(sp)); e.loadSlot(1, slot(sp+1));
+                e.callAbs((const void*)jitPow); e.storeSlot(0, slot(sp)); break;
+            case OpCode::Save: e.loadSlot(0, slot(sp)); e.storeSlot(0, slot(p.maxStack+in.arg)); break;
+            case OpCode::Load: e.loadSlot(0, slot(p.maxStack+in.arg)); e.storeSlot(0, slot(++sp)); break;
+        }
+    }
+    e.loadSlot(0, slot(0));
+    size_t epilogue=e.b.size();
+    e.bytes({0x48, 0x81, 0xC4}); e.imm32(frame);         // add rsp,frame
+    e.bytes({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});      // pop r13; pop r12; pop rbx; ret
+
+    // salidas de error: *err = codigo; return 0.0
+    for(int err=JIT_DIV; err<=JIT_LN; ++err){
+        size_t stub=e.b.size(); bool used=false;
+        for(const auto& f: e.fixups) if(f.err==err){
+            int32_t rel=(int32_t)(stub-(f.at+4)); std::memcpy(&e.b[f.at], &rel, 4); used=true;
+        }
+        if(!used) continue;
+        e.bytes({0x41, 0xC7, 0x04, 0x24}); e.imm32(err); // mov dword [r12],err
+        e.bytes({0x66, 0x0F, 0x57, 0xC0});               // xorpd xmm0,xmm0
+        e.byte(0xE9); e.imm32((int32_t)(epilogue-(e.b.size()+4)));
+    }
+
+#ifdef _WIN32
+    void* m=VirtualAlloc(nullptr, e.b.size(), MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+    if(!m) return false;
+    std::memcpy(m, e.b.data(), e.b.size());
+    DWORD old; if(!VirtualProtect(m, e.b.size(), PAGE_EXECUTE_READ, &old)){ VirtualFree(m, 0, MEM_RELEASE); return false; }
+#else
+    void* m=mmap(nullptr, e.b.size(), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(m==MAP_FAILED) return false;
+    std::memcpy(m, e.b.data(), e.b.size());
+    if(mprotect(m, e.b.size(), PROT_READ|PROT_EXEC)!=0){ munmap(m, e.b.size()); return false; }
+#endif
+    mem=m; size=e.b.size();
+    return true;
+}
+
+JitFunction::~JitFunction(){
+    if(!mem) return;
+#ifdef _WIN32
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, size);
+#endif
+}
+
+double JitFunction::call(const double* vars, int* err) const {
+    typedef double (*Fn)(const double*, int*);
+    Fn fn; std::memcpy(&fn, &mem, sizeof fn);
+    return fn(vars, err);
+}
+
+#else // host sin soporte: siempre se usa la VM
+
+bool JitFunction::supported(){ return false; }
+bool JitFunction::compile(const Program&){ return false; }
+JitFunction::~JitFunction(){}
+double JitFunction::call(const double*, int* err) const { *err=-1; return 0.0; }
+
+#endif
+
+double Jit::eval(JitSlot& en, const Program& p, VM& vm, Error& e){
+    if(!env || !count(en, p)) return vm.run(p, e);
+    return call(*en.fn, p, *env, vm, e, vars);
+}
+
+bool Jit::count(JitSlot& en, const Program& p) const {
+    if(!JitFunction::supported()) return false;
+    if(!en.fn){
+        if(en.failed || ++en.hits<threshold) return false;
+        en.fn=std::make_shared<JitFunction>();
+        if(!en.fn->compile(p)){ en.fn.reset(); en.failed=true; return false; }
+    }
+    return true;
+}
+
+double Jit::call(const JitFunction& fn, const Program& p, const VarEnv& env, VM& vm, Error& e, std::vector<double>& vars){
+    // las variables se resuelven antes de entrar al codigo nativo;
+    // si falta alguna, la VM reporta el error en el mismo orden que el arbol
+    vars.resize(p.slots.size());
+    for(size_t i=0;i<p.slots.size();++i){
+        if(!env.has(p.slots[i])) return vm.run(p, e);
+        vars[i]=env.value(p.slots[i]);
+    }
+    int err=JIT_OK;
+    double r=fn.call(vars.data(), &err);
+    e.clear();
+    if(err) e.set(errorCode(err), Error::kNoPos);   // el codigo nativo no sabe la instruccion
+    return r;
+}
@@ -0,0 +1,73 @@
+#include "libedacal.hpp"
+#include "expr_cache.hpp"
+#include "session.hpp"
+
+namespace edacal {
+
+const char* statusName(Status s){
+    switch(s){
+        case Ok:                return "ok";
+        case SyntaxError:       return "error de sintaxis";
+        case UndefinedVariable: return "variable no definida";
+        case DivisionByZero:    return "division por cero";
+        case DomainError:       return "fuera de dominio";
+        case TooManyNames:      return "demasiados identificadores";
+        default:                return "error interno";
+    }
+}
+
+Status statusOf(const Error& e){
+    switch(e.code){
+        case ErrCode::None:        return Ok;
+        case ErrCode::Undefined: case ErrCode::Unsupported: return UndefinedVariable;
+        case ErrCode::DivZero:     return DivisionByZero;
+        case ErrCode::SqrtNeg: case ErrCode::LogNonPos: case ErrCode::LnNonPos: return DomainError;
+        case ErrCode::EmptyTree: case ErrCode::BadOp: case ErrCode::NoPrevious: return InternalError;
+        default:                   return SyntaxError;
+    }
+}
+
+Bindings::Bindings():vm(&env){
+    env.set("pi", 3.14159265358979323846);
+    env.set("e", 2.71828182845904523536);
+}
+Bindings::Bindings(const Bindings& o):env(o.env),vm(&env),last(o.last){}
+Bindings& Bindings::operator=(const Bindings& o){ env=o.env; last=o.last; return *this; }
+
+const string& Bindings::error() const { message=last.message(); return message; }
+
+Status Expression::compile(const string& source, Expression& out, string* message){
+    // un juego por hilo: compilar en paralelo no comparte buffers
+    static thread_local ShuntingYard sy;
+    static thread_local Optimizer opt;
+    static thread_local Compiler comp;
+    out.c.reset();
+    Error e;
+    CompiledPtr c;
+    try{ c=compileExpr(source, sy, opt, comp, e); }    // solo tabla de nombres llena o sin memoria
+    catch(const TooManySymbols& ex){ if(message) *message=ex.what(); return TooManyNames; }
+    catch(const std::exception& ex){ if(message) *message=ex.what(); return InternalError; }
+    if(c && c->buildError) e=c->buildError;
+    if(e){ if(message) *message=e.message(); return statusOf(e); }
+    out.c=c;
+    return Ok;
+}
+
+// sin excepciones ni strings: el texto se arma solo si se pide con Bindings::error()
+Status Expression::eval(Bindings& b, double& result) const {
+    if(!c){ b.last.set(ErrCode::EmptyTree, Error::kNoPos); return InternalError; }
+    Error e;
+    double r=b.vm.run(c->prog, e);
+    if(e){ b.last=e; return statusOf(e); }
+    result=r;
+    return Ok;
+}
+
+size_t Expression::variableCount() const { return c ? c->prog.slots.size() : 0; }
+uint32_t Expression::slot(size_t i) const { return c->prog.slots[i]; }
+
+void Expression::printPostfix(std::ostream& os) const { if(c) Session::printPostfix(os, c->tree); }
+void Expression::printPrefix(std::ostream& os) const { if(c){ c->tree.printPrefix(os, c->tree.root); os << "\n"; } }
+void Expression::printTree(std::ostream& os) const { if(c) c->tree.printTree(os, c->tree.root); }
+
+} // namespace edacal
@@ -0,0 +1,170 @@
+#include "optimizer.hpp"
+#include "small_vector.hpp"
+#include "symbols.hpp"
+#include <cstring>
+
+using std::string;
+
+static inline uint64_t bitsOf(double v){ uint64_t b; std::memcpy(&b, &v, 8); return b; }
+
+static inline size_t hashNode(OpCode op, uint32_t l, uint32_t r, uint32_t name, uint64_t bits){
+    uint64_t h=bits*0x9E3779B97F4A7C15ULL;
+    h^=((uint64_t)l<<32 | r) + 0x632BE59BD9B4E019ULL + (h<<6) + (h>>2);
+    h^=((uint64_t)name<<8 | (unsigned)op) + (h<<6) + (h>>2);
+    return (size_t)(h ^ (h>>29));
+}
+
+uint32_t Optimizer::node(OpCode op, uint32_t l, uint32_t r, double num, uint32_t name){
+    uint64_t bits = op==OpCode::Const ? bitsOf(num) : 0;
+    size_t pos=hashNode(op, l, r, name, bits)&mask;
+    for(; interned[pos]; pos=(pos+1)&mask){
+        uint32_t id=interned[pos]-1;
+        const ExprNode& x=out->nodes[id];
+        if(x.op==op && x.left==l && x.right==r && x.name==name && bitsOf(x.num)==bits) return id;
+    }
+    ExprNode n; n.op=op; n.left=l; n.right=r; n.name=name; n.num = op==OpCode::Const ? num : 0.0;
+    uint32_t id=(uint32_t)out->nodes.size();
+    out->nodes.push_back(n);
+    interned[pos]=id+1;
+    return id;
+}
+
+// comparacion por bits: -0 no es 0 y cada NaN es distinto
+bool Optimizer::isConst(uint32_t i, double v) const {
+    const ExprNode& n=out->nodes[i];
+    return n.op==OpCode::Const && bitsOf(n.num)==bitsOf(v);
+}
+
+// mismas operaciones y chequeos que VM::run; false si la VM lanzaria un error
+bool Optimizer::fold(OpCode op, double a, double b, double& r){
+    switch(op){
+        case OpCode::Neg:  r=-b; return true;
+        case OpCode::Pos:  r=b; return true;
+        case OpCode::Sqrt: if(b<0) return false; r=std::sqrt(b); return true;
+        case OpCode::Sin:  r=std::sin(b); return true;
+        case OpCode::Cos:  r=std::cos(b); return true;
+        case OpCode::Tan:  r=std::tan(b); return true;
+        case OpCode::Log:  if(b<=0) return false; r=std::log10(b); return true;
+        case OpCode::Ln:   if(b<=0) return false; r=std::log(b); return true;
+        case OpCode::Add:  r=a+b; return true;
+        case OpCode::Sub:  r=a-b; return true;
+        case OpCode::Mul:  r=a*b; return true;
+        case OpCode::Div:  if(b==0) return false; r=a/b; return true;
+        case OpCode::Pow:  r=std::pow(a,b); return true;
+        default: return false;
+    }
+}
+
+void Optimizer::run(const ExprTree& in, ExprTree& o){
+    o.reset(); out=&o;
+    // cada nodo de entrada agrega a lo sumo uno de salida: con 2n entradas la carga queda <= 1/2
+    // y la tabla no crece durante la pasada. Solo se limpia la parte que se usa; despues de
+    // una expresion enorme se devuelve la memoria para no arrastrarla en cada linea.
+    size_t cap=16;
+    while(cap<2*in.nodes.size()) cap*=2;
+    if(interned.size()<cap || interned.size()>4*cap+4096) std::vector<uint32_t>(cap, 0).swap(interned);
+    else std::fill(interned.begin(), interned.begin()+cap, 0);
+    mask=cap-1;
+    o.nodes.reserve(in.nodes.size());
+    o.slots.reserve(in.slots.size());
+    map.assign(in.nodes.size(), ExprTree::kNone);
+    nameMap.assign(in.slots.size(), ExprTree::kNone);
+    const uint32_t kNone=ExprTree::kNone;
+
+    for(size_t i=0;i<in.nodes.size();++i){
+        const ExprNode& n=in.nodes[i];
+        uint32_t& res=map[i];
+        if(n.op==OpCode::Const){ res=constant(n.num); continue; }
+        if(n.op==OpCode::Var){
+            uint32_t slot=in.slots[n.name];
+            if(constants){
+                auto c=constants->find(Symbols::name(slot));
+                if(c!=constants->end()){ res=constant(c->second); continue; }
+            }
+            if(nameMap[n.name]==kNone){ nameMap[n.name]=(uint32_t)o.slots.size(); o.slots.push_back(slot); }
+            res=node(OpCode::Var, kNone, kNone, 0.0, nameMap[n.name]);
+            continue;
+        }
+        uint32_t l = n.left==kNone ? kNone : map[n.left];
+        uint32_t r = map[n.right];
+        ExprNode rn=o.nodes[r];       // copia: node() puede crecer el pool
+        if(!isBinaryOp(n.op)){
+            double v;
+            if(n.op==OpCode::Pos){ res=r; continue; }
+            if(rn.op==OpCode::Const && fold(n.op, 0.0, rn.num, v)){ res=constant(v); continue; }
+            if(n.op==OpCode::Neg && rn.op==OpCode::Neg){ res=rn.right; continue; }
+            res=node(n.op, kNone, r, 0.0, kNone);
+            continue;
+        }
+        ExprNode ln=o.nodes[l];
+        double v;
+        if(ln.op==OpCode::Const && rn.op==OpCode::Const && fold(n.op, ln.num, rn.num, v)){ res=constant(v); continue; }
+        switch(n.op){
+            case OpCode::Mul: if(isConst(r, 1.0)){ res=l; continue; } if(isConst(l, 1.0)){ res=r; continue; } break;
+            case OpCode::Div: if(isConst(r, 1.0)){ res=l; continue; } break;
+            // x^1 no: pow(NaN, 1) puede devolver el NaN con otro signo ("nan" contra "-nan")
+            case OpCode::Sub: if(isConst(r, 0.0)){ res=l; continue; } break;
+            case OpCode::Add: if(isConst(r, -0.0)){ res=l; continue; } if(isConst(l, -0.0)){ res=r; continue; } break;
+            default: break;
+        }
+        res=node(n.op, l, r, 0.0, kNone);
+    }
+    o.root = in.empty() ? kNone : map[in.root];
+    compact();
+}
+
+// quita los nodos que quedaron sin uso (constantes absorbidas, -(-x)...) sin cambiar el orden
+void Optimizer::compact(){
+    ExprTree& o=*out;
+    if(o.empty()) return;
+    live.assign(o.nodes.size(), 0);
+    live[o.root]=1;
+    for(size_t i=o.nodes.size(); i-- > 0; ){
+        if(!live[i]) continue;
+        const ExprNode& n=o.nodes[i];
+        if(n.left!=ExprTree::kNone) live[n.left]=1;
+        if(n.right!=ExprTree::kNone) live[n.right]=1;
+    }
+    idx.assign(o.nodes.size(), ExprTree::kNone);
+    size_t k=0;
+    for(size_t i=0;i<o.nodes.size();++i){
+        if(!live[i]) continue;
+        ExprNode n=o.nodes[i];
+        if(n.left!=ExprTree::kNone) n.left=idx[n.left];
+        if(n.right!=ExprTree::kNone) n.right=idx[n.right];
+        idx[i]=(uint32_t)k; o.nodes[k++]=n;
+    }
+    o.nodes.resize(k);
+    o.root=idx[o.root];
+}
+
+void Optimizer::printDag(std::ostream& os, const ExprTree& t){
+    if(t.empty()) return;
+    SmallVector<unsigned, 256> uses; uses.assign(t.nodes.size(), 0);
+    for(const ExprNode& n: t.nodes){
+        if(n.left!=ExprTree::kNone) ++uses[n.left];
+        if(n.right!=ExprTree::kNone) ++uses[n.right];
+    }
+    // mismo recorrido iterativo que ExprTree::printTree; la marca se asigna al llegar al
+    // nodo (antes de su subarbol derecho) y un nodo ya marcado corta la bajada
+    struct Item { uint32_t node; int depth; };
+    SmallVector<Item, 64> st;
+    SmallVector<int, 256> tag; tag.assign(t.nodes.size(), -1);
+    int nextTag=1;
+    uint32_t n=t.root; int depth=0;
+    for(;;){
+        for(; n!=ExprTree::kNone; n=t.nodes[n].right, ++depth){
+            bool shared = uses[n]>1 && !isLeafOp(t.nodes[n].op);
+            if(shared && tag[n]>=0){ os << string(2*depth, ' ') << "[#" << tag[n] << "]\n"; break; }
+            if(shared) tag[n]=nextTag++;
+            st.push_back(Item{n, depth});
+        }
+        if(st.empty()) return;
+        Item it=st.back(); st.pop_back();
+        const ExprNode& x=t.nodes[it.node];
+        os << string(2*it.depth, ' ') << t.nodeToStr(x);
+        if(tag[it.node]>=0) os << " [#" << tag[it.node] << "]";
+        os << "\n";
+        n=x.left; depth=it.depth+1;
+    }
+}
@@ -0,0 +1,302 @@
+#include "parallel_script.hpp"
+#include "thread_pool.hpp"
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+struct VarState { bool defined; double value; };
+
+// Una linea del segmento. Cada linea tiene un nodo de evaluacion (E) y, si escribe
+// variables cuyo valor depende del resultado, un nodo de publicacion (C): si la
+// evaluacion falla la variable conserva el valor anterior, y eso solo se sabe en C.
+struct Job {
+    Command cmd;
+    uint32_t slot{Symbols::kNone};        // Assign: LHS; Show/Del: variable (kNone si nunca se vio)
+    string key;                           // expresion normalizada ("" si la linea no compila nada)
+    int source{-1};                       // linea del segmento que la parsea si no esta en la cache
+    Error parseErr;                       // error lexico o de parentesis (los del arbol van en ce)
+    string fatal;                         // excepcion al compilar: tabla de nombres llena o sin memoria
+    CompiledPtr ce;
+    std::shared_ptr<JitFunction> native;  // --jit: codigo nativo de ce si ya paso el umbral
+    CompiledPtr last;                     // expresion vista por posfix/prefix/tree sin argumento
+
+    vector<int> reads;                    // escritor previo de cada variable leida (-1 = entorno inicial)
+    int prevLhs{-1}, prevAns{-1};         // escritores previos de lo que esta linea escribe
+
+    bool ok{false}; double res{0.0};
+    VarState lhsOut{false,0.0}, ansOut{false,0.0};
+    string text; bool toErr{false};       // salida de la linea, se imprime en orden al final
+};
+
+bool parallelKind(Command::Kind k){
+    switch(k){
+        case Command::Posfix: case Command::Prefix: case Command::Tree:
+        case Command::Del: case Command::Show: case Command::BadLhs:
+        case Command::Assign: case Command::Eval:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool evaluates(const Command& c){ return c.kind==Command::Assign || c.kind==Command::Eval; }
+bool compilesExpr(const Command& c){
+    bool listing = c.kind==Command::Posfix || c.kind==Command::Prefix || c.kind==Command::Tree;
+    return evaluates(c) || (listing && !c.expr.empty());
+}
+bool writesValue(const Job& j){ return evaluates(j.cmd) && j.ce && !j.ce->buildError; }
+
+// la salida de una linea con error se arma recien aca, cuando se sabe que se imprime
+void setError(Job& j, const Error& e){ stats::count(stats::Errors); j.text="Error: "+e.message()+"\n"; j.toErr=true; }
+bool parseFailed(Job& j){
+    if(!j.fatal.empty()){ stats::count(stats::Errors); j.text="Error: "+j.fatal+"\n"; j.toErr=true; return true; }
+    if(j.parseErr){ setError(j, j.parseErr); return true; }
+    return false;
+}
+
+class Segment {
+public:
+    Segment(Session& s, ThreadPool& pool):s(s),pool(pool){}
+    void run(vector<Job>& jobs);
+private:
+    Session& s;
+    ThreadPool& pool;
+    vector<Job>* jobs{nullptr};
+    vector<vector<int>> succ;             // nodo 2i = E de la linea i, 2i+1 = C
+    std::unique_ptr<std::atomic<int>[]> remaining;
+
+    VarState initial(uint32_t slot) const {
+        return s.env.has(slot) ? VarState{true,s.env.value(slot)} : VarState{false,0.0};
+    }
+    // valor de la variable despues de la linea w (w=-1: entorno al inicio del segmento)
+    VarState stateAfter(int w, uint32_t slot) const {
+        if(w<0) return initial(slot);
+        const Job& j=(*jobs)[w];
+        if(j.cmd.kind==Command::Del) return VarState{false,0.0};
+        return slot==s.ansSlot ? j.ansOut : j.lhsOut;
+    }
+    void parse(Job& j);
+    void resolve(Job& j);
+    void evalNode(int i);
+    void commitNode(int i);
+    void runNode(int node);
+    void link(int from, int to){ succ[from].push_back(to); remaining[to]++; }
+};
+
+void Segment::parse(Job& j){
+    static thread_local ShuntingYard sy;
+    static thread_local Optimizer opt; static thread_local Compiler comp;
+    opt.constants=&s.constants;               // fijo en el segmento: reasignar pi/e corta el segmento
+    try{ j.ce=compileExpr(j.cmd.expr, sy, opt, comp, j.parseErr); }
+    catch(const std::exception& ex){ j.ce.reset(); j.fatal=ex.what(); }
+}
+
+// consulta la cache en el orden del script: hits, misses y desalojos quedan igual que sin --jobs
+void Segment::resolve(Job& j){
+    CompiledPtr hit=s.cache.find(j.key);
+    if(hit){ j.ce=hit; return; }
+    Job& src = j.source>=0 ? (*jobs)[j.source] : j;
+    if(j.source<0) parse(j);               // estaba en la cache al empezar pero ya se desalojo
+    if(src.parseErr || !src.fatal.empty()){ j.parseErr=src.parseErr; j.fatal=src.fatal; return; }
+    j.ce=src.ce;
+    s.cache.insert(j.key, j.ce);
+}
+
+void Segment::evalNode(int i){
+    Job& j=(*jobs)[i];
+    if(!j.text.empty()) return;           // salida ya resuelta al armar el grafo
+    static thread_local std::ostringstream os; os.str("");
+    switch(j.cmd.kind){
+        case Command::Posfix: case Command::Prefix: case Command::Tree: {
+            const CompiledPtr& c = j.cmd.expr.empty() ? j.last : j.ce;
+            if(!c || c->tree.nodes.empty()){ Error e; e.set(ErrCode::NoPrevious, Error::kNoPos); setError(j, e); break; }
+            if(j.cmd.kind==Command::Posfix){ Session::printPostfix(os, c->tree); j.text=os.str(); break; }
+            if(c->buildError){ setError(j, c->buildError); break; }
+            if(j.cmd.kind==Command::Prefix){ c->tree.printPrefix(os, c->tree.root); os << "\n"; }
+            else if(j.cmd.optimized) Optimizer::printDag(os, c->optTree);
+            else c->tree.printTree(os, c->tree.root);
+            j.text=os.str();
+            break;
+        }
+        case Command::Show: {
+            VarState v=stateAfter(j.reads[0], j.slot);
+            if(v.defined){ Session::printValue(os, j.cmd.name, v.value); j.text=os.str(); }
+            else { j.text="Error: Variable no definida: "+j.cmd.name+"\n"; j.toErr=true; }
+            break;
+        }
+        case Command::Del:
+            if(j.cmd.name.empty()) j.text="Error: nombre vacio\n";
+            else if(j.cmd.name=="pi" || j.cmd.name=="e" || j.cmd.name=="ans") j.text="Error: variable protegida\n";
+            else j.text = stateAfter(j.reads[0], j.slot).defined ? "ok\n" : "Error: variable no existe\n";
+            break;
+        case Command::Assign: case Command::Eval: {
+            // entorno local con solo las variables del programa, resueltas a la version que ve esta linea
+            static thread_local VarEnv local;
+            static thread_local VM vm(&local);
+            static thread_local vector<double> vars;
+            const Program& prog=j.ce->prog;
+            for(size_t k=0;k<prog.slots.size();++k){
+                VarState v=stateAfter(j.reads[k], prog.slots[k]);
+                if(v.defined) local.set(prog.slots[k], v.value); else local.erase(prog.slots[k]);
+            }
+            stats::Timer t(stats::Eval);
+            Error e;
+            j.res = j.native ? Jit::call(*j.native, prog, local, vm, e, vars) : vm.run(prog, e);
+            t.stop();
+            if(e){ setError(j, e); break; }
+            j.ok=true;
+            Session::printValue(os, j.cmd.kind==Command::Assign ? j.cmd.name : "ans", j.res);
+            j.text=os.str();
+            break;
+        }
+        default: break;
+    }
+}
+
+void Segment::commitNode(int i){
+    Job& j=(*jobs)[i];
+    if(j.ok){ j.ansOut=VarState{true,j.res}; j.lhsOut=j.ansOut; return; }
+    j.ansOut=stateAfter(j.prevAns, s.ansSlot);
+    if(j.cmd.kind==Command::Assign) j.lhsOut=stateAfter(j.prevLhs, j.slot);
+}
+
+// el primer sucesor que queda listo sigue en este mismo hilo; el resto se encola
+void Segment::runNode(int node){
+    while(node>=0){
+        if(node&1) commitNode(node/2); else evalNode(node/2);
+        int next=-1;
+        for(int nx: succ[node]){
+            if(--remaining[nx]!=0) continue;
+            if(next<0) next=nx; else pool.submit([this,nx]{ runNode(nx); });
+        }
+        node=next;
+    }
+}
+
+void Segment::run(vector<Job>& js){
+    jobs=&js;
+    size_t n=js.size();
+
+    // 1) parseo en paralelo de lo que no esta en la cache (una vez por expresion distinta)
+    std::unordered_map<string,int> firstMiss;
+    for(size_t i=0;i<n;++i){
+        Job& j=js[i];
+        if(!compilesExpr(j.cmd)) continue;
+        j.key=ExprCache::normalize(j.cmd.expr);
+        if(s.cache.contains(j.key)) continue;
+        j.source=firstMiss.emplace(j.key, (int)i).first->second;
+    }
+    const size_t block=64;
+    for(size_t b=0;b<n;b+=block)
+        pool.submit([this,&js,b,n,block]{
+            for(size_t i=b;i<std::min(n,b+block);++i) if(js[i].source==(int)i) parse(js[i]);
+        });
+    pool.wait();
+    for(size_t i=0;i<n;++i) if(compilesExpr(js[i].cmd)) resolve(js[i]);
+
+    // 2) grafo de dependencias, en orden de entrada
+    succ.assign(2*n, vector<int>());
+    remaining.reset(new std::atomic<int>[2*n]);
+    for(size_t k=0;k<2*n;++k) remaining[k]=0;
+    std::unordered_map<uint32_t,int> writer;   // ultimo escritor de cada slot en el segmento
+    CompiledPtr last = s.last;
+    auto prevWriter=[&](uint32_t v){ auto it=writer.find(v); return it==writer.end() ? -1 : it->second; };
+    // del deja la variable indefinida sin importar el resto: no hace falta esperarlo
+    auto after=[&](int w, int node){ if(w>=0 && js[w].cmd.kind!=Command::Del) link(2*w+1, node); };
+
+    for(size_t ii=0; ii<n; ++ii){
+        int i=(int)ii; Job& j=js[i];
+        switch(j.cmd.kind){
+            case Command::Posfix: case Command::Prefix: case Command::Tree:
+                parseFailed(j);
+                j.last=last;
+                break;
+            case Command::BadLhs:
+                j.text="Error: LHS invalido\n"; j.toErr=true;
+                break;
+            case Command::Show: case Command::Del: {
+                // un nombre sin slot nunca se asigno: ni el entorno ni el segmento lo tienen
+                j.slot=Symbols::find(j.cmd.name);
+                int w = j.slot==Symbols::kNone ? -1 : prevWriter(j.slot); j.reads.push_back(w); after(w, 2*i);
+                if(j.cmd.kind==Command::Del && j.slot!=Symbols::kNone
+                   && j.cmd.name!="pi" && j.cmd.name!="e" && j.cmd.name!="ans") writer[j.slot]=i;
+                break;
+            }
+            case Command::Assign: case Command::Eval:
+                if(j.ce) last=j.ce;           // desde la posfija la linea ya es "la ultima expresion"
+                if(parseFailed(j)) break;
+                if(j.ce->buildError){ setError(j, j.ce->buildError); break; }
+                j.native=s.jitFor(*j.ce);     // aca: el contador avanza en el orden del script
+                for(uint32_t slot: j.ce->prog.slots){ int w=prevWriter(slot); j.reads.push_back(w); after(w, 2*i); }
+                link(2*i, 2*i+1);
+                j.prevAns=prevWriter(s.ansSlot); after(j.prevAns, 2*i+1);
+                if(j.cmd.kind==Command::Assign && j.cmd.name!="ans"){
+                    j.slot=Symbols::intern(j.cmd.name);
+                    j.prevLhs=prevWriter(j.slot); after(j.prevLhs, 2*i+1);
+                    writer[j.slot]=i;
+                }
+                writer[s.ansSlot]=i;
+                break;
+            default: break;
+        }
+    }
+
+    // 3) ejecucion: se siembran los nodos sin dependencias
+    // (primero se juntan: al encolar, los nodos ya empiezan a liberar a sus sucesores)
+    vector<int> roots;
+    for(size_t k=0;k<2*n;++k){
+        bool used = (k&1) ? writesValue(js[k/2]) : true;
+        if(used && remaining[k]==0) roots.push_back((int)k);
+    }
+    for(int node: roots) pool.submit([this,node]{ runNode(node); });
+    pool.wait();
+
+    // 4) salida en orden y estado final de la sesion
+    for(const Job& j: js) (j.toErr ? s.err : s.out) << j.text;
+    for(const auto& w: writer){
+        VarState v=stateAfter(w.second, w.first);
+        if(v.defined) s.env.set(w.first, v.value); else s.env.erase(w.first);
+    }
+    s.last=last;
+}
+
+} // namespace
+
+// los segmentos largos se cortan en ventanas: acota la memoria y mantiene caliente la cache
+static const size_t kWindow = 4096;
+
+void runScriptParallel(Session& s, const char* text, size_t size, unsigned jobs){
+    ThreadPool pool(jobs);
+    vector<Job> seg;
+    auto flush=[&]{ if(seg.empty()) return; Segment(s, pool).run(seg); seg.clear(); };
+    string line; Command c;               // buffers reusados entre lineas
+    for(const char* p=text, *end=text+size; p<end;){
+        const char* nl=(const char*)std::memchr(p, '\n', (size_t)(end-p));
+        const char* b=p; const char* e = nl ? nl : end;
+        p = nl ? nl+1 : end;
+        const char* raw=b; size_t rawSize=(size_t)(e-b);
+        while(b<e && isSpace(*b)) ++b;
+        while(e>b && isSpace(e[-1])) --e;
+        line.assign(b, e);
+        parseCommand(line, c);
+        if(c.kind==Command::Exit) break;
+        if(c.kind==Command::Empty) continue;
+        // reasignar pi/e o escribir algo que lee una formula: la linea va sola, en orden
+        bool writesName = c.kind==Command::Assign || c.kind==Command::Del;
+        bool special = (c.kind==Command::Assign && s.isConstant(c.name))
+                    || (writesName && s.isReactive(c.name))
+                    || ((c.kind==Command::Assign || c.kind==Command::Eval) && s.isReactive("ans"));
+        if(parallelKind(c.kind) && !special){
+            stats::count(stats::Lines);
+            Job j; j.cmd=c; seg.push_back(std::move(j));
+            if(seg.size()>=kWindow) flush();
+            continue;
+        }
+        flush();
+        s.handle(raw, rawSize);
+    }
+    flush();
+}
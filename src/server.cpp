@@ -0,0 +1,291 @@
+#include "server.hpp"
+#include "session.hpp"
+
+using std::lock_guard;
+using std::mutex;
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+
+// salida de la Session: se junta en un string que despues pasa al buffer de envio
+class StringSink : public std::streambuf {
+public:
+    string buf;
+protected:
+    int_type overflow(int_type c) override { if(c!=traits_type::eof()) buf+=(char)c; return c; }
+    std::streamsize xsputn(const char* s, std::streamsize n) override { buf.append(s, (size_t)n); return n; }
+};
+
+// con mas de esto sin procesar o sin enviar se deja de leer la conexion hasta que baje;
+// una linea sola mas larga que kMaxPending corta la conexion
+const size_t kMaxPending = 1<<20;
+const size_t kMaxOut = 4<<20;
+// sweep: puntos por comando; la salida sin mandar (de todos los comandos) tope kMaxOut
+const uint64_t kMaxSweepPoints = 10000000;
+// nombres que una conexion puede agregar a la tabla de simbolos (global, nunca se vacia), y
+// entre todas: asi la tabla y el VarEnv de cada sesion (~8 bytes por id) quedan acotados
+const uint32_t kMaxNewNames = 4096;
+const uint32_t kMaxServerNames = 1u<<18;
+uint32_t serverNames = kMaxServerNames;   // cupo comun, bajo el lock de Symbols
+
+} // namespace
+
+struct Server::Conn {
+    int fd;
+    StringSink sink; std::ostream os; Session session;   // solo el worker que tiene busy
+    // del hilo de epoll
+    string in;                          // bytes leidos despues de la ultima linea completa
+    string wbuf; size_t woff{0};        // salida pendiente de send()
+    bool eof{false}, closed{false};
+    std::atomic<bool> gone{false};      // closed, para el worker (corta su sweep)
+    std::atomic<size_t> unsent{0};      // wbuf sin mandar, para el worker
+    uint32_t events{0};
+    uint32_t newNames{kMaxNewNames};    // cupo de Symbols::setQuota (solo el worker que tiene busy)
+    // compartido (protegido por m)
+    mutex m;
+    string pending;                     // lineas completas sin procesar, cada una con su '\n'
+    string out;                         // salida ya producida
+    bool busy{false};                   // hay un worker procesando esta conexion
+    bool exited{false};                 // llego "exit": lo que sigue se descarta
+    bool tooLong{false};                // linea de kMaxPending bytes sin '\n': se corta al vaciar pending
+
+    explicit Conn(int fd):fd(fd),os(&sink),session(os, os){}
+};
+
+bool Server::supported(){ return true; }
+
+Server::Server(unsigned workers):pool(workers){}
+
+Server::~Server(){
+    pool.wait();
+    for(auto& kv: conns) ::close(kv.first);
+    if(lfd>=0){ ::close(lfd); unlink(path.c_str()); }
+    if(ep>=0) ::close(ep);
+    if(wakeFd>=0) ::close(wakeFd);
+}
+
+bool Server::listen(const string& p, string& error){
+    sockaddr_un addr; std::memset(&addr, 0, sizeof addr);
+    addr.sun_family=AF_UNIX;
+    if(p.empty() || p.size()>=sizeof addr.sun_path){ error="ruta de socket invalida: "+p; return false; }
+    std::memcpy(addr.sun_path, p.c_str(), p.size()+1);
+    unlink(p.c_str());
+    lfd=socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+    if(lfd<0 || bind(lfd, (sockaddr*)&addr, sizeof addr)!=0 || ::listen(lfd, SOMAXCONN)!=0){
+        error=string("no se pudo escuchar en ")+p+": "+std::strerror(errno);
+        if(lfd>=0){ ::close(lfd); lfd=-1; }
+        return false;
+    }
+    path=p;
+    ep=epoll_create1(EPOLL_CLOEXEC);
+    wakeFd=eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if(ep<0 || wakeFd<0){ error=string("epoll: ")+std::strerror(errno); return false; }
+    epoll_event ev; ev.events=EPOLLIN; ev.data.fd=lfd; epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+    ev.events=EPOLLIN; ev.data.fd=wakeFd; epoll_ctl(ep, EPOLL_CTL_ADD, wakeFd, &ev);
+    return true;
+}
+
+void Server::stop(){
+    stopping=true;
+    uint64_t one=1;
+    if(wakeFd>=0 && write(wakeFd, &one, sizeof one)<0){}   // write es seguro en un manejador de senal
+}
+
+void Server::run(){
+    epoll_event evs[256];
+    std::vector<ConnPtr> batch;
+    while(!stopping){
+        int n=epoll_wait(ep, evs, 256, -1);
+        if(n<0){ if(errno==EINTR) continue; break; }
+        for(int i=0;i<n;++i){
+            int fd=evs[i].data.fd;
+            if(fd==lfd){ accept(); continue; }
+            if(fd==wakeFd){
+                uint64_t v; while(::read(wakeFd, &v, sizeof v)>0){}
+                { lock_guard<mutex> lk(m); batch.swap(ready); }
+                for(const ConnPtr& c: batch) if(!c->closed) flush(c);
+                batch.clear();
+                continue;
+            }
+            auto it=conns.find(fd);
+            if(it==conns.end()) continue;
+            ConnPtr c=it->second;
+            if(evs[i].events & (EPOLLERR|EPOLLHUP) && !(evs[i].events & EPOLLIN)){ close(c); continue; }
+            if(evs[i].events & EPOLLIN) read(c);
+            if(!c->closed && (evs[i].events & EPOLLOUT)) flush(c);
+        }
+    }
+    // lo que ya se estaba evaluando termina; lo que se pueda mandar sin bloquear se manda
+    pool.wait();
+    for(auto& kv: conns){ ConnPtr c=kv.second; { lock_guard<mutex> lk(c->m); c->wbuf.append(c->out); }
+                          if(c->woff<c->wbuf.size() && send(c->fd, c->wbuf.data()+c->woff, c->wbuf.size()-c->woff, MSG_NOSIGNAL)<0){} }
+}
+
+void Server::accept(){
+    for(;;){
+        int fd=accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK|SOCK_CLOEXEC);
+        if(fd<0) return;                 // EAGAIN o error de una conexion: se sigue con las demas
+        ConnPtr c=std::make_shared<Conn>(fd);
+        c->session.useJit=useJit; c->session.setJitThreshold(jitThreshold);
+        c->session.allowFiles=false;     // el cliente no lee ni escribe archivos del servidor
+        c->session.sweepThreads=1;       // ya corre en un worker del pool: sin pool propio por sweep
+        c->session.sweepMaxPoints=kMaxSweepPoints;
+        Conn* raw=c.get();               // la Session es de la Conn: un ConnPtr aca seria un ciclo
+        c->session.sweepStop=[this, raw]() -> const char* {
+            if(stopping) return "servidor detenido";
+            if(raw->gone) return "conexion cerrada";
+            size_t out; { lock_guard<mutex> lk(raw->m); out=raw->out.size(); }
+            if(raw->sink.buf.size()+out+raw->unsent>=kMaxOut) return "mas de 4 MB de salida sin mandar";
+            return nullptr;
+        };
+        if(cacheSize>=0) c->session.cache.setCapacity((size_t)cacheSize);
+        if(initial) c->session.copyState(*initial);
+        conns[fd]=c;
+        epoll_event ev; ev.events=EPOLLIN; ev.data.fd=fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        c->events=EPOLLIN;
+    }
+}
+
+void Server::read(const ConnPtr& c){
+    char buf[65536];
+    bool got=false;
+    size_t queued;
+    { lock_guard<mutex> lk(c->m); queued=c->pending.size(); }
+    // se lee hasta kMaxPending entre lo encolado y la linea a medias; el '\n' se busca solo
+    // en lo recien leido (c->in nunca guarda uno)
+    size_t end=string::npos;
+    while(queued+c->in.size()<kMaxPending){
+        size_t want=std::min(sizeof buf, kMaxPending-queued-c->in.size());
+        ssize_t k=recv(c->fd, buf, want, 0);
+        if(k>0){
+            const char* nl=(const char*)memrchr(buf, '\n', (size_t)k);
+            if(nl) end=c->in.size()+(size_t)(nl-buf);
+            c->in.append(buf, (size_t)k); got=true;
+            if((size_t)k<want) break;
+            continue;
+        }
+        if(k==0){ c->eof=true; break; }
+        if(errno==EINTR) continue;
+        if(errno==EAGAIN || errno==EWOULDBLOCK) break;
+        close(c); return;
+    }
+    // solo lineas completas; al cerrar la entrada, lo que quedo cuenta como ultima linea
+    if(c->eof && !c->in.empty() && end!=c->in.size()-1){ c->in+='\n'; end=c->in.size()-1; }
+    bool tooLong = end==string::npos && c->in.size()>=kMaxPending;
+    if(tooLong) c->in.clear();
+    bool schedule=false;
+    if(got || c->eof){
+        lock_guard<mutex> lk(c->m);
+        if(end!=string::npos && !c->exited) c->pending.append(c->in, 0, end+1);
+        if(tooLong) c->tooLong=true;
+        if((end!=string::npos || tooLong) && !c->exited && !c->busy){ c->busy=true; schedule=true; }
+    }
+    if(end!=string::npos) c->in.erase(0, end+1);
+    if(schedule){ ConnPtr keep=c; pool.submit([this, keep]{ drain(keep); }); }
+    watch(c);
+}
+
+void Server::drain(const ConnPtr& c){
+    string lines;
+    for(;;){
+        {
+            lock_guard<mutex> lk(c->m);
+            if(c->pending.empty() || c->exited){
+                // las lineas anteriores ya respondieron: el error va al final y se cierra
+                if(c->tooLong && !c->exited){ c->out+="Error: linea demasiado larga\n"; c->exited=true; }
+                c->pending.clear(); c->busy=false; break;
+            }
+            lines.swap(c->pending);
+        }
+        bool exited=false;
+        const char* p=lines.data(); const char* end=p+lines.size();
+        Symbols::setQuota(&c->newNames, &serverNames);
+        while(p<end){
+            const char* nl=(const char*)std::memchr(p, '\n', (size_t)(end-p));
+            if(!c->session.handle(p, (size_t)(nl-p))){ exited=true; break; }
+            p=nl+1;
+        }
+        Symbols::setQuota(nullptr, nullptr);
+        lines.clear();
+        {
+            lock_guard<mutex> lk(c->m);
+            c->out.append(c->sink.buf);
+            if(exited) c->exited=true;
+        }
+        c->sink.buf.clear();
+        notify(c);
+    }
+    notify(c);   // busy=false: el hilo de epoll puede cerrar o retomar la lectura
+}
+
+void Server::notify(const ConnPtr& c){
+    bool first;
+    { lock_guard<mutex> lk(m); first=ready.empty(); ready.push_back(c); }
+    if(first){ uint64_t one=1; if(write(wakeFd, &one, sizeof one)<0){} }
+}
+
+void Server::flush(const ConnPtr& c){
+    {
+        lock_guard<mutex> lk(c->m);
+        if(!c->out.empty()){
+            if(c->woff==c->wbuf.size()){ c->wbuf.swap(c->out); c->out.clear(); c->woff=0; }
+            else c->wbuf.append(c->out), c->out.clear();
+        }
+    }
+    while(c->woff<c->wbuf.size()){
+        ssize_t k=send(c->fd, c->wbuf.data()+c->woff, c->wbuf.size()-c->woff, MSG_NOSIGNAL);
+        if(k>0){ c->woff+=(size_t)k; continue; }
+        if(k<0 && errno==EINTR) continue;
+        if(k<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) break;
+        close(c); return;
+    }
+    if(c->woff==c->wbuf.size()){ c->wbuf.clear(); c->woff=0; }
+    c->unsent=c->wbuf.size()-c->woff;
+    watch(c);
+}
+
+// interes en epoll segun el estado; cierra cuando no queda nada por leer, procesar ni enviar
+void Server::watch(const ConnPtr& c){
+    if(c->closed) return;
+    bool busy, exited, tooLong; size_t pending, out;
+    { lock_guard<mutex> lk(c->m); busy=c->busy; exited=c->exited; tooLong=c->tooLong; pending=c->pending.size(); out=c->out.size(); }
+    size_t unsent=c->wbuf.size()-c->woff;
+    if((c->eof || exited) && !busy && !pending && !out && !unsent){ close(c); return; }
+    uint32_t want=0;
+    // el mismo tope que read(): con pending+in lleno el fd quedaria listo y read() no leeria nada
+    if(!c->eof && !exited && !tooLong && pending+c->in.size()<kMaxPending && unsent<kMaxOut) want|=EPOLLIN;
+    if(unsent) want|=EPOLLOUT;
+    if(want==c->events) return;
+    epoll_event ev; ev.events=want; ev.data.fd=c->fd;
+    epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events=want;
+}
+
+void Server::close(const ConnPtr& c){
+    if(c->closed) return;
+    c->closed=true; c->gone=true;
+    epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, nullptr);
+    ::close(c->fd);
+    conns.erase(c->fd);   // un worker que la este usando conserva su copia hasta terminar
+}
+
+#else // sin epoll: --serve no esta disponible
+
+struct Server::Conn {};
+bool Server::supported(){ return false; }
+Server::Server(unsigned workers):pool(workers){}
+Server::~Server(){}
+bool Server::listen(const string&, string& error){ error="--serve solo esta disponible en Linux"; return false; }
+void Server::run(){}
+void Server::stop(){}
+
+#endif
@@ -0,0 +1,377 @@
+#include "session.hpp"
+#include "snapshot.hpp"
+#include "sweep.hpp"
+#include <cstring>
+
+using std::string;
+using std::vector;
+using std::ostream;
+
+static int findTopLevelEq(const string& s){
+    int bal=0; for(int i=0;i<(int)s.size();++i){ char c=s[i];
+        if(c=='(') ++bal; else if(c==')') --bal; else if(c=='=' && bal==0) return i;
+    } return -1;
+}
+
+// dst = s[from,to) sin espacios en los bordes; reusa la capacidad de dst
+static void assignTrimmed(string& dst, const string& s, size_t from, size_t to){
+    while(from<to && isSpace(s[from])) ++from;
+    while(to>from && isSpace(s[to-1])) --to;
+    dst.assign(s, from, to-from);
+}
+
+// comandos con argumento opcional: "posfix", "posfix expr"
+static bool withArg(const string& line, const string& cmd, Command::Kind kind, Command& c){
+    if(line.rfind(cmd,0)!=0) return false;
+    c.kind=kind; assignTrimmed(c.expr, line, cmd.size(), line.size());
+    return true;
+}
+
+// name = expr (con LHS valido) o una expresion suelta
+static void assignOrEval(const string& line, Command& c){
+    int posEq=findTopLevelEq(line);
+    if(posEq>0){
+        assignTrimmed(c.name, line, 0, posEq);
+        assignTrimmed(c.expr, line, posEq+1, line.size());
+        c.kind=(c.name.empty() || !isAlphaC(c.name[0])) ? Command::BadLhs : Command::Assign;
+        return;
+    }
+    c.kind=Command::Eval; c.expr.assign(line);
+}
+
+Command parseCommand(const string& line){ Command c; parseCommand(line, c); return c; }
+
+void parseCommand(const string& line, Command& c){
+    c.kind=Command::Empty; c.optimized=false; c.name.clear(); c.expr.clear();
+    if(line=="exit"){ c.kind=Command::Exit; return; }
+    if(line.empty()) return;
+    if(line=="help"){ c.kind=Command::Help; return; }
+    if(withArg(line, "posfix", Command::Posfix, c)) return;
+    if(withArg(line, "prefix", Command::Prefix, c)) return;
+    if(withArg(line, "tree", Command::Tree, c)){
+        if(c.expr=="opt" || c.expr.rfind("opt ",0)==0){ c.optimized=true; c.expr=trim(c.expr.substr(3)); }
+        return;
+    }
+    if(line=="vars"){ c.kind=Command::Vars; return; }
+    if(line=="defs"){ c.kind=Command::Defs; return; }
+    if(line=="stats" || line=="stats on" || line=="stats off"){ c.kind=Command::Stats; assignTrimmed(c.expr, line, 5, line.size()); return; }
+    if(line=="cache" || line=="cache clear"){ c.kind=Command::Cache; assignTrimmed(c.expr, line, 5, line.size()); return; }
+    // sweep [reduccion] expr for x=ini:fin[:paso], ...; "sweep = 1" sigue siendo una asignacion
+    if(line=="sweep" || (line.rfind("sweep ", 0)==0 && trim(line.substr(6))[0]!='=')){
+        c.kind=Command::Sweep; assignTrimmed(c.expr, line, 5, line.size()); return;
+    }
+    if(line.rfind("del ", 0)==0){ c.kind=Command::Del; assignTrimmed(c.name, line, 4, line.size()); return; }
+    if(line.size()>5 && line.compare(0,5,"show ")==0){ c.kind=Command::Show; assignTrimmed(c.name, line, 5, line.size()); return; }
+    // save/load <archivo>; "save = 1" sigue siendo una asignacion
+    if(line.size()>5 && (line.compare(0,5,"save ")==0 || line.compare(0,5,"load ")==0)){
+        assignTrimmed(c.name, line, 5, line.size());
+        if(!c.name.empty() && c.name[0]!='='){ c.kind = line[0]=='s' ? Command::Save : Command::Load; return; }
+        c.name.clear();
+    }
+
+    // def y = expr: formula viva, se recalcula cuando cambian sus variables
+    if(line.rfind("def ", 0)==0){
+        string rest=trim(line.substr(4));
+        int eq=findTopLevelEq(rest);
+        if(eq>0){
+            c.name=trim(rest.substr(0,eq)); c.expr=trim(rest.substr(eq+1));
+            c.kind=(c.name.empty() || !isAlphaC(c.name[0])) ? Command::BadLhs : Command::Def;
+            return;
+        }
+    }
+
+    // alias: let x = expr  (se sigue con el resto de la linea, ya recortado)
+    if(line.rfind("let ", 0)==0){ assignOrEval(trim(line.substr(4)), c); return; }
+    assignOrEval(line, c);
+}
+
+Session::Session(ostream& out, ostream& err)
+: ansSlot(Symbols::intern("ans")), out(out), err(err), vm(&env), jit(&env, 64) {
+    env.set(ansSlot, 0.0); env.set("pi", 3.14159265358979323846); env.set("e", 2.71828182845904523536);
+    constants["pi"]=env.get("pi"); constants["e"]=env.get("e");
+    opt.constants=&constants;
+}
+
+void Session::copyState(const Session& s){
+    env=s.env;
+    formulas=s.formulas; formulas.detach();
+    constants=s.constants;
+    last.reset();
+    if(s.last){ last=std::make_shared<CompiledExpr>(*s.last); last->jit=JitSlot(); }
+    cache.clear();
+}
+
+// mismo texto que os << std::fixed << std::setprecision(10) << v, sin pasar por el locale
+void Session::printValue(ostream& os, const string& name, double v){
+    stats::Timer t(stats::Output);
+    char buf[kFixed10Max+8];
+    size_t n=formatFixed10(v, buf);
+    buf[n++]='\n';
+    os.write(name.data(), (std::streamsize)name.size()).write(" -> ", 4).write(buf, (std::streamsize)n);
+}
+
+void Session::printPostfix(ostream& os, const ExprTree& t){
+    t.printPostfix(os);
+    os << "\n";
+}
+
+void Session::printHelp(ostream& os){
+    os << "Comandos disponibles:\n"
+       << "  help               -> esta ayuda\n"
+       << "  --version          -> imprime la version y termina\n"
+       << "  --jit[=N]          -> JIT x86-64 tras N evaluaciones de una expresion\n"
+       << "  --eval E --columns F.csv -> evalua E por cada fila del CSV\n"
+       << "  --jobs N           -> ejecuta el script en N hilos (salida identica)\n"
+       << "  --cache N          -> capacidad de la cache de expresiones (0 = sin cache)\n"
+       << "  --file F           -> ejecuta el script F (mmap, salida en bloques)\n"
+       << "  --stats            -> imprime stats al salir (en stderr)\n"
+       << "  --trace F.json     -> tiempos por linea y etapa (formato Chrome trace)\n"
+       << "  --serve S          -> servidor en el socket Unix S (una sesion por conexion)\n"
+       << "  --restore F        -> arranca con la sesion guardada en F (save)\n"
+       << "  --sweep L          -> ejecuta \"sweep L\" (--jobs N: hilos) y termina\n"
+       << "  show <var>         -> muestra valor de variable\n"
+       << "  let x = expr       -> alias de asignacion\n"
+       << "  def y = expr       -> formula viva: se recalcula al cambiar sus variables\n"
+       << "  defs               -> lista las formulas definidas\n"
+       << "  vars               -> lista variables definidas\n"
+       << "  cache [clear]      -> estadisticas (o vaciado) de la cache de expresiones\n"
+       << "  stats [on|off]     -> contadores y latencias por etapa (on: medir tiempos)\n"
+       << "  del <var>          -> elimina variable (excepto pi, e, ans)\n"
+       << "  save <archivo>     -> guarda variables, formulas y ultima expresion (binario)\n"
+       << "  load <archivo>     -> reemplaza la sesion por la guardada con save\n"
+       << "  posfix [expr]      -> imprime notacion posfija (de expr o ultima)\n"
+       << "  prefix [expr]      -> imprime notacion prefija (de expr o ultima)\n"
+       << "  tree   [expr]      -> imprime arbol (de expr o ultima)\n"
+       << "  tree opt [expr]    -> arbol optimizado (constantes plegadas, [#k] = compartido)\n"
+       << "  sweep [red] expr for x=ini:fin[:paso], y=...\n"
+       << "                     -> tabla de expr en la grilla, o red: sum, min, max, argmin, argmax, mean\n"
+       << "Asignacion: x = expresion\n"
+       << "Funciones: sqrt, sin, cos, tan, log(base10), ln\n"
+       << "Constantes: pi, e (radianes)\n";
+}
+
+CompiledPtr Session::compile(const string& expr, Error& e){
+    ExprCache::normalize(expr, key);
+    CompiledPtr c=cache.find(key);
+    if(c){ e.clear(); return c; }
+    c=compileExpr(expr, sy, opt, comp, e);
+    if(c) cache.insert(key, c);
+    return c;
+}
+
+CompiledPtr Session::treeFor(const Command& c, Error& e){
+    CompiledPtr ce = c.expr.empty() ? last : compile(c.expr, e);
+    if(c.expr.empty() && (!ce || ce->tree.nodes.empty())){ e.set(ErrCode::NoPrevious, Error::kNoPos); return CompiledPtr(); }
+    if(!ce) return ce;
+    if(ce->buildError){ e=ce->buildError; return CompiledPtr(); }
+    return ce;
+}
+
+double Session::evaluate(const string& expr, Error& e){
+    CompiledPtr c = compile(expr, e);
+    if(!c) return 0.0;
+    last = c;
+    if(c->buildError){ e=c->buildError; return 0.0; }
+    return run(*c, e);
+}
+
+bool Session::recompute(uint32_t slot, FormulaGraph::Formula& f){
+    bool had = env.has(slot);
+    double old = had ? env.value(slot) : 0.0;
+    Error e;
+    double v=run(*f.ce, e);
+    if(e){
+        stats::count(stats::Errors);
+        if(!had) return false;
+        env.erase(slot);                     // con error la formula queda sin valor
+        return true;
+    }
+    if(had && std::memcmp(&v, &old, sizeof v)==0) return false;
+    env.set(slot, v);
+    return true;
+}
+
+void Session::changed(uint32_t a, uint32_t b){
+    if(formulas.empty()) return;         // sin formulas no se arma nada por linea
+    const uint32_t slots[2]={a, b};
+    formulas.propagate(slots, b==Symbols::kNone ? 1 : 2, [this](uint32_t slot, FormulaGraph::Formula& f){ return recompute(slot, f); });
+}
+
+// def y = expr: el valor se calcula ya; si da error la formula queda igual (sin valor)
+void Session::define(const Command& c){
+    if(isConstant(c.name) || c.name=="ans"){ err << "Error: variable protegida\n"; return; }
+    uint32_t slot=Symbols::intern(c.name);
+    Error e;
+    CompiledPtr ce=compile(c.expr, e);
+    if(!ce){ error(e); return; }
+    last=ce;
+    if(ce->buildError){ error(ce->buildError); return; }
+    // ans cambia en cada linea (y cada formula lo escribe): una formula que lo lee se
+    // recalcularia sola, sin que cambie ninguna entrada
+    if(std::find(ce->tree.slots.begin(), ce->tree.slots.end(), ansSlot)!=ce->tree.slots.end()){
+        err << "Error: variable protegida\n"; return;
+    }
+    string cycle;
+    if(!formulas.define(slot, c.expr, ce, cycle)){
+        stats::count(stats::Errors); err << "Error: Ciclo de dependencias: " << cycle << "\n";
+        return;
+    }
+
+    FormulaGraph::Formula* f=formulas.find(slot);
+    double res=run(*f->ce, e);
+    if(e){
+        error(e);
+        env.erase(slot);
+        changed(slot);
+        return;
+    }
+    env.set(slot, res);
+    env.set(ansSlot, res);
+    printValue(out, c.name, res);
+    changed(slot, ansSlot);
+}
+
+bool Session::handle(const string& raw){ return handle(raw.data(), raw.size()); }
+
+bool Session::handle(const char* p, size_t n){
+    stats::count(stats::Lines);
+    stats::setLine(++lineNo);
+    stats::Timer t(stats::Line);
+    const char* e=p+n;
+    while(p<e && isSpace(*p)) ++p;
+    while(e>p && isSpace(e[-1])) --e;
+    line.assign(p, e);
+    parseCommand(line, cmd);
+    const Command& c=cmd;
+    switch(c.kind){
+        case Command::Exit: return false;
+        case Command::Empty: return true;
+        case Command::Help: printHelp(out); return true;
+
+        // los errores de la linea vuelven en e; el catch queda para la tabla de nombres llena o sin memoria
+        case Command::Posfix:
+            try{
+                Error e;
+                CompiledPtr ce = c.expr.empty() ? last : compile(c.expr, e);
+                if(!e && (!ce || ce->tree.nodes.empty())) e.set(ErrCode::NoPrevious, Error::kNoPos);
+                if(e) error(e); else printPostfix(out, ce->tree);
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        case Command::Prefix:
+            try{
+                Error e; CompiledPtr ce=treeFor(c, e);
+                if(!ce) error(e); else { ce->tree.printPrefix(out, ce->tree.root); out << "\n"; }
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        case Command::Tree:
+            try{
+                Error e; CompiledPtr ce=treeFor(c, e);
+                if(!ce) error(e);
+                else if(c.optimized) Optimizer::printDag(out, ce->optTree);
+                else ce->tree.printTree(out, ce->tree.root);
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        // vars: lista todas las variables ordenadas alfabeticamente
+        case Command::Vars: {
+            vector<std::pair<string,double>> kv; kv.reserve(env.size());
+            env.forEach([&kv](uint32_t slot, double v){ kv.push_back(std::make_pair(Symbols::name(slot), v)); });
+            std::sort(kv.begin(), kv.end(),
+                [](const std::pair<string,double>& a, const std::pair<string,double>& b){ return a.first < b.first; });
+            for(const auto& p: kv) printValue(out, p.first, p.second);
+            return true;
+        }
+
+        // cache: tamano y contadores; "cache clear" vacia (los contadores siguen)
+        case Command::Cache:
+            if(c.expr=="clear"){ cache.clear(); out << "ok\n"; return true; }
+            out << "cache -> " << cache.size() << "/" << cache.capacity() << " entradas, "
+                << cache.hits << " hits, " << cache.misses << " misses, "
+                << cache.evictions << " desalojos\n";
+            return true;
+
+        // del <var>: elimina una variable (protegemos pi, e, ans)
+        case Command::Del: {
+            if(c.name.empty()){ out << "Error: nombre vacio\n"; return true; }
+            if(c.name=="pi" || c.name=="e" || c.name=="ans"){ out << "Error: variable protegida\n"; return true; }
+            uint32_t slot=Symbols::find(c.name);
+            bool formula=formulas.isFormula(slot);   // una formula con error no tiene valor pero existe
+            if(!env.erase(slot) && !formula){ out << "Error: variable no existe\n"; return true; }
+            formulas.remove(slot);
+            out << "ok\n";
+            changed(slot);
+            return true;
+        }
+
+        // stats: contadores y latencias por etapa, sumados entre todos los hilos;
+        // "stats on/off" prende o apaga la medicion de tiempos
+        case Command::Stats:
+            if(c.expr.empty() || !stats::kEnabled) stats::print(out);
+            else { stats::setTiming(c.expr=="on"); out << "ok\n"; }
+            return true;
+
+        case Command::Defs:
+            for(uint32_t slot: formulas.list()) out << Symbols::name(slot) << " = " << formulas.find(slot)->source << "\n";
+            return true;
+
+        case Command::Def:
+            try{ define(c); } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        // save/load <archivo>; sin allowFiles (--serve) no se toca el disco
+        case Command::Save: case Command::Load:
+            if(!allowFiles){ err << "Error: save/load no disponible en este modo\n"; return true; }
+            try{
+                if(c.kind==Command::Save) saveSnapshot(*this, c.name); else loadSnapshot(*this, c.name);
+                out << "ok\n";
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        // sweep: tabla o reduccion sobre una grilla, en todos los nucleos; no cambia variables
+        case Command::Sweep:
+            try{ runSweep(*this, c.expr); } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        case Command::Show:
+            try{ double v=env.get(c.name); printValue(out, c.name, v); }
+            catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        case Command::BadLhs: err << "Error: LHS invalido\n"; return true;
+
+        case Command::Assign:
+            try{
+                Error e;
+                double res=evaluate(c.expr, e);
+                if(e){ error(e); return true; }
+                uint32_t slot=Symbols::intern(c.name);
+                env.set(slot, res);
+                env.set(ansSlot, res);
+                formulas.remove(slot);               // una asignacion comun reemplaza a la formula
+                if(constants.erase(c.name)){         // ya no es constante: lo plegado queda viejo
+                    cache.clear();
+                    for(uint32_t d: formulas.dependentsOf(slot)){
+                        FormulaGraph::Formula* f=formulas.find(d);
+                        f->ce=compile(f->source);
+                    }
+                }
+                printValue(out, c.name, res);
+                changed(slot, ansSlot);
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+
+        case Command::Eval:
+            try{
+                Error e;
+                double res=evaluate(c.expr, e);
+                if(e){ error(e); return true; }
+                env.set(ansSlot, res);
+                printValue(out, "ans", res);
+                changed(ansSlot);
+            } catch(const std::exception& ex){ error(ex); }
+            return true;
+    }
+    return true;
+}
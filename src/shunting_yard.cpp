@@ -1,45 +1,95 @@
 #include "shunting_yard.hpp"
+#include "tokenizer.hpp"
 
-static inline int precedence(const Token& t){ return t.precedence; }
-static inline bool rightAssoc(const Token& t){ return t.rightAssoc; }
-
-LinkedList<Token> ShuntingYard::toPostfix(LinkedList<Token>& infix){
-    LinkedList<Token> out; Stack<Token> ops;
-    Token prev; bool hasPrev=false;
-
-    for(auto it=infix.begin(); it!=infix.end(); ++it){
-        Token t = *it;
+void ShuntingYard::toPostfix(const std::vector<Token>& infix, std::vector<Token>& out){
+    out.clear(); ops.clear();
+    Token prev=makeToken(TokenType::End); bool hasPrev=false;
 
+    for(Token t: infix){
         if(t.type==TokenType::Number || t.type==TokenType::Identifier){
             out.push_back(t); hasPrev=true; prev=t; continue;
         }
 
-        if(t.type==TokenType::LParen){ ops.push(t); hasPrev=false; continue; }
+        if(t.type==TokenType::LParen){ ops.push_back(t); hasPrev=false; continue; }
 
         if(t.type==TokenType::RParen){
-            while(!ops.empty() && ops.top().type!=TokenType::LParen){ out.push_back(ops.top()); ops.pop(); }
+            while(!ops.empty() && ops.back().type!=TokenType::LParen){ out.push_back(ops.back()); ops.pop_back(); }
             if(ops.empty()) throw std::runtime_error("Parentesis desbalanceados");
-            ops.pop(); // saca '('
+            ops.pop_back(); // saca '('
             hasPrev=true; continue;
         }
 
         if(t.type==TokenType::Operator){
             // +/− unario al inicio o tras '(' u otro operador
             if((!hasPrev) || prev.type==TokenType::LParen || prev.type==TokenType::Operator){
-                if(t.text=="+"||t.text=="-") { t.unary=true; t.precedence=4; t.rightAssoc=true; }
+                if(t.op==OpCode::Add) t.op=OpCode::Pos;
+                else if(t.op==OpCode::Sub) t.op=OpCode::Neg;
             }
-            while(!ops.empty() && ops.top().type!=TokenType::LParen && (
-                  (!rightAssoc(t) && precedence(t) <= precedence(ops.top())) ||
-                  ( rightAssoc(t) && precedence(t) <  precedence(ops.top())))){
-                out.push_back(ops.top()); ops.pop();
+            int p=t.precedence(); bool right=t.rightAssoc();
+            while(!ops.empty() && ops.back().type!=TokenType::LParen && (
+                  (!right && p <= ops.back().precedence()) ||
+                  ( right && p <  ops.back().precedence()))){
+                out.push_back(ops.back()); ops.pop_back();
             }
-            ops.push(t); hasPrev=true; prev=t; continue;
+            ops.push_back(t); hasPrev=true; prev=t; continue;
         }
     }
 
     while(!ops.empty()){
-        if(ops.top().type==TokenType::LParen||ops.top().type==TokenType::RParen) throw std::runtime_error("Parentesis desbalanceados");
-        out.push_back(ops.top()); ops.pop();
+        if(ops.back().type==TokenType::LParen||ops.back().type==TokenType::RParen) throw std::runtime_error("Parentesis desbalanceados");
+        out.push_back(ops.back()); ops.pop_back();
+    }
+}
+
+// El mismo algoritmo que toPostfix con out.push_back(x) cambiado por t.push(x). Con un
+// parentesis de mas se deja de armar y se sigue leyendo: un caracter invalido mas adelante
+// tiene prioridad, igual que cuando se tokenizaba la linea entera antes de la posfija.
+// opPos lleva la posicion de cada operador apilado, para informar donde fallo.
+void ShuntingYard::parse(const char* s, size_t n, ExprTree& t, Error& e){
+    t.start(); ops.clear(); opPos.clear(); e.clear();
+    Token prev=makeToken(TokenType::End); bool hasPrev=false;
+    size_t i=0, at=0, count=0; Token tok;
+    Error unbalanced;
+
+    for(;;){
+        while(i<n && isSpace(s[i])) ++i;
+        at=i;
+        if(!Tokenizer::next(s, n, i, tok, e)) break;
+        ++count;
+        if(unbalanced) continue;
+        if(tok.type==TokenType::Number || tok.type==TokenType::Identifier){
+            t.push(tok, (uint32_t)at); hasPrev=true; prev=tok; continue;
+        }
+
+        if(tok.type==TokenType::LParen){ ops.push_back(tok); opPos.push_back((uint32_t)at); hasPrev=false; continue; }
+
+        if(tok.type==TokenType::RParen){
+            while(!ops.empty() && ops.back().type!=TokenType::LParen){ t.push(ops.back(), opPos.back()); ops.pop_back(); opPos.pop_back(); }
+            if(ops.empty()){ unbalanced.set(ErrCode::Unbalanced, (uint32_t)at); continue; }
+            ops.pop_back(); opPos.pop_back(); // saca '('
+            hasPrev=true; continue;
+        }
+
+        // +/− unario al inicio o tras '(' u otro operador
+        if((!hasPrev) || prev.type==TokenType::LParen || prev.type==TokenType::Operator){
+            if(tok.op==OpCode::Add) tok.op=OpCode::Pos;
+            else if(tok.op==OpCode::Sub) tok.op=OpCode::Neg;
+        }
+        int p=tok.precedence(); bool right=tok.rightAssoc();
+        while(!ops.empty() && ops.back().type!=TokenType::LParen && (
+              (!right && p <= ops.back().precedence()) ||
+              ( right && p <  ops.back().precedence()))){
+            t.push(ops.back(), opPos.back()); ops.pop_back(); opPos.pop_back();
+        }
+        ops.push_back(tok); opPos.push_back((uint32_t)at); hasPrev=true; prev=tok;
+    }
+    lastTokens=count;
+    if(e){ t.start(); return; }            // caracter o numero invalido: gana sobre lo demas
+
+    while(!unbalanced && !ops.empty()){
+        if(ops.back().type==TokenType::LParen){ unbalanced.set(ErrCode::Unbalanced, opPos.back()); break; }
+        t.push(ops.back(), opPos.back()); ops.pop_back(); opPos.pop_back();
     }
-    return out;
+    if(unbalanced){ t.start(); e=unbalanced; return; }
+    t.finish(e, (uint32_t)n);
 }
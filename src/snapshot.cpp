@@ -0,0 +1,354 @@
+#include "snapshot.hpp"
+#include "session.hpp"
+#include <cstdio>
+#include <cstring>
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+namespace {
+
+const char kMagic[8] = {'E','D','A','C','A','L','S','\0'};
+const uint32_t kVersion = 3;   // 2: sin la posfija aparte (es tree.nodes); 3: error como codigo
+const uint32_t kNone = 0xFFFFFFFFu;
+const uint32_t kPiConstant = 1, kEConstant = 2;   // Header::flags
+
+// tamanos de los structs que se copian tal cual + marca de orden de bytes:
+// un archivo de otra arquitectura (o de otra version de los structs) se rechaza
+uint32_t layout(){
+    const uint32_t probe=1; unsigned char little; std::memcpy(&little, &probe, 1);
+    return (uint32_t)sizeof(ExprNode) | (uint32_t)sizeof(Instr)<<8 | (uint32_t)(little ? 1 : 2)<<24;
+}
+
+struct Header {
+    char magic[8];
+    uint32_t version, layout;
+    uint64_t size;                    // largo total del archivo
+    uint64_t checksum;                // del archivo entero, con este campo en cero
+    uint32_t names, texts, vars, exprs, formulas, last, flags, reserved;
+    uint64_t values, varNames, nameOffs, nameBytes, textOffs, textBytes, exprTable, formulaTable;   // offsets
+};
+
+// los datos de cada expresion empiezan en offset: ExprNode[treeNodes], ExprNode[optNodes],
+// Instr[code], u32[treeSlots], u32[optSlots], u32[progSlots]. Los slots son indices en la
+// tabla de nombres. Con error, treeNodes es la posfija (para posfix) y no hay arbol.
+struct ExprRecord {
+    uint64_t offset;
+    uint32_t treeNodes, optNodes, code, treeSlots, optSlots, progSlots;
+    uint32_t treeRoot, optRoot;
+    uint32_t error, errorPos;         // buildError: ErrCode (0 = compilo) y posicion en el texto
+    int32_t maxStack, temps;
+};
+
+struct FormulaRecord { uint32_t name, source, expr, reserved; };
+
+// 4 carriles de 64 bits: varias veces mas rapido que FNV byte a byte y cada paso es
+// biyectivo, asi que cambiar cualquier palabra cambia el resultado
+uint64_t checksum(const char* p, size_t n){
+    const uint64_t k=0x9E3779B97F4A7C15ull;
+    uint64_t h[4]={0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull};
+    size_t i=0;
+    for(; i+32<=n; i+=32)
+        for(int l=0;l<4;++l){ uint64_t w; std::memcpy(&w, p+i+8*l, 8); h[l]=(h[l]^w)*k; h[l]^=h[l]>>29; }
+    uint64_t r=n;
+    for(; i<n; ++i) r=(r^(unsigned char)p[i])*1099511628211ull;
+    for(int l=0;l<4;++l){ r=(r^h[l])*k; r^=r>>32; }
+    return r;
+}
+
+uint64_t checksum(const Header& h, const char* body, size_t n){
+    Header z=h; z.checksum=0;
+    return checksum((const char*)&z, sizeof z) ^ checksum(body, n)*0xC2B2AE3D27D4EB4Full;
+}
+
+// -------------------- escritura --------------------
+
+struct Strings {
+    vector<uint32_t> offs{0};
+    string bytes;
+    uint32_t add(const string& s){
+        if(bytes.size()+s.size()>0xFFFFFFFFu) throw runtime_error("snapshot demasiado grande");
+        bytes+=s; offs.push_back((uint32_t)bytes.size()); return (uint32_t)offs.size()-2;
+    }
+    uint32_t count() const { return (uint32_t)offs.size()-1; }
+};
+
+class Writer {
+public:
+    vector<char> buf;
+    Writer():buf(sizeof(Header), 0){}
+    void align(){ buf.resize((buf.size()+7)&~(size_t)7, 0); }
+    uint64_t put(const void* p, size_t n){
+        align(); uint64_t at=buf.size();
+        buf.insert(buf.end(), (const char*)p, (const char*)p+n);
+        return at;
+    }
+    template<class T> uint64_t put(const vector<T>& v){ return put(v.data(), v.size()*sizeof(T)); }
+};
+
+class Saver {
+public:
+    explicit Saver(const Session& s):s(s){}
+    void write(const string& path);
+private:
+    const Session& s;
+    Writer w;
+    Strings names, texts;
+    vector<uint32_t> nameOf;                         // slot -> indice en names
+    vector<const CompiledExpr*> exprs;
+    std::unordered_map<const CompiledExpr*,uint32_t> exprIndex;
+
+    uint32_t name(uint32_t slot){
+        if(slot>=nameOf.size()) nameOf.resize(std::max<size_t>((size_t)slot+1, 2*nameOf.size()), kNone);
+        if(nameOf[slot]==kNone) nameOf[slot]=names.add(Symbols::name(slot));
+        return nameOf[slot];
+    }
+    uint32_t expr(const CompiledPtr& c){
+        auto it=exprIndex.find(c.get());
+        if(it!=exprIndex.end()) return it->second;
+        exprs.push_back(c.get());
+        return exprIndex[c.get()]=(uint32_t)exprs.size()-1;
+    }
+    vector<uint32_t> slotsOf(const vector<uint32_t>& slots){ vector<uint32_t> v; v.reserve(slots.size()); for(uint32_t x: slots) v.push_back(name(x)); return v; }
+    ExprRecord putExpr(const CompiledExpr& c);
+};
+
+// los structs se copian campo a campo sobre memoria en cero: el relleno no lleva basura
+ExprRecord Saver::putExpr(const CompiledExpr& c){
+    ExprRecord r; std::memset(&r, 0, sizeof r);
+    auto nodesOf=[](const ExprTree& t){
+        vector<ExprNode> v(t.nodes.size());
+        std::memset(v.data(), 0, v.size()*sizeof(ExprNode));
+        for(size_t i=0;i<v.size();++i){ const ExprNode& n=t.nodes[i]; v[i].num=n.num; v[i].left=n.left; v[i].right=n.right; v[i].name=n.name; v[i].op=n.op; }
+        return v;
+    };
+    vector<Instr> code(c.prog.code.size());
+    std::memset(code.data(), 0, code.size()*sizeof(Instr));
+    for(size_t i=0;i<code.size();++i){ code[i].op=c.prog.code[i].op; code[i].arg=c.prog.code[i].arg; code[i].num=c.prog.code[i].num; }
+
+    r.offset=w.put(nodesOf(c.tree));
+    w.put(nodesOf(c.optTree)); w.put(code);
+    w.put(slotsOf(c.tree.slots)); w.put(slotsOf(c.optTree.slots)); w.put(slotsOf(c.prog.slots));
+    r.treeNodes=(uint32_t)c.tree.nodes.size(); r.optNodes=(uint32_t)c.optTree.nodes.size();
+    r.code=(uint32_t)code.size(); r.treeSlots=(uint32_t)c.tree.slots.size(); r.optSlots=(uint32_t)c.optTree.slots.size();
+    r.progSlots=(uint32_t)c.prog.slots.size(); r.treeRoot=c.tree.root; r.optRoot=c.optTree.root;
+    r.error=(uint32_t)c.buildError.code; r.errorPos=c.buildError.pos;
+    r.maxStack=c.prog.maxStack; r.temps=c.prog.temps;
+    return r;
+}
+
+void Saver::write(const string& path){
+    Header h; std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version=kVersion; h.layout=layout();
+
+    vector<double> values; vector<uint32_t> varNames;
+    values.reserve(s.env.size()); varNames.reserve(s.env.size());
+    s.env.forEach([&](uint32_t slot, double v){ values.push_back(v); varNames.push_back(name(slot)); });
+    h.vars=(uint32_t)values.size();
+
+    vector<FormulaRecord> formulas;
+    for(uint32_t slot: s.formulas.list()){
+        const FormulaGraph::Formula* f=s.formulas.find(slot);
+        FormulaRecord r; r.name=name(slot); r.source=texts.add(f->source); r.expr=expr(f->ce); r.reserved=0;
+        formulas.push_back(r);
+    }
+    h.last = s.last ? expr(s.last) : kNone;
+    h.flags = (s.isConstant("pi") ? kPiConstant : 0) | (s.isConstant("e") ? kEConstant : 0);
+
+    h.values=w.put(values); h.varNames=w.put(varNames);
+    vector<ExprRecord> records;
+    for(const CompiledExpr* c: exprs) records.push_back(putExpr(*c));   // agrega nombres: antes de la tabla
+    h.nameOffs=w.put(names.offs); h.nameBytes=w.put(names.bytes.data(), names.bytes.size());
+    h.textOffs=w.put(texts.offs); h.textBytes=w.put(texts.bytes.data(), texts.bytes.size());
+    h.exprTable=w.put(records); h.formulaTable=w.put(formulas);
+    w.align();
+    h.names=names.count(); h.texts=texts.count(); h.exprs=(uint32_t)records.size(); h.formulas=(uint32_t)formulas.size();
+    h.size=w.buf.size();
+    h.checksum=checksum(h, w.buf.data()+sizeof h, w.buf.size()-sizeof h);
+    std::memcpy(w.buf.data(), &h, sizeof h);
+
+    // se escribe aparte y se renombra: un save cortado no pisa el snapshot anterior
+    string tmp=path+".tmp";
+    FILE* f=std::fopen(tmp.c_str(), "wb");
+    if(!f) throw runtime_error("no se pudo escribir "+path);
+    bool ok=std::fwrite(w.buf.data(), 1, w.buf.size(), f)==w.buf.size();
+    ok=std::fclose(f)==0 && ok;
+    if(ok && std::rename(tmp.c_str(), path.c_str())!=0){ std::remove(path.c_str()); ok=std::rename(tmp.c_str(), path.c_str())==0; }
+    if(!ok){ std::remove(tmp.c_str()); throw runtime_error("no se pudo escribir "+path); }
+}
+
+// -------------------- lectura --------------------
+
+class Loader {
+public:
+    Loader(const char* base, size_t size):base(base),size(size){}
+    Header h;
+    void header();
+    // count elementos de T en off, dentro del archivo y alineados
+    template<class T> const T* at(uint64_t off, uint64_t count) const {
+        if(off%alignof(T) || off>size || count>(size-off)/sizeof(T)) bad("seccion fuera del archivo");
+        return (const T*)(base+off);
+    }
+    string text(const uint32_t* offs, uint64_t bytesOff, uint32_t n, uint32_t i) const {
+        if(i>=n) bad("indice de texto");
+        return string(at<char>(bytesOff, offs[n])+offs[i], offs[i+1]-offs[i]);
+    }
+    CompiledPtr expr(const ExprRecord& r, uint32_t names) const;   // slots = indices de nombre del archivo
+    static void bad(const string& why){ throw runtime_error("Snapshot invalido: "+why); }
+private:
+    const char* base;
+    size_t size;
+};
+
+void Loader::header(){
+    if(size<sizeof h) bad("archivo truncado");
+    std::memcpy(&h, base, sizeof h);
+    if(std::memcmp(h.magic, kMagic, sizeof kMagic)!=0) bad("no es un snapshot de EdaCal");
+    if(h.version!=kVersion) bad("version "+std::to_string(h.version)+" (se esperaba "+std::to_string(kVersion)+")");
+    if(h.layout!=layout()) bad("generado en otra arquitectura");
+    if(h.size!=size) bad("archivo truncado");
+    if(checksum(h, base+sizeof h, size-sizeof h)!=h.checksum) bad("checksum no coincide");
+}
+
+// arbol en post-orden (o DAG en orden topologico): los hijos siempre antes que el padre.
+// Un arbol que fallo (sin raiz) es solo la posfija: los operadores pueden no tener hijos
+static void checkTree(const ExprTree& t){
+    bool partial = t.root==ExprTree::kNone;
+    auto child=[&](uint32_t c, size_t i){ return c<i || (partial && c==ExprTree::kNone); };
+    for(size_t i=0;i<t.nodes.size();++i){
+        const ExprNode& n=t.nodes[i];
+        if(n.op>OpCode::Pow) Loader::bad("nodo");
+        if(n.op==OpCode::Var && n.name>=t.slots.size()) Loader::bad("nodo");
+        if(!isLeafOp(n.op) && (!child(n.right, i) || (isBinaryOp(n.op) && !child(n.left, i)))) Loader::bad("nodo");
+    }
+    if(!partial && t.root>=t.nodes.size()) Loader::bad("raiz");
+}
+
+// la VM no revisa la pila: se simula la profundidad de cada instruccion. maxStack y temps
+// dimensionan la pila y los temporales (VM, JIT, batch): tienen que ser los que dejo el
+// Compiler, la profundidad maxima y el mayor temporal + 1, no solo cotas
+static void checkProgram(const Program& p){
+    if(p.maxStack<0 || p.temps<0) Loader::bad("programa");
+    int depth=0, deepest=0, temps=0;
+    for(const Instr& in: p.code){
+        int need=0, delta=0;
+        switch(in.op){
+            case OpCode::Const: delta=1; break;
+            case OpCode::Var: if(in.arg<0 || (size_t)in.arg>=p.slots.size()) Loader::bad("programa"); delta=1; break;
+            case OpCode::Load: if(in.arg<0 || in.arg>=p.temps) Loader::bad("programa"); delta=1; break;
+            case OpCode::Save: if(in.arg<0 || in.arg>=p.temps) Loader::bad("programa"); need=1; temps=std::max(temps, in.arg+1); break;
+            default:
+                if(in.op>OpCode::Load) Loader::bad("programa");
+                if(isBinaryOp(in.op)){ need=2; delta=-1; } else need=1;
+        }
+        if(depth<need) Loader::bad("programa");
+        depth+=delta;
+        deepest=std::max(deepest, depth);
+    }
+    if(!p.code.empty() && depth!=1) Loader::bad("programa");
+    if(deepest!=p.maxStack || temps!=p.temps) Loader::bad("programa");
+}
+
+CompiledPtr Loader::expr(const ExprRecord& r, uint32_t names) const {
+    CompiledPtr c=std::make_shared<CompiledExpr>();
+    uint64_t off=r.offset;
+    auto next=[&off](uint64_t bytes){ uint64_t at=off; off=(off+bytes+7)&~(uint64_t)7; return at; };
+    const ExprNode* tree=at<ExprNode>(next((uint64_t)r.treeNodes*sizeof(ExprNode)), r.treeNodes);
+    const ExprNode* optTree=at<ExprNode>(next((uint64_t)r.optNodes*sizeof(ExprNode)), r.optNodes);
+    const Instr* code=at<Instr>(next((uint64_t)r.code*sizeof(Instr)), r.code);
+    const uint32_t* treeSlots=at<uint32_t>(next((uint64_t)r.treeSlots*4), r.treeSlots);
+    const uint32_t* optSlots=at<uint32_t>(next((uint64_t)r.optSlots*4), r.optSlots);
+    const uint32_t* progSlots=at<uint32_t>(next((uint64_t)r.progSlots*4), r.progSlots);
+    auto slots=[names](const uint32_t* p, uint32_t n, vector<uint32_t>& out){
+        out.assign(p, p+n);
+        for(uint32_t i=0;i<n;++i) if(p[i]>=names) bad("nombre");
+    };
+
+    c->tree.nodes.assign(tree, tree+r.treeNodes); slots(treeSlots, r.treeSlots, c->tree.slots); c->tree.root=r.treeRoot;
+    c->optTree.nodes.assign(optTree, optTree+r.optNodes); slots(optSlots, r.optSlots, c->optTree.slots); c->optTree.root=r.optRoot;
+    c->prog.code.assign(code, code+r.code); slots(progSlots, r.progSlots, c->prog.slots);
+    c->prog.maxStack=r.maxStack; c->prog.temps=r.temps;
+    checkTree(c->tree); checkTree(c->optTree); checkProgram(c->prog);
+    if(r.error!=0){
+        c->buildError.set((ErrCode)r.error, r.errorPos);
+        if(!c->buildError.syntax() || c->tree.root!=ExprTree::kNone) bad("error");
+    }
+    else if(c->prog.empty() || c->tree.root==ExprTree::kNone) bad("expresion sin programa");
+    return c;
+}
+
+} // namespace
+
+void saveSnapshot(const Session& s, const string& path){ Saver(s).write(path); }
+
+uint64_t snapshotChecksum(const char* data, size_t size){
+    if(size<sizeof(Header)) return 0;
+    Header h; std::memcpy(&h, data, sizeof h);
+    return checksum(h, data+sizeof h, size-sizeof h);
+}
+
+void loadSnapshot(Session& s, const string& path){
+    MappedFile f;
+    if(!f.open(path)) throw runtime_error("no se pudo abrir "+path);
+    Loader in(f.data(), f.size());
+    in.header();
+    const Header& h=in.h;
+
+    // todo se valida con los indices de nombre del archivo y recien al final se internan los
+    // nombres: un archivo rechazado no deja nada en la tabla global
+    const uint32_t* nameOffs=in.at<uint32_t>(h.nameOffs, (uint64_t)h.names+1);
+    const char* nameBytes=in.at<char>(h.nameBytes, nameOffs[h.names]);
+    for(uint32_t i=0;i<h.names;++i) if(nameOffs[i]>nameOffs[i+1]) Loader::bad("tabla de nombres");
+    const uint32_t* textOffs=in.at<uint32_t>(h.textOffs, (uint64_t)h.texts+1);
+    for(uint32_t i=0;i<h.texts;++i) if(textOffs[i]>textOffs[i+1]) Loader::bad("tabla de textos");
+
+    const double* values=in.at<double>(h.values, h.vars);
+    const uint32_t* varNames=in.at<uint32_t>(h.varNames, h.vars);
+    for(uint32_t i=0;i<h.vars;++i) if(varNames[i]>=h.names) Loader::bad("nombre");
+
+    const ExprRecord* records=in.at<ExprRecord>(h.exprTable, h.exprs);
+    vector<CompiledPtr> exprs(h.exprs);
+    for(uint32_t i=0;i<h.exprs;++i) exprs[i]=in.expr(records[i], h.names);
+    if(h.last!=kNone && h.last>=h.exprs) Loader::bad("ultima expresion");
+
+    const FormulaRecord* fr=in.at<FormulaRecord>(h.formulaTable, h.formulas);
+    vector<string> sources(h.formulas);
+    vector<uint32_t> formulaOf(h.names, kNone);   // indice de nombre -> formula
+    for(uint32_t i=0;i<h.formulas;++i){
+        if(fr[i].name>=h.names || fr[i].expr>=h.exprs || exprs[fr[i].expr]->buildError || formulaOf[fr[i].name]!=kNone) Loader::bad("formula");
+        formulaOf[fr[i].name]=i;
+        sources[i]=in.text(textOffs, h.textBytes, h.texts, fr[i].source);
+    }
+    // ciclos entre formulas: orden topologico (Kahn); las que quedan sin ordenar estan en uno
+    vector<uint32_t> inputs(h.formulas, 0), ready;
+    vector<vector<uint32_t>> readers(h.formulas);
+    for(uint32_t i=0;i<h.formulas;++i)
+        for(uint32_t in: exprs[fr[i].expr]->tree.slots) if(formulaOf[in]!=kNone){ readers[formulaOf[in]].push_back(i); ++inputs[i]; }
+    for(uint32_t i=0;i<h.formulas;++i) if(!inputs[i]) ready.push_back(i);
+    for(size_t k=0;k<ready.size();++k) for(uint32_t r: readers[ready[k]]) if(!--inputs[r]) ready.push_back(r);
+    if(ready.size()!=h.formulas) Loader::bad("ciclo de dependencias");
+
+    // nombres -> slots de este proceso, y todo se arma aparte para pasarlo a la sesion
+    vector<uint32_t> slotOf(h.names);
+    Symbols::intern(nameBytes, nameOffs, h.names, slotOf.data());
+    auto remap=[&slotOf](vector<uint32_t>& v){ for(uint32_t& x: v) x=slotOf[x]; };
+    for(const CompiledPtr& c: exprs){ remap(c->tree.slots); remap(c->optTree.slots); remap(c->prog.slots); }
+    VarEnv env;
+    for(uint32_t i=0;i<h.vars;++i) env.set(slotOf[varNames[i]], values[i]);
+    FormulaGraph formulas;
+    for(uint32_t i=0;i<h.formulas;++i){
+        string cycle;
+        if(!formulas.define(slotOf[fr[i].name], sources[i], exprs[fr[i].expr], cycle)) Loader::bad("ciclo de dependencias: "+cycle);
+    }
+
+    s.env=std::move(env);
+    s.formulas=std::move(formulas);
+    s.last = h.last==kNone ? CompiledPtr() : exprs[h.last];
+    if(!s.env.has(s.ansSlot)) s.env.set(s.ansSlot, 0.0);
+    s.constants.clear();
+    if(h.flags&kPiConstant && s.env.has("pi")) s.constants["pi"]=s.env.get("pi");
+    if(h.flags&kEConstant && s.env.has("e")) s.constants["e"]=s.env.get("e");
+    s.cache.clear();                     // lo plegado con las constantes anteriores ya no vale
+}
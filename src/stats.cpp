@@ -0,0 +1,164 @@
+#include "stats.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace stats {
+
+static const char* const kStageNames[kStages] = { "linea", "parse", "compilar", "eval", "salida" };
+static const char* const kCounterNames[kCounters] = { "lineas", "tokens", "nodos", "errores", "asignaciones" };
+
+const char* stageName(Stage s){ return kStageNames[s]; }
+
+uint64_t Histogram::percentile(double p) const {
+    if(!count) return 0;
+    uint64_t need=(uint64_t)(p*(double)count); if(need<1) need=1;
+    uint64_t acc=0;
+    // la cota del bucket puede pasar al maximo visto: "p99< 65.5us" con "max 45.5us"
+    for(int k=0;k<64;++k){ acc+=buckets[k]; if(acc>=need) return k>=63 ? max : std::min<uint64_t>((uint64_t)1<<k, max); }
+    return max;
+}
+
+// duracion legible: 850ns, 12.5us, 3.2ms, 1.1s
+static string fmtDur(uint64_t ns){
+    char b[32];
+    if(ns<10000) snprintf(b, sizeof b, "%lluns", (unsigned long long)ns);
+    else if(ns<10000000) snprintf(b, sizeof b, "%.1fus", (double)ns/1e3);
+    else if(ns<10000000000ull) snprintf(b, sizeof b, "%.1fms", (double)ns/1e6);
+    else snprintf(b, sizeof b, "%.1fs", (double)ns/1e9);
+    return b;
+}
+
+void print(std::ostream& os){
+    if(!kEnabled){ os << "stats deshabilitado en esta compilacion\n"; return; }
+    Snapshot s=snapshot();
+    os << "stats ->";
+    for(int c=0;c<kCounters;++c) os << (c ? ", " : " ") << kCounterNames[c] << " " << s.counters[c];
+    os << "\n";
+    char b[160];
+    snprintf(b, sizeof b, "  %-9s %10s %9s %9s %9s %9s\n", "etapa", "llamadas", "media", "p50<", "p99<", "max");
+    os << b;
+    if(!timingOn()){ os << "  (latencias apagadas: stats on, --stats o --trace)\n"; return; }
+    for(int k=0;k<kStages;++k){
+        const Histogram& h=s.stages[k];
+        if(!h.count) continue;
+        snprintf(b, sizeof b, "  %-9s %10llu %9s %9s %9s %9s\n", kStageNames[k], (unsigned long long)h.count,
+                 fmtDur(h.sum/h.count).c_str(), fmtDur(h.percentile(0.5)).c_str(),
+                 fmtDur(h.percentile(0.99)).c_str(), fmtDur(h.max).c_str());
+        os << b;
+    }
+}
+
+#ifndef EDACAL_NO_STATS
+
+std::atomic<bool> timing(false);
+
+namespace {
+
+// los bloques no se liberan: lo contado por un hilo que ya termino sigue sumando
+struct Registry {
+    std::mutex m;
+    std::vector<Block*> blocks;
+};
+Registry& registry(){ static Registry* r=new Registry(); return *r; }
+
+struct Trace {
+    std::mutex m;
+    FILE* f{nullptr};
+    bool first{true};
+    uint64_t t0{0};
+};
+Trace& trace(){ static Trace* t=new Trace(); return *t; }
+std::atomic<bool> tracing(false);   // se prende/apaga mientras otros hilos registran
+
+thread_local uint64_t currentLine=0;
+
+unsigned bucketOf(uint64_t ns){ unsigned k=0; while(ns){ ns>>=1; ++k; } return k>63 ? 63 : k; }
+
+} // namespace
+
+// malloc + placement: crear el bloque no pasa por operator new (que con alloc_count.hpp
+// cuenta en el bloque)
+Block* newBlock(){
+    void* mem=std::malloc(sizeof(Block));
+    if(!mem) throw std::bad_alloc();
+    std::memset(mem, 0, sizeof(Block));
+    Block* b=new(mem) Block();
+    // ya es el bloque del hilo: lo que pida el push_back de abajo se cuenta en el y no
+    // vuelve a entrar aca (el mutex del registro no es recursivo)
+    current()=b;
+    Registry& r=registry();
+    {
+        std::lock_guard<std::mutex> lock(r.m);
+        b->tid=(unsigned)r.blocks.size()+1;
+        r.blocks.push_back(b);
+    }
+    return b;
+}
+
+void setLine(uint64_t line){ currentLine=line; }
+
+void record(Stage s, uint64_t t0, uint64_t t1){
+    Block& b=local();
+    uint64_t d=t1-t0;
+    auto& h=b.stages[s];
+    bump(h.count, 1); bump(h.sum, d); bump(h.buckets[bucketOf(d)], 1);
+    if(d>h.max.load(std::memory_order_relaxed)) h.max.store(d, std::memory_order_relaxed);
+    if(!tracing.load(std::memory_order_relaxed)) return;
+    Trace& t=trace();
+    std::lock_guard<std::mutex> lock(t.m);
+    if(!t.f) return;
+    fprintf(t.f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"line\":%llu}}",
+            t.first ? "\n" : ",\n", kStageNames[s], b.tid, (double)(t0-t.t0)/1e3, (double)d/1e3,
+            (unsigned long long)currentLine);
+    t.first=false;
+}
+
+bool openTrace(const string& path){
+    Trace& t=trace();
+    std::lock_guard<std::mutex> lock(t.m);
+    if(t.f) return false;
+    t.f=std::fopen(path.c_str(), "w");
+    if(!t.f) return false;
+    std::setvbuf(t.f, nullptr, _IOFBF, 1<<20);
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", t.f);
+    t.first=true; t.t0=now();
+    tracing=true; timing=true;
+    return true;
+}
+
+void closeTrace(){
+    Trace& t=trace();
+    std::lock_guard<std::mutex> lock(t.m);
+    if(!t.f) return;
+    std::fputs("\n]}\n", t.f);
+    std::fclose(t.f); t.f=nullptr;
+    tracing=false;
+}
+
+Snapshot snapshot(){
+    Snapshot s; std::memset(&s, 0, sizeof s);
+    Registry& r=registry();
+    std::lock_guard<std::mutex> lock(r.m);
+    for(const Block* b: r.blocks){
+        for(int c=0;c<kCounters;++c) s.counters[c]+=b->counters[c].load(std::memory_order_relaxed);
+        for(int k=0;k<kStages;++k){
+            Histogram& h=s.stages[k]; const auto& src=b->stages[k];
+            h.count+=src.count.load(std::memory_order_relaxed);
+            h.sum+=src.sum.load(std::memory_order_relaxed);
+            h.max=std::max<uint64_t>(h.max, src.max.load(std::memory_order_relaxed));
+            for(int i=0;i<64;++i) h.buckets[i]+=src.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return s;
+}
+
+#else
+
+Snapshot snapshot(){ Snapshot s; std::memset(&s, 0, sizeof s); return s; }
+
+#endif
+
+} // namespace stats
@@ -0,0 +1,291 @@
+#include "sweep.hpp"
+#include "session.hpp"
+#include "thread_pool.hpp"
+#include "fast_io.hpp"
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const uint64_t kChunk = 4096;            // puntos por bloque: fijo, no depende de los hilos
+const size_t kReduceWave = 1024;         // reducciones: bloques por tanda (fijo, por lo mismo)
+const size_t kTableWave = 8;             // Table: bloques por hilo en cada tanda de salida
+const uint64_t kMaxPoints = (uint64_t)1<<53;
+
+// parcial de un bloque, o de varios bloques contiguos ya combinados
+struct Partial {
+    double sum{0.0}, comp{0.0};          // suma de Neumaier: sum+comp
+    bool hasBest{false}; double best{0.0}; uint64_t bestAt{0};
+    uint64_t valid{0}, errors{0};
+    Error first; uint64_t firstAt{0};
+};
+
+// suma compensada (Neumaier): comp junta lo que sum pierde al redondear
+inline void addTo(double& sum, double& comp, double v){
+    double t=sum+v;
+    comp += std::fabs(sum)>=std::fabs(v) ? (sum-t)+v : (v-t)+sum;
+    sum=t;
+}
+
+inline bool extreme(Reduction r){ return r!=Reduction::Table && r!=Reduction::Sum && r!=Reduction::Mean; }
+inline bool wantsMax(Reduction r){ return r==Reduction::Max || r==Reduction::ArgMax; }
+// estricto: con empate gana el punto de indice menor. NaN no es candidato.
+inline bool better(double v, const Partial& p, Reduction r){
+    if(v!=v) return false;
+    return !p.hasBest || (wantsMax(r) ? v>p.best : v<p.best);
+}
+
+// a son los puntos anteriores a los de b: el resultado queda en a
+void merge(Partial& a, const Partial& b, Reduction r){
+    if(b.errors && !a.errors){ a.first=b.first; a.firstAt=b.firstAt; }
+    a.errors+=b.errors; a.valid+=b.valid;
+    addTo(a.sum, a.comp, b.sum); a.comp+=b.comp;
+    if(b.hasBest && better(b.best, a, r)){ a.hasBest=true; a.best=b.best; a.bestAt=b.bestAt; }
+}
+
+// estado de un hilo: solo las variables que lee el programa, copiadas una vez
+struct Worker {
+    VarEnv env; VM vm;
+    vector<uint64_t> digit;              // indice dentro de cada rango del punto actual
+    Worker(const Program& p, const VarEnv& from, size_t ranges):vm(&env),digit(ranges){
+        for(uint32_t s: p.slots) if(from.has(s)) env.set(s, from.value(s));
+    }
+};
+
+// pool de los barridos: uno por proceso, creado con el primer sweep de mas de un hilo y
+// recreado solo si se pide otra cantidad de hilos. poolMutex lo toma un barrido entero:
+// pool.wait() espera todo lo encolado, no solo lo propio.
+std::mutex poolMutex;
+std::unique_ptr<ThreadPool> sharedPool;
+
+struct Job {
+    const Program* p; const vector<SweepRange>* ranges; Reduction r;
+    ThreadPool* pool;                    // nulo: un hilo, todo en el que llama
+    const SweepStop* stop;
+    std::atomic<const char*> stopped{nullptr};
+    vector<std::unique_ptr<Worker>> workers;
+    uint64_t total{0};
+    size_t base{0};                      // primer bloque de la tanda
+    vector<Partial> parts;               // uno por bloque de la tanda
+    vector<string> text;                 // Table: filas de cada bloque de la tanda
+
+    // parte [lo,hi) a la mitad y encola la segunda: en la cola propia queda lo mas
+    // chico (LIFO) y los hilos que roban se llevan las mitades grandes
+    void split(size_t lo, size_t hi){
+        if(!pool){ for(size_t i=lo;i<hi;++i) chunk(i); return; }
+        while(hi-lo>1){ size_t mid=lo+(hi-lo)/2; pool->submit([this,mid,hi]{ split(mid, hi); }); hi=mid; }
+        chunk(lo);
+    }
+    void chunk(size_t local);
+};
+
+void Job::chunk(size_t local){
+    if(stopped) return;
+    if(*stop){ if(const char* why=(*stop)()){ stopped=why; return; } }
+    Worker& w=*workers[pool ? (size_t)pool->index() : 0];
+    const vector<SweepRange>& rg=*ranges;
+    size_t m=rg.size();
+    uint64_t i0=(uint64_t)(base+local)*kChunk, i1=std::min(total, i0+kChunk);
+    uint64_t rest=i0;
+    for(size_t k=m; k-->0;){ w.digit[k]=rest%rg[k].count; rest/=rg[k].count; w.env.set(rg[k].slot, rg[k].at(w.digit[k])); }
+
+    Partial& part=parts[local];
+    string* out = r==Reduction::Table ? &text[local] : nullptr;
+    if(out) out->clear();
+    char buf[kFixed10Max];
+    for(uint64_t i=i0;;){
+        Error e;
+        double v=w.vm.run(*p, e);
+        if(e){ if(!part.errors++){ part.first=e; part.firstAt=i; } }
+        else {
+            ++part.valid;
+            if(r==Reduction::Sum || r==Reduction::Mean) addTo(part.sum, part.comp, v);
+            else if(extreme(r) && v==v && better(v, part, r)){ part.hasBest=true; part.best=v; part.bestAt=i; }   // nan no es extremo
+        }
+        if(out){
+            for(size_t k=0;k<m;++k){ out->append(buf, formatFixed10(rg[k].at(w.digit[k]), buf)); out->push_back('\t'); }
+            if(e){ out->append("Error: "); out->append(e.message()); }
+            else out->append(buf, formatFixed10(v, buf));
+            out->push_back('\n');
+        }
+        if(++i==i1) break;
+        // siguiente punto: el ultimo rango avanza y arrastra a los de afuera
+        for(size_t k=m; k-->0;){
+            if(++w.digit[k]<rg[k].count){ w.env.set(rg[k].slot, rg[k].at(w.digit[k])); break; }
+            w.digit[k]=0; w.env.set(rg[k].slot, rg[k].from);
+        }
+    }
+}
+
+struct ReductionName { const char* name; Reduction r; };
+const ReductionName kReductions[] = {
+    { "sum", Reduction::Sum }, { "min", Reduction::Min }, { "max", Reduction::Max },
+    { "argmin", Reduction::ArgMin }, { "argmax", Reduction::ArgMax }, { "mean", Reduction::Mean },
+};
+
+void fail(Session& s, const string& msg){ stats::count(stats::Errors); s.err << "Error: " << msg << "\n"; }
+void fail(Session& s, const Error& e){ stats::count(stats::Errors); s.err << "Error: "; e.print(s.err); s.err << "\n"; }
+
+// extremo de un rango: cualquier expresion, evaluada con las variables de la sesion
+bool bound(Session& s, const string& text, double& v){
+    Error e;
+    CompiledPtr c=s.compile(text, e);
+    if(c && c->buildError) e=c->buildError;
+    if(!e){ VM vm(&s.env); v=vm.run(c->prog, e); }
+    if(e){ fail(s, e); return false; }
+    return true;
+}
+
+// "x=ini:fin[:paso]"; fin se incluye si cae en la grilla (con tolerancia de redondeo)
+bool parseRange(Session& s, const string& item, SweepRange& out){
+    size_t eq=item.find('=');
+    string name=trim(item.substr(0, eq==string::npos ? 0 : eq));
+    bool okName=!name.empty() && isAlphaC(name[0]);
+    for(char ch: name) okName = okName && (isAlphaC(ch) || isDigitC(ch));
+    if(eq==string::npos || !okName){ fail(s, "rango invalido: "+item); return false; }
+    if(s.isConstant(name)){ fail(s, "variable protegida"); return false; }
+    vector<string> parts;
+    for(size_t i=eq+1;;){
+        size_t j=item.find(':', i);
+        parts.push_back(trim(item.substr(i, j==string::npos ? string::npos : j-i)));
+        if(j==string::npos) break;
+        i=j+1;
+    }
+    if(parts.size()<2 || parts.size()>3){ fail(s, "rango invalido: "+item); return false; }
+    double from, to, step=1.0;
+    if(!bound(s, parts[0], from) || !bound(s, parts[1], to)) return false;
+    if(parts.size()==3 && !bound(s, parts[2], step)) return false;
+    double span=(to-from)/step;
+    if(step==0 || !std::isfinite(from) || !std::isfinite(span) || span<-1e-9 || span>=(double)kMaxPoints){
+        fail(s, "rango invalido: "+item); return false;
+    }
+    out.slot=Symbols::intern(name); out.from=from; out.step=step;
+    out.count=(uint64_t)std::floor(std::max(0.0, span)+1e-9)+1;
+    return true;
+}
+
+// "x = 0.5000000000, y = 1.0000000000"
+string pointText(const vector<SweepRange>& ranges, uint64_t i){
+    string t; char buf[kFixed10Max];
+    for(size_t k=0;k<ranges.size();++k){
+        if(k) t+=", ";
+        t+=Symbols::name(ranges[k].slot); t+=" = "; t.append(buf, formatFixed10(sweepValue(ranges, i, k), buf));
+    }
+    return t;
+}
+
+} // namespace
+
+double sweepValue(const vector<SweepRange>& ranges, uint64_t i, size_t k){
+    for(size_t j=ranges.size(); --j>k;) i/=ranges[j].count;
+    return ranges[k].at(i%ranges[k].count);
+}
+
+SweepResult sweep(const Program& p, const VarEnv& env, const vector<SweepRange>& ranges,
+                  Reduction r, unsigned threads, std::ostream* table, const SweepStop& stop){
+    SweepResult res;
+    uint64_t total=1;
+    for(const SweepRange& g: ranges) total*=g.count;
+    res.points=total;
+    if(!total || ranges.empty()) return res;
+    uint64_t chunks=(total+kChunk-1)/kChunk;
+    unsigned n = threads ? threads : ThreadPool::defaultSize();
+    std::unique_lock<std::mutex> lk;
+    ThreadPool* pool=nullptr;
+    if(n>1 && chunks>1){
+        lk=std::unique_lock<std::mutex>(poolMutex);
+        if(!sharedPool || sharedPool->size()!=n){ sharedPool.reset(); sharedPool.reset(new ThreadPool(n)); }
+        pool=sharedPool.get();
+    }
+
+    Job j; j.p=&p; j.ranges=&ranges; j.r=r; j.pool=pool; j.stop=&stop; j.total=total;
+    for(unsigned w=0; w<(pool ? pool->size() : 1); ++w) j.workers.emplace_back(new Worker(p, env, ranges.size()));
+    size_t wave = r==Reduction::Table ? (size_t)n*kTableWave : kReduceWave;
+    Partial acc;
+    for(uint64_t c0=0; c0<chunks; c0+=wave){
+        size_t len=(size_t)std::min<uint64_t>(wave, chunks-c0);
+        j.base=(size_t)c0; j.parts.assign(len, Partial());
+        if(r==Reduction::Table) j.text.resize(len);
+        if(pool){ pool->submit([&j,len]{ j.split(0, len); }); pool->wait(); }
+        else j.split(0, len);
+        if(j.stopped){ res.stopped=j.stopped; return res; }
+        // arbol por indice de bloque: no depende de que hilo calculo cada parcial
+        for(size_t s=1; s<len; s*=2)
+            for(size_t i=0; i+s<len; i+=2*s) merge(j.parts[i], j.parts[i+s], r);
+        merge(acc, j.parts[0], r);
+        if(table) for(size_t i=0;i<len;++i) table->write(j.text[i].data(), (std::streamsize)j.text[i].size());
+    }
+
+    res.valid=acc.valid; res.errors=acc.errors; res.first=acc.first; res.firstAt=acc.firstAt;
+    if(r==Reduction::Sum) res.value=acc.sum+acc.comp;
+    else if(r==Reduction::Mean) res.value = acc.valid ? (acc.sum+acc.comp)/(double)acc.valid : 0.0;
+    else if(extreme(r)){
+        res.found=acc.hasBest;
+        res.value = acc.hasBest ? acc.best : std::numeric_limits<double>::quiet_NaN();
+        res.at=acc.bestAt;
+    }
+    return res;
+}
+
+void runSweep(Session& s, const string& args){
+    static const char* usage="uso: sweep [sum|min|max|argmin|argmax|mean] expr for x=ini:fin[:paso], y=...";
+    Reduction r=Reduction::Table; const char* rname="";
+    string rest=args;
+    size_t sp=rest.find(' ');
+    if(sp!=string::npos)
+        for(const ReductionName& rn: kReductions)
+            if(rest.compare(0, sp, rn.name)==0){ r=rn.r; rname=rn.name; rest=trim(rest.substr(sp+1)); break; }
+    size_t f=rest.rfind(" for ");
+    if(f==string::npos){ fail(s, usage); return; }
+    string expr=trim(rest.substr(0, f)), spec=trim(rest.substr(f+5));
+    if(expr.empty() || spec.empty()){ fail(s, usage); return; }
+
+    vector<SweepRange> ranges;
+    uint64_t total=1;
+    for(size_t i=0;;){
+        size_t j=spec.find(',', i);
+        SweepRange g;
+        if(!parseRange(s, spec.substr(i, j==string::npos ? string::npos : j-i), g)) return;
+        for(const SweepRange& h: ranges) if(h.slot==g.slot){ fail(s, "variable repetida: "+Symbols::name(g.slot)); return; }
+        if(g.count>kMaxPoints/total){ fail(s, "demasiados puntos"); return; }
+        total*=g.count; ranges.push_back(g);
+        if(j==string::npos) break;
+        i=j+1;
+    }
+    if(s.sweepMaxPoints && total>s.sweepMaxPoints){ fail(s, "demasiados puntos (maximo "+std::to_string(s.sweepMaxPoints)+")"); return; }
+
+    Error e;
+    CompiledPtr c=s.compile(expr, e);
+    if(c && c->buildError) e=c->buildError;
+    if(e){ fail(s, e); return; }
+
+    if(r==Reduction::Table){
+        for(const SweepRange& g: ranges) s.out << Symbols::name(g.slot) << '\t';
+        s.out << expr << '\n';
+        SweepResult res=sweep(c->prog, s.env, ranges, r, s.sweepThreads, &s.out, s.sweepStop);
+        if(res.stopped) fail(s, string("barrido cortado: ")+res.stopped);
+        return;
+    }
+    SweepResult res=sweep(c->prog, s.env, ranges, r, s.sweepThreads, nullptr, s.sweepStop);
+    if(res.stopped){ fail(s, string("barrido cortado: ")+res.stopped); return; }
+    if(extreme(r) && !res.found){
+        stats::count(stats::Errors);
+        s.err << "Error: ningun punto valido para " << rname << " (" << res.points << " puntos con nan o error)\n";
+    }
+    else if(res.valid){
+        if(r==Reduction::ArgMin || r==Reduction::ArgMax)
+            for(size_t k=0;k<ranges.size();++k) Session::printValue(s.out, Symbols::name(ranges[k].slot), sweepValue(ranges, res.at, k));
+        Session::printValue(s.out, r==Reduction::ArgMin ? "min" : r==Reduction::ArgMax ? "max" : rname, res.value);
+    }
+    if(res.errors){
+        stats::count(stats::Errors);
+        s.err << "Error: " << res.errors << " de " << res.points << " puntos con error; el primero en "
+              << pointText(ranges, res.firstAt) << ": ";
+        res.first.print(s.err); s.err << "\n";
+    }
+}
@@ -0,0 +1,148 @@
+#include "symbols.hpp"
+#include <mutex>
+
+namespace {
+
+// 4096 bloques de 4096 nombres: el arreglo de bloques es fijo, nunca se realoca
+const uint32_t kChunkBits = 12;
+const uint32_t kChunk = 1u << kChunkBits;
+const uint32_t kMaxChunks = 4096;
+
+// Indice global: hash abierto con sondeo lineal, 8 bytes por entrada
+// ((hash>>32)<<32 | id+1; 0 = vacia). La posicion sale de los mismos 32 bits altos, asi
+// crecer no vuelve a leer los nombres. Sin un nodo por nombre: cargar un snapshot con
+// 10^6 nombres son 10^6 escrituras en un arreglo, no 10^6 asignaciones de memoria.
+struct Table {
+    std::mutex m;
+    std::vector<uint64_t> index;
+    string* chunks[kMaxChunks];
+    uint32_t count;
+    Table(): count(0) { for(uint32_t i=0;i<kMaxChunks;++i) chunks[i]=nullptr; }
+    ~Table(){ for(uint32_t i=0;i<kMaxChunks;++i) delete[] chunks[i]; }
+
+    const string& name(uint32_t id) const { return chunks[id>>kChunkBits][id&(kChunk-1)]; }
+    static uint64_t hash(StrRef key){ return (uint64_t)StrRefHash()(key); }
+    static size_t slot(uint64_t h){ return (size_t)(h>>32); }
+
+    // kNone si no esta; pos queda en la entrada vacia donde iria
+    uint32_t find(StrRef key, uint64_t h, size_t& pos) const {
+        if(index.empty()){ pos=0; return Symbols::kNone; }
+        size_t mask=index.size()-1;
+        for(pos=slot(h)&mask; ; pos=(pos+1)&mask){
+            uint64_t e=index[pos];
+            if(!e) return Symbols::kNone;
+            if((e>>32)!=(h>>32)) continue;
+            uint32_t id=(uint32_t)e-1;
+            const string& s=name(id);
+            if(s.size()==key.n && std::memcmp(s.data(), key.p, key.n)==0) return id;
+        }
+    }
+    // deja lugar para n nombres mas con carga <= 1/2
+    void reserve(size_t n){
+        size_t need=2*((size_t)count+n), cap=index.empty() ? 1024 : index.size();
+        while(cap<need) cap*=2;
+        if(cap==index.size()) return;
+        std::vector<uint64_t> old(cap, 0); old.swap(index);
+        for(uint64_t e: old) if(e){
+            size_t pos=slot(e)&(cap-1);
+            while(index[pos]) pos=(pos+1)&(cap-1);
+            index[pos]=e;
+        }
+    }
+    uint32_t add(StrRef key, uint64_t h, size_t pos){
+        uint32_t id=count;
+        if((id>>kChunkBits)>=kMaxChunks) throw TooManySymbols("Demasiados identificadores");
+        string*& chunk=chunks[id>>kChunkBits];
+        if(!chunk) chunk=new string[kChunk];
+        chunk[id&(kChunk-1)].assign(key.p, key.n);
+        index[pos]=(h>>32)<<32 | (uint64_t)(id+1);
+        ++count;
+        return id;
+    }
+    uint32_t intern(StrRef key, uint64_t h){
+        size_t pos;
+        uint32_t id=find(key, h, pos);
+        if(id!=Symbols::kNone) return id;
+        if(2*((size_t)count+1)>index.size()){ reserve(1); find(key, h, pos); }
+        return add(key, h, pos);
+    }
+};
+
+Table& table(){ static Table t; return t; }
+
+typedef std::unordered_map<StrRef,uint32_t,StrRefHash> LocalMap;
+LocalMap& localMap(){ static thread_local LocalMap m; return m; }
+struct Quota { uint32_t* remaining; uint32_t* shared; };
+Quota& quota(){ static thread_local Quota q={nullptr, nullptr}; return q; }
+
+}
+
+const uint32_t Symbols::kNone;
+
+uint32_t Symbols::find(const char* p, size_t n){
+    LocalMap& local=localMap();
+    StrRef key{p, n};
+    auto it=local.find(key);
+    if(it!=local.end()) return it->second;
+    Table& t=table();
+    uint32_t id;
+    const string* stored;
+    {
+        std::lock_guard<std::mutex> lock(t.m);
+        size_t pos;
+        id=t.find(key, Table::hash(key), pos);
+        if(id==kNone) return kNone;
+        stored=&t.name(id);
+    }
+    local.emplace(StrRef{stored->data(), stored->size()}, id);
+    return id;
+}
+
+uint32_t Symbols::intern(const char* p, size_t n){
+    LocalMap& local=localMap();
+    StrRef key{p, n};
+    auto it=local.find(key);
+    if(it!=local.end()) return it->second;
+
+    Table& t=table();
+    uint32_t id;
+    const string* stored;
+    {
+        std::lock_guard<std::mutex> lock(t.m);
+        uint64_t h=Table::hash(key);
+        size_t pos;
+        Quota& q=quota();
+        if((q.remaining || q.shared) && t.find(key, h, pos)==kNone){
+            if((q.remaining && !*q.remaining) || (q.shared && !*q.shared)) throw TooManySymbols("Demasiados identificadores nuevos");
+            if(q.remaining) --*q.remaining;
+            if(q.shared) --*q.shared;
+        }
+        id=t.intern(key, h);
+        stored=&t.name(id);
+    }
+    local.emplace(StrRef{stored->data(), stored->size()}, id);
+    return id;
+}
+
+// primero todos los hashes, despues las entradas con prefetch unas cuantas por delante:
+// los accesos al indice (fuera de cache con 10^6 nombres) se solapan en vez de esperarse
+void Symbols::intern(const char* bytes, const uint32_t* offs, size_t n, uint32_t* ids){
+    const size_t kAhead = 16;
+    std::vector<uint64_t> hs(n);
+    for(size_t i=0;i<n;++i) hs[i]=Table::hash(StrRef{bytes+offs[i], offs[i+1]-offs[i]});
+    Table& t=table();
+    std::lock_guard<std::mutex> lock(t.m);
+    if(t.count<n) t.reserve(n);          // al arrancar casi todos son nuevos: se crece una vez
+    for(size_t i=0;i<n;++i){
+#if defined(__GNUC__)
+        if(i+kAhead<n) __builtin_prefetch(&t.index[Table::slot(hs[i+kAhead])&(t.index.size()-1)]);
+#endif
+        ids[i]=t.intern(StrRef{bytes+offs[i], offs[i+1]-offs[i]}, hs[i]);
+    }
+}
+
+void Symbols::setQuota(uint32_t* remaining, uint32_t* shared){ quota().remaining=remaining; quota().shared=shared; }
+
+const string& Symbols::name(uint32_t id){
+    return table().name(id);
+}
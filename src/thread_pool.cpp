@@ -0,0 +1,72 @@
+#include "thread_pool.hpp"
+
+using std::function;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+
+// indice del worker que ejecuta el hilo actual (-1 fuera de cualquier pool)
+static thread_local int tlsWorker = -1;
+static thread_local const ThreadPool* tlsPool = nullptr;
+
+unsigned ThreadPool::defaultSize(){
+    unsigned n=std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+int ThreadPool::index() const { return tlsPool==this ? tlsWorker : -1; }
+
+ThreadPool::ThreadPool(unsigned n){
+    if(n==0) n=1;
+    for(unsigned i=0;i<n;++i) queues.emplace_back(new Queue());
+    for(unsigned i=0;i<n;++i) threads.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool(){
+    { lock_guard<mutex> lk(m); stop=true; }
+    wake.notify_all();
+    for(auto& t: threads) t.join();
+}
+
+void ThreadPool::submit(function<void()> task){
+    unsigned q = (tlsPool==this) ? (unsigned)tlsWorker : next++ % size();
+    { lock_guard<mutex> lk(m); ++queued; ++pending; } // antes del push: queued nunca queda negativo
+    { lock_guard<mutex> lk(queues[q]->m); queues[q]->q.push_back(std::move(task)); }
+    wake.notify_one();
+}
+
+void ThreadPool::wait(){
+    unique_lock<mutex> lk(m);
+    idle.wait(lk, [&]{ return pending==0; });
+}
+
+bool ThreadPool::take(unsigned self, function<void()>& task){
+    {   Queue& own=*queues[self];
+        lock_guard<mutex> lk(own.m);
+        if(!own.q.empty()){ task=std::move(own.q.back()); own.q.pop_back(); return true; }
+    }
+    for(unsigned k=1;k<queues.size();++k){
+        Queue& other=*queues[(self+k)%queues.size()];
+        lock_guard<mutex> lk(other.m);
+        if(!other.q.empty()){ task=std::move(other.q.front()); other.q.pop_front(); return true; }
+    }
+    return false;
+}
+
+void ThreadPool::worker(unsigned self){
+    tlsWorker=(int)self; tlsPool=this;
+    function<void()> task;
+    while(true){
+        if(take(self, task)){
+            { lock_guard<mutex> lk(m); --queued; }
+            task(); task=nullptr;
+            bool last;
+            { lock_guard<mutex> lk(m); last = --pending==0; }
+            if(last) idle.notify_all();
+            continue;
+        }
+        unique_lock<mutex> lk(m);
+        wake.wait(lk, [&]{ return stop || queued>0; });
+        if(stop && queued==0) return;
+    }
+}
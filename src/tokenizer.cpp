@@ -1,55 +1,113 @@
 #include "tokenizer.hpp"
+#include "symbols.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 
 using std::string;
-using std::unordered_set;
 
-static bool isFunc(const string& name){
-    static const unordered_set<string> F = {"sqrt","sin","cos","tan","log","ln"};
-    return F.count(name) > 0;
+// potencias de 10 exactas en double
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Camino rapido (Clinger): si la mantisa entra exacta en un double (<= 2^53) y la
+// potencia de 10 tambien (<= 1e22), m / 10^k es una sola operacion IEEE y sale
+// correctamente redondeada. Lo demas (mas de 19 cifras, numeros enormes o diminutos)
+// va a strtod, que tambien redondea bien y avisa ERANGE igual que stod.
+ErrCode parseDecimal(const char* p, size_t n, double& v){
+    uint64_t m=0; int digits=0, exp10=0;
+    bool any=false, afterDot=false, exact=true;
+    for(size_t i=0;i<n;++i){
+        char c=p[i];
+        if(c=='.'){ afterDot=true; continue; }
+        any=true;
+        unsigned d=(unsigned)(c-'0');
+        if(digits<19){
+            if(m || d){ m=m*10+d; ++digits; }
+            if(afterDot) --exp10;
+        } else {
+            if(d) exact=false;
+            if(!afterDot) ++exp10;
+        }
+    }
+    if(!any) return ErrCode::BadNumber;
+    if(exact && m<=(1ull<<53) && exp10>=-22 && exp10<=22){
+        v = exp10<0 ? (double)m/kPow10[-exp10] : (double)m*kPow10[exp10];
+        return ErrCode::None;
+    }
+
+    char small[64]; string big;
+    const char* s;
+    if(n<sizeof(small)){ std::memcpy(small, p, n); small[n]='\0'; s=small; }
+    else { big.assign(p, n); s=big.c_str(); }
+    errno=0;
+    v=std::strtod(s, nullptr);
+    return errno==ERANGE ? ErrCode::NumberRange : ErrCode::None;
 }
 
-LinkedList<Token> Tokenizer::tokenize(const string& s){
-    LinkedList<Token> out;
-    size_t i=0, n=s.size();
+double parseDecimal(const char* p, size_t n){
+    double v=0.0;
+    ErrCode c=parseDecimal(p, n, v);
+    if(c!=ErrCode::None){ Error e; e.set(c, 0); e.raise(); }
+    return v;
+}
 
-    while(i<n){
-        if(isSpace(s[i])){ ++i; continue; }
+static bool funcOp(const char* p, size_t n, OpCode& op){
+    switch(n){
+        case 2: if(!std::memcmp(p,"ln",2)){ op=OpCode::Ln; return true; } return false;
+        case 3:
+            if(!std::memcmp(p,"sin",3)){ op=OpCode::Sin; return true; }
+            if(!std::memcmp(p,"cos",3)){ op=OpCode::Cos; return true; }
+            if(!std::memcmp(p,"tan",3)){ op=OpCode::Tan; return true; }
+            if(!std::memcmp(p,"log",3)){ op=OpCode::Log; return true; }
+            return false;
+        case 4: if(!std::memcmp(p,"sqrt",4)){ op=OpCode::Sqrt; return true; } return false;
+        default: return false;
+    }
+}
 
-        if(isDigitC(s[i]) || (s[i]=='.')){
-            size_t j=i; bool dot=(s[i]=='.'); ++i;
-            while(i<n && (isDigitC(s[i]) || (!dot && s[i]=='.'))){ dot = dot || (s[i]=='.'); ++i; }
-            double val = std::stod(s.substr(j, i-j));
-            Token t; t.type=TokenType::Number; t.text=""; t.value=val; t.precedence=-1; t.rightAssoc=false; t.unary=false;
-            out.push_back(t);
-            continue;
-        }
+bool Tokenizer::next(const char* s, size_t n, size_t& i, Token& t, Error& e){
+    while(i<n && isSpace(s[i])) ++i;
+    if(i>=n) return false;
 
-        if(isAlphaC(s[i])){
-            size_t j=i; ++i; while(i<n && (isAlphaC(s[i])||isDigitC(s[i]))) ++i;
-            string name = s.substr(j, i-j);
-            if(isFunc(name)){
-                Token t; t.type=TokenType::Operator; t.text=name; t.value=0; t.precedence=4; t.rightAssoc=true; t.unary=true;
-                out.push_back(t);
-            } else {
-                Token t; t.type=TokenType::Identifier; t.text=name; t.value=0; t.precedence=-1; t.rightAssoc=false; t.unary=false;
-                out.push_back(t);
-            }
-            continue;
-        }
+    if(isDigitC(s[i]) || (s[i]=='.')){
+        size_t j=i; bool dot=(s[i]=='.'); ++i;
+        while(i<n && (isDigitC(s[i]) || (!dot && s[i]=='.'))){ dot = dot || (s[i]=='.'); ++i; }
+        t=makeToken(TokenType::Number);
+        ErrCode c=parseDecimal(s+j, i-j, t.value);
+        if(c!=ErrCode::None){ e.set(c, (uint32_t)j); return false; }
+        return true;
+    }
 
-        // operadores y paréntesis
-        char c=s[i++];
-        if(c=='('){ Token t; t.type=TokenType::LParen; t.text="("; t.value=0; t.precedence=-1; t.rightAssoc=false; t.unary=false; out.push_back(t); continue; }
-        if(c==')'){ Token t; t.type=TokenType::RParen; t.text=")"; t.value=0; t.precedence=-1; t.rightAssoc=false; t.unary=false; out.push_back(t); continue; }
-        if(string("+-*/^").find(c)!=string::npos){
-            Token t; t.type=TokenType::Operator; t.text=string(1,c); t.value=0; t.precedence=-1; t.rightAssoc=false; t.unary=false;
-            if(c=='+'||c=='-') t.precedence=1;
-            if(c=='*'||c=='/') t.precedence=2;
-            if(c=='^'){ t.precedence=3; t.rightAssoc=true; }
-            out.push_back(t); continue;
-        }
+    if(isAlphaC(s[i])){
+        size_t j=i; ++i; while(i<n && (isAlphaC(s[i])||isDigitC(s[i]))) ++i;
+        OpCode op;
+        if(funcOp(s+j, i-j, op)) t=makeToken(TokenType::Operator, op);
+        else { t=makeToken(TokenType::Identifier); t.sym=Symbols::intern(s+j, i-j); }
+        return true;
+    }
 
-        throw std::runtime_error(string("Caracter no reconocido: ")+c);
+    // operadores y paréntesis (+ y - salen binarios; ShuntingYard decide si son unarios)
+    char c=s[i++];
+    switch(c){
+        case '(': t=makeToken(TokenType::LParen); return true;
+        case ')': t=makeToken(TokenType::RParen); return true;
+        case '+': t=makeToken(TokenType::Operator, OpCode::Add); return true;
+        case '-': t=makeToken(TokenType::Operator, OpCode::Sub); return true;
+        case '*': t=makeToken(TokenType::Operator, OpCode::Mul); return true;
+        case '/': t=makeToken(TokenType::Operator, OpCode::Div); return true;
+        case '^': t=makeToken(TokenType::Operator, OpCode::Pow); return true;
+        default: break;
     }
-    return out;
+    e.set(ErrCode::BadChar, (uint32_t)(i-1), (unsigned char)c);
+    return false;
+}
+
+void Tokenizer::tokenize(const char* s, size_t n, std::vector<Token>& out){
+    out.clear();
+    size_t i=0; Token t; Error e;
+    while(next(s, n, i, t, e)) out.push_back(t);
+    if(e) e.raise();
 }
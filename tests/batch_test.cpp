@@ -0,0 +1,67 @@
+// Compara BatchEvaluator (todas las ISA soportadas) contra Evaluator::eval fila por fila.
+// Los errores deben coincidir exactamente; los valores, dentro de una tolerancia relativa.
+// g++ -std=c++11 -O2 -Iinclude -o batch_test tests/batch_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/bytecode.cpp src/batch.cpp
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "batch.hpp"
+#include <random>
+using namespace std;
+
+static bool close(double got, double ref, double tol){
+    if(std::isnan(ref)) return std::isnan(got);
+    if(std::isinf(ref)) return got==ref;
+    return std::fabs(got-ref) <= tol*std::max(1.0, std::fabs(ref));
+}
+
+int main(){
+    const char* formulas[] = {
+        "sqrt(x^2+y^2)", "x+y*2-x/3", "-x^3+y^-2", "sin(x)*cos(y)", "sin(x)^2+cos(x)^2",
+        "log(x)+ln(y)", "ln(x*x+1)", "x/y", "sqrt(x)", "tan(x)+x^0.5", "sin(pi*x)", "cos(x/1000)",
+        "log(sqrt(x))*e", "2^x", "(x-y)/(x+y)", "z+x", "x/(y-y)", "ln(-abs)"
+    };
+    mt19937 rng(2024);
+    uniform_real_distribution<double> small(-10, 10), wide(-1e6, 1e6), tiny(-1e-300, 1e-300);
+
+    Table t; t.names = {"x", "y"}; t.cols.resize(2);
+    const double specials[] = {0.0, -0.0, 1.0, -1.0, 0.5, 3.14159265358979, 1e-310, 1e300, 99999.5, -100001.0};
+    for(double s: specials){ t.cols[0].push_back(s); t.cols[1].push_back(s); }
+    for(int i=0;i<5000;++i){
+        int k=i%10;
+        t.cols[0].push_back(k<7 ? small(rng) : k<9 ? wide(rng) : tiny(rng));
+        t.cols[1].push_back(k==3 ? 0.0 : small(rng));
+    }
+    t.rows=t.cols[0].size();
+
+    VarEnv env; env.set("ans", 0.0); env.set("pi", 3.14159265358979323846); env.set("e", 2.71828182845904523536);
+    Tokenizer tk; ShuntingYard sy; Compiler comp; ExprTree tree; Evaluator ev(&env);
+    int fails=0; size_t rowsChecked=0;
+    for(int isa=BatchEvaluator::Scalar; isa<=BatchEvaluator::AVX2; ++isa){
+        if(!BatchEvaluator::supported((BatchEvaluator::Isa)isa)) continue;
+        BatchEvaluator be(&env, (BatchEvaluator::Isa)isa);
+        double tol = isa==BatchEvaluator::Scalar ? 0.0 : 1e-13;
+        for(const char* f: formulas){
+            auto inf=tk.tokenize(f); auto post=sy.toPostfix(inf); tree.buildFromPostfix(post);
+            Program prog=comp.compile(tree);
+            vector<double> out; vector<unsigned char> err;
+            be.run(prog, t, out, err);
+            for(size_t r=0;r<t.rows;++r){
+                env.set("x", t.cols[0][r]); env.set("y", t.cols[1][r]);
+                string refErr; double ref=0;
+                try{ ref=ev.eval(tree); } catch(const exception& ex){ refErr=ex.what(); }
+                string gotErr = err[r] ? be.message(err[r]) : "";
+                ++rowsChecked;
+                if(refErr!=gotErr || (refErr.empty() && !close(out[r], ref, tol))){
+                    if(++fails<=20) printf("FAIL [%s] %s x=%.17g y=%.17g: ref=%.17g%s got=%.17g%s\n",
+                        BatchEvaluator::isaName((BatchEvaluator::Isa)isa), f, t.cols[0][r], t.cols[1][r],
+                        ref, refErr.c_str(), out[r], gotErr.c_str());
+                }
+            }
+        }
+        env.erase("x"); env.erase("y");
+    }
+    printf("batch_test: %zu filas comparadas, %d fallas\n", rowsChecked, fails);
+    return fails ? 1 : 0;
+}
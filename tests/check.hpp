@@ -0,0 +1,11 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include "common.hpp"
+
+// chequeo comun de los tests: cuenta las fallas y muestra las primeras 10;
+// cada test termina con "return fails ? 1 : 0"
+static int fails=0;
+static void expect(bool ok, const string& what){ if(!ok){ ++fails; if(fails<=10) std::cout << "FALLA: " << what << "\n"; } }
+
+#endif // CHECK_HPP
@@ -0,0 +1,120 @@
+// Formulas parseadas al compilar (ct_expr.hpp) contra el camino normal Tokenizer ->
+// ShuntingYard -> ExprTree -> Evaluator: mismo valor bit a bit y mismo mensaje de error
+// para muchas filas de valores. Los textos mal formados se revisan con Syntax<>::error
+// (static_assert: si el parser se equivoca, este archivo no compila). Con -DEDACAL_CT_BAD
+// se declara una formula con un parentesis de mas y la compilacion tiene que fallar.
+// g++ -std=c++11 -O2 -Iinclude -o ct_expr_test tests/ct_expr_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp
+#include "ct_expr.hpp"
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "check.hpp"
+#include <cstring>
+#include <random>
+using namespace std;
+using namespace edacal::ct;
+
+#define FORMULA(Name, text) EDACAL_FORMULA(Name, text); \
+    static const Case Name##_case = { text, Name::variables, &Name::variable, &Name::eval }
+
+struct Case {
+    const char* text;
+    unsigned variables;
+    string (*variable)(unsigned);
+    double (*eval)(const double*);
+};
+
+FORMULA(F01, "sqrt(x^2 + y^2)");
+FORMULA(F02, "-x^2");
+FORMULA(F03, "2^3^2");
+FORMULA(F04, "2^-2^2 + -2^-2");
+FORMULA(F05, "(x+1)*(x+1)-y/3");
+FORMULA(F06, "log(x)+ln(y)");
+FORMULA(F07, "x/(y-y)");
+FORMULA(F08, "sqrt(-x)");
+FORMULA(F09, "+-x - -+y");
+FORMULA(F10, "sin(x)*cos(y)+tan(x/7)");
+FORMULA(F11, "sqrt sqrt 16 + sqrt x^2");
+FORMULA(F12, "((((x))))");
+FORMULA(F13, "x - y - z - 1");
+FORMULA(F14, "x / y / z");
+FORMULA(F15, "y*z + x*y + z");
+FORMULA(F16, ".5 + 0.1 + 2.25 + 1234567.875 + 0.000001");
+FORMULA(F17, "9007199254740992 - 123456789012345.5 + 0.0000000000000000000001");
+FORMULA(F18, "ln(x) / log(y)");
+FORMULA(F19, "x^0.5 + y^-1 + z^3");
+FORMULA(F20, "  velocidad*tiempo  +  0.5*g*tiempo^2 ");
+FORMULA(F21, "ln y / (x - 2) + sqrt(z - 1)");
+FORMULA(F22, "-sqrt(x*x + 1) ^ 2");
+FORMULA(F23, "cos -x + sin +y");
+FORMULA(F24, "a1*b_2 - a1/(b_2+1) + _c^2");
+FORMULA(F25, "((x+y)*(x-y))/((x+y)*(x+y)+1)");
+FORMULA(F26, "x+x+x+x+x+x+x+x+x+x+x+x+x+x+x+x*2^0.5");
+
+static const Case* const kCases[] = {
+    &F01_case, &F02_case, &F03_case, &F04_case, &F05_case, &F06_case, &F07_case, &F08_case, &F09_case,
+    &F10_case, &F11_case, &F12_case, &F13_case, &F14_case, &F15_case, &F16_case, &F17_case, &F18_case,
+    &F19_case, &F20_case, &F21_case, &F22_case, &F23_case, &F24_case, &F25_case, &F26_case,
+};
+
+// errores al compilar, en el mismo orden que el REPL: lexico, parentesis, sintaxis
+#define SYNTAX(line, text, code) EDACAL_FORMULA_TEXT(S##line, text); static_assert(Syntax<S##line>::error==code, text)
+SYNTAX(1, "(x+1", Unbalanced);
+SYNTAX(2, "x+1)", Unbalanced);
+SYNTAX(3, ")x(", Unbalanced);
+SYNTAX(4, "x $ y", BadChar);
+SYNTAX(5, "(x $ y", BadChar);
+SYNTAX(6, "1 2", Invalid);
+SYNTAX(7, "x+", Invalid);
+SYNTAX(8, "*x", Invalid);
+SYNTAX(9, "sqrt*4", Invalid);
+SYNTAX(10, "sqrt", Invalid);
+SYNTAX(11, "()", Invalid);
+SYNTAX(12, "(x)(y)", Invalid);
+SYNTAX(13, "", Invalid);
+SYNTAX(14, "x 1.2.3", Invalid);
+SYNTAX(15, ".", BadNumber);
+SYNTAX(16, "12345678901234567891", InexactNumber);
+SYNTAX(17, "1e3", Invalid);
+SYNTAX(18, "2^^3", Invalid);
+SYNTAX(19, "x+1", Ok);
+SYNTAX(20, "-(-(-x))", Ok);
+
+#ifdef EDACAL_CT_BAD
+EDACAL_FORMULA(Broken, "(x+1))*2");   // tiene que fallar: "EdaCal: Parentesis desbalanceados"
+#endif
+
+static_assert(F01::variables==2 && F13::variables==3 && F16::variables==0 && F24::variables==3, "variables");
+
+int main(){
+    Tokenizer tk; ShuntingYard sy;
+    VarEnv env;
+    Evaluator ev(&env);
+    mt19937 rng(99);
+    const double special[]={0, 1, -1, 2, 0.5, -0.5, 3};
+    size_t rows=0, errors=0;
+    for(const Case* c: kCases){
+        ExprTree tree;
+        auto inf=tk.tokenize(c->text); auto post=sy.toPostfix(inf); tree.buildFromPostfix(post);
+        vector<uint32_t> slots;
+        for(unsigned i=0;i<c->variables;++i) slots.push_back(Symbols::intern(c->variable(i)));
+        vector<double> vals(c->variables+1);
+        for(int r=0;r<2000;++r){
+            for(unsigned i=0;i<c->variables;++i){
+                vals[i] = r%4==0 ? special[rng()%7] : (double)(int)(rng()%4001)/100.0-20.0;
+                env.set(slots[i], vals[i]);
+            }
+            string refErr, gotErr; double ref=0, got=0;
+            try{ ref=ev.eval(tree); } catch(const exception& ex){ refErr=ex.what(); }
+            try{ got=c->eval(vals.data()); } catch(const exception& ex){ gotErr=ex.what(); }
+            ++rows; if(!refErr.empty()) ++errors;
+            expect(refErr==gotErr && (!refErr.empty() || memcmp(&ref, &got, sizeof ref)==0),
+                   string(c->text)+": arbol="+(refErr.empty() ? to_string(ref) : refErr)+" ct="+(gotErr.empty() ? to_string(got) : gotErr));
+        }
+    }
+    expect(F01::call(3, 4)==5.0 && F03::call()==512.0 && F04::call()==16.25, "call");
+    expect(F20::variable(0)=="velocidad" && F20::variable(1)=="tiempo" && F20::variable(2)=="g", "nombres de variables");
+    cout << "ct_expr_test: " << sizeof(kCases)/sizeof(kCases[0]) << " formulas, " << rows << " filas (" << errors << " con error), " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
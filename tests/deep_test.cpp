@@ -0,0 +1,116 @@
+// Expresiones con anidamiento de 10^6 niveles: tokenizar, posfija, arbol, evaluador, VM,
+// optimizador, JIT, lotes y prefix tienen que terminar sin desbordar la pila nativa.
+// tree / tree opt se comparan contra un recorrido recursivo de referencia a menor profundidad.
+// g++ -std=c++11 -O2 -Iinclude -o deep_test tests/deep_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/batch.cpp
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "optimizer.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "batch.hpp"
+#include "check.hpp"
+#include <chrono>
+using namespace std;
+
+static string repeat(const string& s, size_t n){ string o; o.reserve(s.size()*n); for(size_t i=0;i<n;++i) o+=s; return o; }
+
+struct Shape { const char* name; string expr; double value; };
+
+// n niveles de cada forma; x vale 1
+static vector<Shape> shapes(size_t n){
+    return {
+        {"parentesis", repeat("(", n)+"x"+repeat(")", n), 1.0},
+        {"suma_derecha", repeat("1+(", n)+"x"+repeat(")", n), (double)n+1},
+        {"suma_izquierda", "x"+repeat("+1", n), (double)n+1},
+        {"potencia", repeat("x^", n)+"2", 1.0},
+        {"negacion", repeat("-(", n)+"x"+repeat(")", n), n%2 ? -1.0 : 1.0},
+        {"sqrt", repeat("sqrt(", n)+"x"+repeat(")", n), 1.0},
+    };
+}
+
+// referencias recursivas: solo para profundidades chicas
+static void refTree(ostream& os, const ExprTree& t, uint32_t n, int depth){
+    if(n==ExprTree::kNone) return;
+    const ExprNode& x=t.nodes[n];
+    refTree(os, t, x.right, depth+1); os << string(2*depth, ' ') << t.nodeToStr(x) << "\n"; refTree(os, t, x.left, depth+1);
+}
+static void refPrefix(ostream& os, const ExprTree& t, uint32_t n){
+    if(n==ExprTree::kNone) return;
+    const ExprNode& x=t.nodes[n];
+    os << t.nodeToStr(x) << ' '; refPrefix(os, t, x.left); refPrefix(os, t, x.right);
+}
+
+int main(){
+    typedef chrono::steady_clock Clock;
+    Tokenizer tk; ShuntingYard sy; Compiler comp; Optimizer opt;
+    VarEnv env; env.set("x", 1.0);
+    Evaluator ev(&env); VM vm(&env);
+    const size_t N=1000000;
+    size_t tokens=0; double secs=0;
+
+    for(const Shape& s: shapes(N)){
+        string name=s.name;
+        Clock::time_point t0=Clock::now();
+        vector<Token> inf, post;
+        ExprTree tree, dag;
+        tk.tokenize(s.expr, inf); sy.toPostfix(inf, post);
+        tree.buildFromPostfix(post);
+        double got=ev.eval(tree);
+        Program prog=comp.compile(tree);
+        double gotVm=vm.run(prog);
+        opt.run(tree, dag);
+        double gotDag=vm.run(comp.compile(dag));
+        secs+=chrono::duration<double>(Clock::now()-t0).count(); tokens+=inf.size();
+
+        expect(got==s.value, name+": evaluador");
+        expect(gotVm==s.value, name+": VM");
+        expect(gotDag==s.value, name+": optimizado");
+
+        // programas muy profundos no entran al frame nativo: compile() los rechaza y queda la VM
+        JitFunction fn;
+        bool deep=prog.maxStack>1000;
+        expect(fn.compile(prog)!=deep, name+": JIT");
+        if(!deep){ double x=1.0; int err=0; expect(fn.call(&x, &err)==s.value && !err, name+": JIT valor"); }
+
+        // la pila de bloques se achica en vez de pedir maxStack*256 filas
+        Table t; t.names={"x"}; t.cols.assign(1, vector<double>(64, 1.0)); t.rows=64;
+        BatchEvaluator be(&env); vector<double> out; vector<unsigned char> err;
+        be.run(prog, t, out, err);
+        expect(out[0]==s.value && out[63]==s.value && !err[0], name+": lotes");
+
+        // prefix: un nodo por token de la posfija, en preorden
+        ostringstream pre; tree.printPrefix(pre, tree.root);
+        size_t words=0; for(char c: pre.str()) words += c==' ';
+        expect(words==tree.nodes.size(), name+": prefix");
+    }
+
+    // tree, tree opt y prefix contra la referencia recursiva
+    for(const Shape& s: shapes(2000)){
+        ExprTree tree, dag;
+        tree.buildFromPostfix(sy.toPostfix(tk.tokenize(s.expr)));
+        ostringstream a, b, c, d;
+        tree.printTree(a, tree.root); refTree(b, tree, tree.root, 0);
+        tree.printPrefix(c, tree.root); refPrefix(d, tree, tree.root);
+        expect(a.str()==b.str(), string(s.name)+": tree");
+        expect(c.str()==d.str(), string(s.name)+": prefix chico");
+    }
+    const char* shared[] = { "(x+1)*(x+1)+(x+1)", "sin(x*2)^2+cos(x*2)^2+sin(x*2)", "((x+1)*(x+1))/((x+1)*(x+1))" };
+    const char* expected[] = {
+        "    1\n  + [#1]\n    x\n+\n    [#1]\n  *\n    [#1]\n",
+        "      2\n    * [#2]\n      x\n  sin [#1]\n+\n      2\n    ^\n        [#2]\n      cos\n  +\n      2\n    ^\n      [#1]\n",
+        "      1\n    + [#2]\n      x\n  * [#1]\n    [#2]\n/\n  [#1]\n",
+    };
+    for(int i=0;i<3;++i){
+        ExprTree tree, dag;
+        tree.buildFromPostfix(sy.toPostfix(tk.tokenize(shared[i])));
+        opt.run(tree, dag);
+        ostringstream os; Optimizer::printDag(os, dag);
+        expect(os.str()==expected[i], string("tree opt: ")+shared[i]+"\n"+os.str());
+    }
+
+    cout << "deep_test: profundidad " << N << ", " << tokens << " tokens en " << secs << " s ("
+         << (size_t)((double)tokens/secs/1e6) << " M tokens/s), " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+// formatFixed10 contra snprintf("%.10f") (lo mismo que usa std::fixed << setprecision(10)):
+// casos borde y millones de doubles aleatorios, byte a byte.
+// g++ -std=c++11 -O2 -Iinclude -o format_test tests/format_test.cpp src/fast_io.cpp
+#include "fast_io.hpp"
+#include <cfloat>
+#include <cstring>
+#include <random>
+using namespace std;
+
+int main(){
+    mt19937_64 rng(2024);
+    long checked=0; int fails=0;
+    auto check=[&](double v){
+        char got[kFixed10Max+1], ref[kFixed10Max+1];
+        got[formatFixed10(v, got)]=0;
+        snprintf(ref, sizeof ref, "%.10f", v);
+        ++checked;
+        if(strcmp(got, ref)!=0 && fails++<10) printf("FAIL %.17g: %s vs %s\n", v, got, ref);
+    };
+    const double special[]={0.0, -0.0, 1, -1, 0.5, 1e-11, 5e-11, -5e-11, 1.5e-10, 2.5e-10,
+        0.00048828125, DBL_MIN, -DBL_MIN, 4.9e-324, DBL_MAX, -DBL_MAX, 1e21, 1e30,
+        9007199254740993.0, 0.05, 0.15, 1e300, HUGE_VAL, -HUGE_VAL, NAN, -NAN};
+    for(double v: special) check(v);
+    for(int i=0;i<1000000;++i){
+        uint64_t r=rng(); double v; memcpy(&v, &r, 8); check(v);                    // cualquier patron de bits
+        check(ldexp((double)(int64_t)(rng()%2000001)-1000000, (int)(rng()%60)-30));   // empates binarios
+        check((double)(int64_t)(rng()%100000000000LL)/1e10);                          // 10 decimales "redondos"
+        check(ldexp((double)(rng()%(1ULL<<53)), -(int)(rng()%80)));
+    }
+    printf("format_test: %ld valores, %d fallas\n", checked, fails);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+// Compara bit a bit el JIT contra el evaluador de arbol sobre expresiones aleatorias.
+// g++ -std=c++11 -O2 -Iinclude -o jit_test tests/jit_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/bytecode.cpp src/jit.cpp
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include <cstring>
+#include <random>
+using namespace std;
+
+static mt19937 rng(12345);
+static int pick(int n){ return (int)(rng()%(unsigned)n); }
+
+static string gen(int d){
+    static const char* nums[]={"0","1","2","3","0.5","10","2.25",".75","0.1"};
+    static const char* vars[]={"x","y","pi","e"};
+    static const char* fns[]={"sqrt","sin","cos","tan","log","ln"};
+    static const char* ops[]={"+","-","*","/","^"};
+    int r=pick(10);
+    if(d<=0 || r<3) return pick(2) ? nums[pick(9)] : vars[pick(4)];
+    if(r<5) return string(fns[pick(6)])+"("+gen(d-1)+")";
+    if(r<6) return string(pick(2)?"-":"+")+gen(d-1);
+    if(r<7) return "("+gen(d-1)+")";
+    return gen(d-1)+ops[pick(5)]+gen(d-1);
+}
+
+int main(){
+    if(!JitFunction::supported()){ cout << "JIT no soportado en este host: omitido\n"; return 0; }
+    Tokenizer tk; ShuntingYard sy; Compiler comp;
+    VarEnv env; env.set("pi", 3.14159265358979323846); env.set("e", 2.71828182845904523536);
+    Evaluator ev(&env);
+    int checked=0, errors=0, fails=0;
+    for(int i=0;i<20000;++i){
+        string expr=gen(1+pick(6));
+        env.set("x", (double)pick(2000)/100.0-10.0); env.set("y", (double)pick(7)-3.0);
+        ExprTree tree;
+        try{ auto inf=tk.tokenize(expr); auto post=sy.toPostfix(inf); tree.buildFromPostfix(post); }
+        catch(const exception&){ continue; }
+        Program prog=comp.compile(tree);
+        JitFunction fn;
+        if(!fn.compile(prog)){ cout << "FAIL compile: " << expr << "\n"; ++fails; continue; }
+        vector<double> vars; for(uint32_t n: prog.slots) vars.push_back(env.get(n));
+
+        string refErr; double ref=0;
+        try{ ref=ev.eval(tree); } catch(const exception& ex){ refErr=ex.what(); }
+        int err=0; double got=fn.call(vars.data(), &err);
+        string gotErr = err ? JitFunction::errorMessage(err) : "";
+        ++checked; if(!refErr.empty()) ++errors;
+        if(refErr!=gotErr || (refErr.empty() && memcmp(&ref, &got, sizeof ref)!=0)){
+            ++fails;
+            cout << "FAIL " << expr << ": arbol=" << (refErr.empty()?to_string(ref):refErr)
+                 << " jit=" << (gotErr.empty()?to_string(got):gotErr) << "\n";
+        }
+    }
+    cout << "jit_test: " << checked << " expresiones (" << errors << " con error), " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
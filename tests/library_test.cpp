@@ -0,0 +1,131 @@
+// libedacal: el mismo handle compilado se evalua desde muchos hilos a la vez, cada uno con
+// sus Bindings; los resultados (y los Status) tienen que ser bit a bit los de un solo hilo.
+// Tambien compila en paralelo y compara la posfija/prefija de cada handle. Muestra
+// evaluaciones/s y aceleracion para 1..N hilos (N = nucleos, minimo 4); con 2 y 4 hilos,
+// si hay al menos esos nucleos, la escala tiene que ser casi lineal (>= 0.6 por hilo).
+// g++ -std=c++11 -O2 -pthread -Iinclude -o library_test tests/library_test.cpp src/libedacal.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/expr_cache.cpp src/session.cpp src/thread_pool.cpp src/sweep.cpp src/snapshot.cpp src/formulas.cpp src/fast_io.cpp src/stats.cpp
+#include "libedacal.hpp"
+#include "check.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+using namespace std;
+
+static vector<string> corpus(){
+    vector<string> v={
+        "sqrt(x^2+y^2)", "-x^2", "2^3^2", "(x+1)*(x+1)-y/3", "log(x)+ln(y)", "x/(y-y)",
+        "sqrt(-x)", "log(0)", "z+1", "(x+", "1 2", "x $ y", "+-x", "pi*x^2", "e^y",
+        "sin(x)*cos(y)+tan(x/7)", "-(-y)+x", "x*1+0*y", "((((x))))", ")",
+    };
+    mt19937 rng(7);
+    const char* ops="+-*/^";
+    for(int i=0;i<200;++i){
+        string s="x";
+        int n=1+(int)(rng()%12);
+        for(int k=0;k<n;++k){
+            s+=ops[rng()%5];
+            switch(rng()%4){
+                case 0: s+="y"; break;
+                case 1: s+=to_string(rng()%9+1); break;
+                case 2: s+="sqrt(x+"+to_string(rng()%5)+")"; break;
+                default: s+="(y-"+to_string(rng()%3)+")"; break;
+            }
+        }
+        v.push_back(s);
+    }
+    return v;
+}
+
+struct Result { edacal::Status st; uint64_t bits; };
+
+// una pasada sobre todas las expresiones con x = i, y = i/3 para i en [0, rows)
+static uint64_t sweep(const vector<edacal::Expression>& ex, edacal::Bindings& b, size_t rows, vector<Result>* out){
+    uint32_t sx=edacal::symbol("x"), sy=edacal::symbol("y");
+    uint64_t h=1469598103934665603ull;
+    for(size_t i=0;i<rows;++i){
+        b.set(sx, (double)i); b.set(sy, (double)i/3);
+        for(const edacal::Expression& e: ex){
+            double r=0; edacal::Status st=e.eval(b, r);
+            uint64_t u=0; if(st==edacal::Ok) memcpy(&u, &r, sizeof u);
+            if(out) out->push_back(Result{st, u});
+            h=(h^u^(uint64_t)st)*1099511628211ull;
+        }
+    }
+    return h;
+}
+
+// Status de compilar y evaluar con x = 2, y = 0
+static edacal::Status statusOf(const string& s){
+    edacal::Expression e;
+    edacal::Status st=edacal::Expression::compile(s, e);
+    if(st!=edacal::Ok) return st;
+    edacal::Bindings b; b.set("x", 2); b.set("y", 0);
+    double r; return e.eval(b, r);
+}
+
+static string printed(const edacal::Expression& e){ ostringstream os; e.printPostfix(os); e.printPrefix(os); e.printTree(os); return os.str(); }
+
+int main(){
+    vector<string> src=corpus();
+    vector<edacal::Expression> ex;
+    vector<string> ref;
+    for(const string& s: src){
+        edacal::Expression e; string msg;
+        edacal::Status st=edacal::Expression::compile(s, e, &msg);
+        if(st==edacal::Ok) ex.push_back(e), ref.push_back(printed(e));
+        else expect(!e.valid() && !msg.empty(), "compile sin mensaje: "+s);
+    }
+    // Status por clase de error
+    expect(statusOf("(x+")==edacal::SyntaxError, "(x+");
+    expect(statusOf("x $ y")==edacal::SyntaxError, "x $ y");
+    expect(statusOf("z+1")==edacal::UndefinedVariable, "z+1");
+    expect(statusOf("x/y")==edacal::DivisionByZero, "x/y");
+    expect(statusOf("sqrt(-x)")==edacal::DomainError, "sqrt(-x)");
+    expect(statusOf("sqrt(x^2+y^2)")==edacal::Ok, "sqrt(x^2+y^2)");
+    { uint32_t none=0; Symbols::setQuota(&none, nullptr);          // como una tabla llena
+      edacal::Expression e; string msg;
+      expect(edacal::Expression::compile("nombre_nunca_visto + 1", e, &msg)==edacal::TooManyNames && msg=="Demasiados identificadores nuevos", "tabla llena: "+msg);
+      Symbols::setQuota(nullptr, nullptr); }
+    { edacal::Expression e; double r=0; edacal::Bindings b; b.set("x", 3); b.set("y", 4);
+      edacal::Expression::compile("sqrt(x^2+y^2)", e); expect(e.eval(b, r)==edacal::Ok && r==5, "sqrt(3^2+4^2)");
+      expect(e.variableCount()==2 && e.variable(0)=="x" && e.variable(1)=="y", "variables");
+      edacal::Bindings c=b; c.set("x", 0); expect(e.eval(c, r)==edacal::Ok && r==4 && e.eval(b, r)==edacal::Ok && r==5, "copia de Bindings");
+      b.set("pi", 3); edacal::Expression::compile("pi", e); expect(e.eval(b, r)==edacal::Ok && r==3, "pi reasignado"); }
+
+    const size_t rows=2000;
+    vector<Result> want;
+    { edacal::Bindings b; sweep(ex, b, rows, &want); }
+
+    unsigned cores=max(1u, thread::hardware_concurrency());
+    unsigned maxT=max(4u, cores);
+    double base=0;
+    for(unsigned t=1;t<=maxT;t*=2){
+        vector<vector<Result>> got(t);
+        vector<string> compiled(t);
+        chrono::steady_clock::time_point t0=chrono::steady_clock::now();
+        vector<thread> th;
+        for(unsigned k=0;k<t;++k) th.emplace_back([&, k]{
+            // cada hilo compila su propia copia de unas cuantas y comprueba que imprimen igual
+            for(size_t i=k;i<src.size();i+=t){ edacal::Expression e; if(edacal::Expression::compile(src[i], e)==edacal::Ok) compiled[k]+=printed(e); }
+            edacal::Bindings b; got[k].reserve(want.size()); sweep(ex, b, rows, &got[k]);
+        });
+        for(thread& x: th) x.join();
+        double secs=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        for(unsigned k=0;k<t;++k){
+            bool same=got[k].size()==want.size();
+            for(size_t i=0; same && i<want.size(); ++i) same=got[k][i].st==want[i].st && got[k][i].bits==want[i].bits;
+            expect(same, to_string(t)+" hilos: resultados distintos en el hilo "+to_string(k));
+        }
+        string all, wantAll;
+        for(unsigned k=0;k<t;++k) all+=compiled[k];
+        for(unsigned k=0;k<t;++k){ size_t j=0; for(size_t i=0;i<src.size();++i){ edacal::Expression e; if(edacal::Expression::compile(src[i], e)!=edacal::Ok) continue; if(i%t==k) wantAll+=ref[j]; ++j; } }
+        expect(all==wantAll, to_string(t)+" hilos: compilacion en paralelo distinta");
+        double evals=(double)want.size()*t/secs;
+        if(t==1) base=evals;
+        cout << "  " << t << " hilos: " << (size_t)evals << " eval/s, x" << evals/base << "\n";
+        if((t==2 || t==4) && t<=cores) expect(evals/base>=0.6*t, to_string(t)+" hilos: aceleracion x"+to_string(evals/base));
+    }
+    cout << "library_test: " << ex.size() << " expresiones, " << cores << " nucleos, " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Optimizer: el DAG optimizado (VM, evaluador de arbol y JIT) debe dar bit a bit el mismo
+// resultado, y el mismo primer error, que el arbol original en el evaluador.
+// g++ -std=c++11 -O2 -Iinclude -o optimizer_test tests/optimizer_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "evaluator.hpp"
+#include "optimizer.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include <cstring>
+#include <random>
+using namespace std;
+
+static mt19937 rng(777);
+static int pick(int n){ return (int)(rng()%(unsigned)n); }
+
+// subexpresiones ya generadas: se reusan para que haya algo que compartir
+static vector<string> seen;
+
+static string gen(int d){
+    static const char* nums[]={"0","1","2","3","0.5","10","-0","1e0",".75"};
+    static const char* vars[]={"x","y","pi","e","zz"};
+    static const char* fns[]={"sqrt","sin","cos","tan","log","ln"};
+    static const char* ops[]={"+","-","*","/","^"};
+    int r=pick(12);
+    string s;
+    if(!seen.empty() && r<2) return seen[pick((int)seen.size())];
+    if(d<=0 || r<4) s = pick(2) ? nums[pick(9)] : vars[pick(5)];
+    else if(r<6) s = string(fns[pick(6)])+"("+gen(d-1)+")";
+    else if(r<7) s = string(pick(2)?"-":"+")+gen(d-1);
+    else if(r<8) s = "("+gen(d-1)+")";
+    else s = "("+gen(d-1)+ops[pick(5)]+gen(d-1)+")";
+    if(seen.size()<64) seen.push_back(s); else seen[pick(64)]=s;
+    return s;
+}
+
+// NaN con NaN no se compara bit a bit: con dos operandos NaN el signo del resultado depende
+// del orden en que el compilador puso los operandos de a+b (pasa igual sin optimizar)
+static bool same(double a, double b){ return memcmp(&a, &b, sizeof a)==0 || (a!=a && b!=b); }
+
+int main(){
+    Tokenizer tk; ShuntingYard sy; Compiler comp; Optimizer opt;
+    unordered_map<string,double> constants{{"pi", 3.14159265358979323846}, {"e", 2.71828182845904523536}};
+    opt.constants=&constants;
+    VarEnv env; for(const auto& c: constants) env.set(c.first, c.second);
+    Evaluator ev(&env); VM vm(&env);
+    int checked=0, errors=0, fails=0; size_t before=0, after=0;
+    for(int i=0;i<20000;++i){
+        string expr=gen(1+pick(6));
+        env.set("x", (double)pick(2000)/100.0-10.0); env.set("y", (double)pick(7)-3.0);
+        ExprTree tree, dag;
+        try{ auto inf=tk.tokenize(expr); auto post=sy.toPostfix(inf); tree.buildFromPostfix(post); }
+        catch(const exception&){ continue; }
+        opt.run(tree, dag);
+        before+=tree.nodes.size(); after+=dag.nodes.size();
+        Program prog=comp.compile(dag);
+
+        string refErr, vmErr, dagErr; double ref=0, got=0, gotDag=0;
+        try{ ref=ev.eval(tree); } catch(const exception& ex){ refErr=ex.what(); }
+        try{ got=vm.run(prog); } catch(const exception& ex){ vmErr=ex.what(); }
+        try{ gotDag=ev.eval(dag); } catch(const exception& ex){ dagErr=ex.what(); }
+        bool ok = refErr==vmErr && refErr==dagErr && (!refErr.empty() || (same(ref, got) && same(ref, gotDag)));
+
+        // el JIT no ve variables indefinidas (Jit::eval las resuelve antes y si falta alguna usa la VM)
+        bool allDefined=true; for(uint32_t n: prog.slots) allDefined = allDefined && env.has(n);
+        JitFunction fn;
+        if(ok && allDefined && JitFunction::supported() && fn.compile(prog)){
+            vector<double> vars; for(uint32_t n: prog.slots) vars.push_back(env.get(n));
+            int err=0; double j=fn.call(vars.data(), &err);
+            string jitErr = err ? JitFunction::errorMessage(err) : "";
+            ok = jitErr==refErr && (!refErr.empty() || same(ref, j));
+        }
+        ++checked; if(!refErr.empty()) ++errors;
+        if(!ok){
+            ++fails;
+            cout << "FAIL " << expr << ": arbol=" << (refErr.empty()?to_string(ref):refErr)
+                 << " optimizado=" << (vmErr.empty()?to_string(got):vmErr) << "\n";
+        }
+    }
+    // con NaN el optimizado tiene que ser bit a bit el original (signo incluido): x^1 no se simplifica
+    for(double nan: {std::nan(""), -std::nan("")}){
+        env.set("x", nan);
+        for(const char* expr: {"x^1", "-(x ^ 1)", "x*1", "x/1", "-(-x)"}){
+            ExprTree tree, dag;
+            tree.buildFromPostfix(sy.toPostfix(tk.tokenize(expr)));
+            opt.run(tree, dag);
+            double ref=ev.eval(tree), got=vm.run(comp.compile(dag));
+            ++checked;
+            if(memcmp(&ref, &got, sizeof ref)!=0){ ++fails; cout << "FAIL " << expr << " con NaN: signo distinto\n"; }
+        }
+    }
+
+    cout << "optimizer_test: " << checked << " expresiones (" << errors << " con error), "
+         << before << " -> " << after << " nodos, " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
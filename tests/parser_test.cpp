@@ -0,0 +1,102 @@
+// ShuntingYard::parse (una pasada texto -> arbol) contra tokenize + toPostfix + buildFromPostfix:
+// mismo mensaje lanzado, mismo error de arbol y, si sale bien, mismos nodos, slots y raiz.
+// Con error de arbol los nodos tienen que ser la posfija (posfix se imprime de ahi).
+// Lineas al azar con todos los tokens de la gramatica y basura a proposito; al final,
+// la posicion que informa cada clase de error.
+// g++ -std=c++11 -O2 -Iinclude -o parser_test tests/parser_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp
+#include "tokenizer.hpp"
+#include "shunting_yard.hpp"
+#include "expr_tree.hpp"
+#include "check.hpp"
+#include <cstring>
+#include <random>
+#include <sstream>
+using namespace std;
+
+struct Result { string thrown, error, postfix; vector<ExprNode> nodes; vector<uint32_t> slots; uint32_t root{ExprTree::kNone}; };
+
+static bool sameNodes(const vector<ExprNode>& a, const vector<ExprNode>& b){
+    if(a.size()!=b.size()) return false;
+    for(size_t i=0;i<a.size();++i)
+        if(a[i].op!=b[i].op || a[i].left!=b[i].left || a[i].right!=b[i].right || a[i].name!=b[i].name
+           || memcmp(&a[i].num, &b[i].num, sizeof(double))!=0) return false;
+    return true;
+}
+
+// tres etapas, como antes: la posfija se guarda aunque el arbol falle
+static Result threeStages(Tokenizer& tk, ShuntingYard& sy, const string& s){
+    Result r; ExprTree t;
+    vector<Token> post;
+    try{ post=sy.toPostfix(tk.tokenize(s)); } catch(const exception& ex){ r.thrown=ex.what(); return r; }
+    ostringstream os; for(const Token& x: post) os << ExprTree::tokenToStr(x) << ' ';
+    r.postfix=os.str();
+    try{ t.buildFromPostfix(post); r.nodes=t.nodes; r.slots=t.slots; r.root=t.root; }
+    catch(const exception& ex){ r.error=ex.what(); }
+    return r;
+}
+
+// parse no lanza: lo que antes se lanzaba vuelve como error lexico, con el arbol vacio
+static Result fused(ShuntingYard& sy, const string& s){
+    Result r; Error e;
+    const ExprTree& t=sy.parse(s, e);
+    if(e.lexical()){ r.thrown=e.message(); expect(t.nodes.empty(), "arbol vacio con error lexico: "+s); return r; }
+    ostringstream os; t.printPostfix(os); r.postfix=os.str();
+    if(!e){ r.nodes=t.nodes; r.slots=t.slots; r.root=t.root; }
+    else { r.error=e.message(); expect(e.syntax() && t.root==ExprTree::kNone, "sin raiz con error: "+s); }
+    return r;
+}
+
+static void check(Tokenizer& tk, ShuntingYard& a, ShuntingYard& b, const string& s){
+    Result x=threeStages(tk, a, s), y=fused(b, s);
+    expect(x.thrown==y.thrown, "excepcion ["+s+"]: '"+x.thrown+"' vs '"+y.thrown+"'");
+    if(!x.thrown.empty()) return;
+    expect(x.error==y.error, "error del arbol ["+s+"]: '"+x.error+"' vs '"+y.error+"'");
+    expect(x.postfix==y.postfix, "posfija ["+s+"]: '"+x.postfix+"' vs '"+y.postfix+"'");
+    expect(sameNodes(x.nodes, y.nodes) && x.slots==y.slots && x.root==y.root, "arbol ["+s+"]");
+}
+
+int main(){
+    Tokenizer tk; ShuntingYard a, b;
+    const char* fixed[] = {
+        "", "   ", "1", "-1", "+-+1", "1 2", "1 + * 2", "1 +", "* 2", "()", "(1", "1)", ")(", ")$", "(1$",
+        "((1)", "(1))", "sqrt", "sqrt 4", "sqrt(-4)^2", "-2^2", "2^3^2", "2^-3", "a-b-c", "a/b*c", "x*(y+z)",
+        "sin cos x", "1..2", "1.2.3", "3 ) 4 @", "sqrt(1,2)", "12345678901234567890123", "0.000000001 * a_1",
+        "((((x))))", "- - - x", "2 ^ sqrt 16 - ln e", "(+)", "(-)", "1 (2)", "log 100 / x y",
+    };
+    for(const char* s: fixed) check(tk, a, b, s);
+
+    const char* atoms[] = { "1", "2.5", "0.125", "x", "y", "pi", "e", "var_1", "10", "3." };
+    const char* ops[] = { "+", "-", "*", "/", "^" };
+    const char* fns[] = { "sqrt", "sin", "cos", "tan", "log", "ln", "-", "+" };
+    const char* junk[] = { "$", "#", "1.2.3", ")", "(", "*", "" };
+    mt19937 rng(20);
+    for(int i=0;i<100000;++i){
+        string s; int parts=1+(int)(rng()%12), open=0;
+        bool bad = rng()%4==0;                     // una de cada cuatro lleva algo roto a proposito
+        for(int k=0;k<parts;++k){
+            if(rng()%4==0){ s+=fns[rng()%8]; s+=' '; }
+            if(rng()%5==0){ s+='('; ++open; }
+            s+=atoms[rng()%10];
+            if(open && rng()%3==0){ s+=')'; --open; }
+            if(bad && rng()%6==0) s+=junk[rng()%7];
+            if(k+1<parts) s+= rng()%8 ? ops[rng()%5] : " ";
+        }
+        while(open-- > 0) if(!bad || rng()%3) s+=')';
+        check(tk, a, b, s);
+    }
+
+    struct At { const char* text; ErrCode code; uint32_t pos; };
+    const At at[] = {
+        { "1 + $", ErrCode::BadChar, 4 }, { "(1 + 2", ErrCode::Unbalanced, 0 }, { "1) + (2", ErrCode::Unbalanced, 1 },
+        { "((1) + (2)", ErrCode::Unbalanced, 0 }, { "1 + (2 * (3)", ErrCode::Unbalanced, 4 }, { "  .", ErrCode::BadNumber, 2 },
+        { ") $", ErrCode::BadChar, 2 }, { "1 +", ErrCode::BinaryMissing, 2 }, { "  sqrt", ErrCode::UnaryMissing, 2 },
+        { "1 2", ErrCode::Invalid, 3 }, { "x + * y", ErrCode::BinaryMissing, 2 },   // posfija x y * +: falla el +
+    };
+    for(const At& a: at){
+        Error e; b.parse(a.text, e);
+        expect(e.code==a.code && e.pos==a.pos, string("posicion [")+a.text+"]: codigo "+to_string((int)e.code)+" en "+to_string(e.pos));
+    }
+
+    cout << "parser_test: " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+// --serve: 64 conexiones a la vez, cada una manda su script entero sin esperar respuestas
+// (pipelining) y su salida tiene que ser byte a byte la de una Session local con el mismo
+// script. Cada conexion usa los mismos nombres de variables con otros valores: si el
+// estado se mezclara entre conexiones, la salida cambiaria. Al final, los limites por
+// conexion: save/load apagados, lineas de mas de 1 MB, lectura con una linea a medias y el
+// worker ocupado, cupos de nombres nuevos (por conexion y comun) y sweep acotado.
+// g++ -std=c++11 -O2 -pthread -Iinclude -o server_test tests/server_test.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/batch.cpp src/fast_io.cpp src/expr_cache.cpp src/formulas.cpp src/session.cpp src/sweep.cpp src/snapshot.cpp src/stats.cpp src/thread_pool.cpp src/server.cpp
+#include "server.hpp"
+#include "session.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace std;
+
+static vector<string> script(unsigned seed){
+    mt19937 rng(seed);
+    auto pick=[&](int n){ return (int)(rng()%(unsigned)n); };
+    auto num=[&]{ return to_string(pick(50)); };
+    vector<string> s;
+    s.push_back("x = "+to_string(seed));
+    s.push_back("def y = x*2+1");
+    for(int i=0;i<600;++i){
+        switch(pick(14)){
+            case 0: s.push_back("x = x + "+num()); break;
+            case 1: s.push_back("tree x*y+"+num()); break;
+            case 2: s.push_back("prefix (x-"+num()+")/y"); break;
+            case 3: s.push_back("posfix"); break;
+            case 4: s.push_back(pick(2) ? "1/0" : "sqrt(-"+num()+")"); break;
+            case 5: s.push_back("z"+num()+" + 1"); break;
+            case 6: s.push_back("("+num()+" +"); break;
+            case 7: s.push_back(pick(2) ? "vars" : "defs"); break;
+            case 8: s.push_back("show y"); break;
+            case 9: s.push_back("w = ans * "+num()); break;
+            case 10: s.push_back(pick(2) ? "del w" : "tree opt (x+1)*(x+1)"); break;
+            default: s.push_back("x*"+num()+" + y/"+to_string(1+pick(9))+" - ans^0.5"); break;
+        }
+    }
+    if(seed%8==0) s.insert(s.begin()+300, "exit");   // lo que sigue no se evalua
+    return s;
+}
+
+static string expected(const vector<string>& lines){
+    ostringstream os;
+    Session s(os, os);
+    for(const string& l: lines) if(!s.handle(l)) break;
+    return os.str();
+}
+
+static int connectTo(const string& path){
+    int fd=socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un a; memset(&a, 0, sizeof a); a.sun_family=AF_UNIX;
+    memcpy(a.sun_path, path.c_str(), path.size()+1);
+    if(fd<0 || connect(fd, (sockaddr*)&a, sizeof a)!=0){ if(fd>=0) close(fd); return -1; }
+    return fd;
+}
+
+// manda todo (en otro hilo) y lee hasta que el servidor cierra
+static string roundTrip(const string& path, const string& input){
+    int fd=connectTo(path);
+    if(fd<0) return "no conecta";
+    thread writer([&]{
+        size_t off=0;
+        while(off<input.size()){
+            ssize_t k=send(fd, input.data()+off, min<size_t>(4096, input.size()-off), MSG_NOSIGNAL);
+            if(k<=0) break;
+            off+=(size_t)k;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+    string out; char buf[65536];
+    for(;;){ ssize_t k=recv(fd, buf, sizeof buf, 0); if(k<=0) break; out.append(buf, (size_t)k); }
+    writer.join();
+    close(fd);
+    return out;
+}
+
+int main(){
+    if(!Server::supported()){ cout << "server_test: sin soporte en este sistema\n"; return 0; }
+    string path="/tmp/edacal_server_test_"+to_string(getpid())+".sock";
+    Server server(4);
+    string error;
+    if(!server.listen(path, error)){ cout << "server_test: " << error << "\n"; return 1; }
+    thread loop([&]{ server.run(); });
+
+    const unsigned kConns=64;
+    vector<string> inputs(kConns), want(kConns), got(kConns);
+    size_t lines=0;
+    for(unsigned c=0;c<kConns;++c){
+        vector<string> s=script(c);
+        for(const string& l: s) inputs[c]+=l+"\n";
+        want[c]=expected(s);
+        lines+=s.size();
+    }
+    chrono::steady_clock::time_point t0=chrono::steady_clock::now();
+    vector<thread> clients;
+    for(unsigned c=0;c<kConns;++c) clients.emplace_back([&, c]{ got[c]=roundTrip(path, inputs[c]); });
+    for(thread& t: clients) t.join();
+    double secs=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+
+    int fails=0;
+    for(unsigned c=0;c<kConns;++c) if(got[c]!=want[c]){
+        if(++fails<=3) cout << "conexion " << c << ": " << got[c].size() << " bytes, se esperaban " << want[c].size() << "\n";
+    }
+    // una linea sin '\n' al cerrar tambien se evalua, como con getline
+    if(roundTrip(path, "a = 2\na*21")!="a -> 2.0000000000\nans -> 42.0000000000\n"){ ++fails; cout << "ultima linea sin salto\n"; }
+
+    // save/load no tocan el disco del servidor
+    if(roundTrip(path, "save /tmp/x.snap\nload /tmp/x.snap\n1+1\n")!=
+       "Error: save/load no disponible en este modo\nError: save/load no disponible en este modo\nans -> 2.0000000000\n"){ ++fails; cout << "save/load\n"; }
+    // una linea sin '\n' de mas de 1 MB: responde lo anterior, el error y cierra
+    if(roundTrip(path, "7\n"+string(3<<20, '1'))!="ans -> 7.0000000000\nError: linea demasiado larga\n"){ ++fails; cout << "linea larga\n"; }
+    // cupo de nombres nuevos: se agota en una conexion y las demas siguen igual
+    {
+        string in; unsigned seed=getpid();
+        for(int i=0;i<5000;++i) in+="n"+to_string(seed)+"_"+to_string(i)+" = 1\n";
+        string out=roundTrip(path, in);
+        size_t errs=0; for(size_t p=0; (p=out.find("Error: Demasiados identificadores nuevos\n", p))!=string::npos; ++p) ++errs;
+        if(errs!=5000-4096){ ++fails; cout << "cupo de nombres: " << errs << " errores\n"; }
+        if(roundTrip(path, "otro"+to_string(seed)+" = 3\n")!="otro"+to_string(seed)+" -> 3.0000000000\n"){ ++fails; cout << "cupo por conexion\n"; }
+    }
+    // worker ocupado, pending a medio llenar y una linea a medias que completa el tope: el hilo
+    // de epoll no tiene que quedar girando sobre un fd listo que read() no lee
+    {
+        clockid_t cid; timespec t0, t1;
+        pthread_getcpuclockid(loop.native_handle(), &cid);
+        int fd=connectTo(path);
+        string busy; for(int i=0;i<5;++i) busy+="sweep sum x for x=1:10^7\n";
+        string ones; for(int i=0;i<300000;++i) ones+="1\n";
+        string half(500000, ' ');
+        thread writer([&]{
+            for(const string* s: {&busy, &ones, &half}){
+                for(size_t off=0; off<s->size();){ ssize_t k=send(fd, s->data()+off, s->size()-off, MSG_NOSIGNAL); if(k<=0) return; off+=(size_t)k; }
+                if(s==&busy) this_thread::sleep_for(chrono::milliseconds(50));   // el worker ya tomo los sweeps
+            }
+        });
+        this_thread::sleep_for(chrono::milliseconds(150));
+        clock_gettime(cid, &t0);
+        this_thread::sleep_for(chrono::milliseconds(300));
+        clock_gettime(cid, &t1);
+        writer.join();
+        send(fd, "2\n", 2, MSG_NOSIGNAL); shutdown(fd, SHUT_WR);
+        string out; char buf[65536];
+        for(;;){ ssize_t k=recv(fd, buf, sizeof buf, 0); if(k<=0) break; out.append(buf, (size_t)k); }
+        close(fd);
+        double spent=(double)(t1.tv_sec-t0.tv_sec)+(double)(t1.tv_nsec-t0.tv_nsec)*1e-9;
+        string want; for(int i=0;i<5;++i) want+="sum -> 50000005000000.0000000000\n";
+        for(int i=0;i<300000;++i) want+="ans -> 1.0000000000\n";
+        want+="ans -> 2.0000000000\n";
+        if(spent>0.05 || out!=want){ ++fails; cout << "linea a medias con el worker ocupado: " << spent << " s de CPU en epoll, " << out.size() << " bytes\n"; }
+    }
+    // cupo comun: 70 conexiones de 4000 nombres nuevos no pasan de 2^18 entre todas; agotado,
+    // un nombre nuevo falla en cualquier conexion y los que ya existen siguen andando
+    {
+        unsigned seed=getpid(); size_t ok=0; string last;
+        for(int k=0;k<70;++k){
+            string in; for(int i=0;i<4000;++i) in+="m"+to_string(seed)+"_"+to_string(k)+"_"+to_string(i)+" = 1\n";
+            string out=roundTrip(path, in);
+            for(size_t p=0; (p=out.find(" -> ", p))!=string::npos; ++p) ++ok;
+            last=out;
+        }
+        if(ok>(1u<<18) || last.find(" -> ")!=string::npos
+           || roundTrip(path, "otra"+to_string(seed)+" = 1\nm"+to_string(seed)+"_0_0 = 2\n")!="Error: Demasiados identificadores nuevos\nm"+to_string(seed)+"_0_0 -> 2.0000000000\n"){
+            ++fails; cout << "cupo comun: " << ok << " nombres\n";
+        }
+    }
+    if(roundTrip(path, "sweep sum x for x=1:10000\n")!="sum -> 50005000.0000000000\n"){ ++fails; cout << "sweep\n"; }
+    // sweep acotado: puntos por comando y salida juntada por la conexion
+    if(roundTrip(path, "sweep x for x=0:20000000:1\n")!="Error: demasiados puntos (maximo 10000000)\n"){ ++fails; cout << "sweep sin tope\n"; }
+    {
+        string out=roundTrip(path, "sweep x for x=1:10^6\n1\n");
+        string tail="Error: barrido cortado: mas de 4 MB de salida sin mandar\nans -> 1.0000000000\n";
+        if(out.size()>(5u<<20) || out.compare(0, 5, "x\tx\n1")!=0 || out.size()<tail.size() || out.compare(out.size()-tail.size(), tail.size(), tail)!=0){
+            ++fails; cout << "tabla de sweep: " << out.size() << " bytes\n";
+        }
+    }
+
+    server.stop(); loop.join();
+
+    // --restore: cada conexion copia la sesion cargada al arrancar; lo que cambia una no lo ven las otras
+    {
+        ostringstream sink; Session initial(sink, sink);
+        initial.handle("r0 = 4"); initial.handle("def r1 = r0 * 2");
+        Server second(2); second.initial=&initial;
+        if(!second.listen(path, error)){ cout << "server_test: " << error << "\n"; return 1; }
+        thread loop2([&]{ second.run(); });
+        string a=roundTrip(path, "r0 = 5\nr1\n"), b=roundTrip(path, "r1\n");
+        second.stop(); loop2.join();
+        if(a!="r0 -> 5.0000000000\nans -> 10.0000000000\n" || b!="ans -> 8.0000000000\n" || initial.env.get("r1")!=8.0){ ++fails; cout << "sesion inicial:\n" << a << b; }
+    }
+    cout << "server_test: " << kConns << " conexiones, " << lines << " lineas en " << secs << " s ("
+         << (size_t)((double)lines/secs) << " lineas/s), " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
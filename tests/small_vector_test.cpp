@@ -0,0 +1,109 @@
+// SmallVector: copias, movimientos y destrucciones con un tipo que cuenta instancias vivas
+// (cada construida se destruye una vez), push_back y append de elementos del propio vector
+// al crecer, paso del buffer interno al heap y vuelta, y un vector movido queda vacio y
+// usable. Un tipo que lanza al copiar no deja un vector a medio mover.
+// g++ -std=c++11 -O2 -Iinclude -o small_vector_test tests/small_vector_test.cpp
+#include "small_vector.hpp"
+#include "check.hpp"
+#include <memory>
+#include <random>
+using namespace std;
+
+static int alive=0, copies=0;
+struct Counted {
+    string s;                                  // con string: un movimiento mal hecho se nota
+    explicit Counted(int v):s("valor numero "+to_string(v)){ ++alive; }
+    Counted(const Counted& o):s(o.s){ ++alive; ++copies; }
+    Counted(Counted&& o) noexcept :s(std::move(o.s)){ ++alive; }
+    Counted& operator=(const Counted& o){ s=o.s; ++copies; return *this; }
+    Counted& operator=(Counted&& o){ s=std::move(o.s); return *this; }
+    ~Counted(){ --alive; }
+};
+
+// copiar o mover lanza cuando budget llega a 0 (negativo: nunca). Sin noexcept: el vector
+// tiene que copiar al crecer para poder volver atras
+static int budget=-1;
+struct Fragile {
+    int v;
+    explicit Fragile(int v):v(v){}
+    Fragile(const Fragile& o):v(o.v){ spend(); }
+    Fragile(Fragile&& o):v(o.v){ spend(); }
+    static void spend(){ if(budget==0) throw runtime_error("sin permiso"); if(budget>0) --budget; }
+};
+
+template<size_t N> static bool same(const SmallVector<Counted, N>& v, const vector<string>& ref){
+    if(v.size()!=ref.size()) return false;
+    for(size_t i=0;i<ref.size();++i) if(v[i].s!=ref[i]) return false;
+    return true;
+}
+
+int main(){
+    mt19937 rng(3);
+    for(int round=0; round<200; ++round){
+        {
+            SmallVector<Counted, 4> v; vector<string> ref;
+            int n=(int)(rng()%40);
+            for(int i=0;i<n;++i){
+                switch(rng()%5){
+                    case 0: v.emplace_back(i); ref.push_back(Counted(i).s); break;
+                    case 1: { Counted c(i); v.push_back(c); ref.push_back(c.s); break; }
+                    case 2: if(!v.empty()){ v.push_back(v[rng()%v.size()]); ref.push_back(v.back().s); } break;  // alias
+                    case 3: if(v.size()<16){ v.append(v.begin(), v.end()); vector<string> r=ref; ref.insert(ref.end(), r.begin(), r.end()); } break;  // alias
+                    default: if(!v.empty()){ v.pop_back(); ref.pop_back(); } break;
+                }
+            }
+            expect(same(v, ref), "contenido tras push/pop");
+            expect(v.isInline()==(v.capacity()==4), "buffer interno");
+
+            SmallVector<Counted, 4> c(v);
+            expect(same(c, ref) && same(v, ref), "copia");
+            int before=copies;
+            SmallVector<Counted, 4> m(std::move(c));
+            expect(same(m, ref) && c.empty(), "movimiento");
+            expect(!m.isInline() ? copies==before : true, "mover desde el heap no copia");
+            c.emplace_back(7); c.emplace_back(8);
+            expect(c.size()==2 && c[1].s=="valor numero 8", "movido queda usable");
+
+            SmallVector<Counted, 4> a; a.emplace_back(1);
+            a=m; expect(same(a, ref), "asignacion por copia");
+            a=std::move(m); expect(same(a, ref) && m.empty(), "asignacion por movimiento");
+            a=a; expect(same(a, ref), "autoasignacion");
+            a.resize(a.size()+3, Counted(9)); a.resize(2 < a.size() ? 2 : a.size(), Counted(0));
+            expect(a.size()<=2, "resize");
+            a.clear(); expect(a.empty(), "clear");
+        }
+        expect(alive==0, "instancias vivas despues de destruir ("+to_string(alive)+")");
+    }
+
+    // una copia que lanza al crecer (emplace_back, append, reserve) deja todo como estaba
+    for(int way=0; way<3; ++way){
+        SmallVector<Fragile, 4> f;
+        for(int i=0;i<4;++i) f.emplace_back(i);
+        SmallVector<Fragile, 4> more; more.emplace_back(9);
+        budget=2;
+        bool threw=false;
+        try{
+            if(way==0) f.push_back(Fragile(9));
+            else if(way==1) f.append(more.begin(), more.end());
+            else f.reserve(16);
+        } catch(const runtime_error&){ threw=true; }
+        budget=-1;
+        bool intact=f.size()==4 && f.isInline();
+        for(int i=0;i<4 && intact;++i) intact=f[i].v==i;
+        expect(threw && intact, "excepcion al crecer ("+to_string(way)+")");
+        f.emplace_back(4); f.emplace_back(5);
+        expect(f.size()==6 && f[5].v==5 && f[0].v==0, "usable despues de la excepcion");
+    }
+
+    // como pila de indices: sin heap mientras entra en el buffer
+    SmallVector<uint32_t, 64> st;
+    for(uint32_t i=0;i<64;++i) st.push_back(i);
+    expect(st.isInline(), "64 enteros entran en el buffer");
+    st.push_back(64);
+    expect(!st.isInline() && st.size()==65 && st.back()==64 && st[0]==0, "crece al heap");
+    unique_ptr<SmallVector<uint32_t, 64>> moved(new SmallVector<uint32_t, 64>(std::move(st)));
+    expect(moved->size()==65 && st.empty() && st.isInline(), "mover roba el bloque");
+
+    cout << "small_vector_test: " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+// save/load: una sesion restaurada tiene que comportarse igual que la original. Se arma
+// una sesion con un script al azar (variables, formulas, pi reasignado, ultima expresion
+// con error de arbol), se guarda, se carga en otra y ambas corren la misma continuacion:
+// la salida tiene que ser identica byte a byte. Un archivo con un byte cambiado o cortado
+// se rechaza y deja la sesion como estaba; uno con el checksum recalculado pero maxStack o
+// temps falsos tambien, sin agregar sus nombres a la tabla global. Al final, 10^6 variables: tiempos de save/load.
+// g++ -std=c++11 -O2 -pthread -Iinclude -o snapshot_test tests/snapshot_test.cpp src/snapshot.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/expr_cache.cpp src/session.cpp src/thread_pool.cpp src/sweep.cpp src/formulas.cpp src/fast_io.cpp src/stats.cpp
+#include "session.hpp"
+#include "snapshot.hpp"
+#include "check.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <random>
+using namespace std;
+
+static vector<string> script(unsigned seed, size_t n){
+    mt19937 rng(seed);
+    auto pick=[&](int k){ return (int)(rng()%(unsigned)k); };
+    auto var=[&]{ return "v"+to_string(pick(40)); };
+    vector<string> s;
+    for(size_t i=0;i<n;++i){
+        switch(pick(12)){
+            case 0: s.push_back("def "+var()+" = "+var()+" + "+var()+"*2"); break;
+            case 1: s.push_back("del "+var()); break;
+            case 2: s.push_back("tree opt "+var()+"*pi + "+var()+"*pi"); break;
+            case 3: s.push_back(var()+" + 1 2"); break;           // posfija valida, arbol con error
+            case 4: s.push_back("sqrt("+var()+") / ("+var()+" - "+var()+")"); break;
+            case 5: s.push_back(pick(2) ? "posfix" : "prefix"); break;
+            case 6: s.push_back("tree"); break;
+            case 7: s.push_back(pick(2) ? "vars" : "defs"); break;
+            default: s.push_back(var()+" = "+var()+" * "+to_string(pick(9))+" + "+to_string(pick(100))); break;
+        }
+    }
+    return s;
+}
+
+static string run(Session& s, ostringstream& os, const vector<string>& lines){
+    os.str("");
+    for(const string& l: lines) s.handle(l);
+    return os.str();
+}
+
+static string readFile(const string& p){ ifstream in(p, ios::binary); return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>()); }
+static void writeFile(const string& p, const string& d){ ofstream out(p, ios::binary); out << d; }
+
+// los campos que se editan, en el mismo lugar que en src/snapshot.cpp
+struct Header {
+    char magic[8]; uint32_t version, layout; uint64_t size, checksum;
+    uint32_t names, texts, vars, exprs, formulas, last, flags, reserved;
+    uint64_t values, varNames, nameOffs, nameBytes, textOffs, textBytes, exprTable, formulaTable;
+};
+struct ExprRecord {
+    uint64_t offset; uint32_t treeNodes, optNodes, code, treeSlots, optSlots, progSlots, treeRoot, optRoot, error, errorPos;
+    int32_t maxStack, temps;
+};
+static void reseal(string& d){ uint64_t c=snapshotChecksum(d.data(), d.size()); memcpy(&d[offsetof(Header, checksum)], &c, sizeof c); }
+
+int main(){
+    string path="/tmp/edacal_snapshot_test_"+to_string(getpid())+".snap";
+
+    for(unsigned seed=1; seed<=30; ++seed){
+        ostringstream oa, ob;
+        Session a(oa, oa), b(ob, ob);
+        if(seed%3==0) a.handle("pi = 3");                        // pi deja de ser constante
+        run(a, oa, script(seed, 300));
+        a.handle("save "+path);
+        expect(oa.str().size()>=3 && oa.str().compare(oa.str().size()-3, 3, "ok\n")==0, "save semilla "+to_string(seed));
+        b.handle("x_previa = 1");                                  // load reemplaza lo que habia
+        b.handle("load "+path);
+        vector<string> more=script(seed+1000, 300);
+        more.insert(more.begin(), {"posfix", "tree", "tree opt", "vars", "defs", "show x_previa"});
+        expect(run(a, oa, more)==run(b, ob, more), "continuacion distinta, semilla "+to_string(seed));
+    }
+
+    // archivo danado: error y la sesion queda igual
+    {
+        ostringstream os; Session s(os, os);
+        s.handle("a = 2"); s.handle("def b = a*3"); s.handle("save "+path);
+        string good=readFile(path);
+        mt19937 rng(5);
+        for(int k=0;k<200;++k){
+            string bad=good;
+            if(k%4==0) bad.resize(rng()%good.size());
+            else bad[rng()%bad.size()]^=(char)(1+rng()%255);
+            writeFile(path, bad);
+            ostringstream ot; Session t(ot, ot);
+            t.handle("c = 1");
+            t.handle("load "+path);
+            expect(ot.str().find("Error: ")!=string::npos, "archivo danado aceptado ("+to_string(k)+")");
+            ot.str(""); t.handle("vars");
+            expect(ot.str()=="ans -> 1.0000000000\nc -> 1.0000000000\ne -> 2.7182818285\npi -> 3.1415926536\n", "load fallido cambio la sesion");
+        }
+    }
+
+    // checksum recalculado (cualquiera puede): maxStack o temps que no son los del programa se
+    // rechazan, y un archivo rechazado no deja sus nombres en la tabla global
+    {
+        ostringstream os; Session s(os, os);
+        s.handle("qa7 = 5"); s.handle("def qc7 = 2 * 3"); s.handle("save "+path);
+        string good=readFile(path);
+        size_t at=good.find("qa7");
+        Header h; memcpy(&h, good.data(), sizeof h);
+        expect(at!=string::npos && h.exprs>=1, "snapshot de prueba");
+        good[at+1]='b';                                            // qb7: un nombre que nadie vio
+        for(int k=0;k<3;++k){
+            string bad=good;
+            ExprRecord r; size_t ro=(size_t)h.exprTable;
+            memcpy(&r, &bad[ro], sizeof r);
+            if(k==0) r.maxStack=0x7FFFFFFF; else if(k==1) r.maxStack+=1; else r.temps+=1;
+            memcpy(&bad[ro], &r, sizeof r);
+            reseal(bad); writeFile(path, bad);
+            ostringstream ot; Session t(ot, ot);
+            t.handle("load "+path);
+            expect(ot.str()=="Error: Snapshot invalido: programa\n", "maxStack/temps falsos: "+ot.str());
+            expect(Symbols::find("qb7")==Symbols::kNone, "un snapshot rechazado interno sus nombres");
+        }
+        reseal(good); writeFile(path, good);
+        ostringstream ot; Session t(ot, ot);
+        t.handle("load "+path); t.handle("qb7 + qc7");
+        expect(ot.str()=="ok\nans -> 11.0000000000\n", "snapshot resellado: "+ot.str());
+    }
+
+    // 10^6 variables
+    const size_t kVars=1000000;
+    double saveSecs, loadSecs;
+    {
+        ostringstream os; Session s(os, os);
+        for(size_t i=0;i<kVars;++i) s.env.set("big"+to_string(i), (double)i+0.25);
+        chrono::steady_clock::time_point t0=chrono::steady_clock::now();
+        saveSnapshot(s, path);
+        saveSecs=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+    }
+    {
+        ostringstream os; Session s(os, os);
+        chrono::steady_clock::time_point t0=chrono::steady_clock::now();
+        loadSnapshot(s, path);
+        loadSecs=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        expect(s.env.size()==kVars+3, "cantidad de variables");
+        bool same=true;
+        for(size_t i=0;i<kVars && same;i+=997) same=s.env.get("big"+to_string(i))==(double)i+0.25;
+        expect(same, "valores de 10^6 variables");
+    }
+    std::remove(path.c_str());
+    cout << "snapshot_test: 10^6 variables, save " << saveSecs*1000 << " ms, load " << loadSecs*1000 << " ms, " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+// sweep: la tabla tiene que ser la de evaluar punto por punto con una VM, en orden, y las
+// reducciones tienen que dar lo mismo bit a bit con 1, 2, 3 o 7 hilos. La suma compensada
+// de 10^6 veces 0.1 tiene que quedar mas cerca de 10^5 que la suma comun; argmin con empates
+// se queda con el primer punto; los puntos con error se cuentan y no entran en la reduccion.
+// Al final, el comando del REPL de punta a punta.
+// g++ -std=c++11 -O2 -pthread -Iinclude -o sweep_test tests/sweep_test.cpp src/sweep.cpp src/thread_pool.cpp src/tokenizer.cpp src/symbols.cpp src/shunting_yard.cpp src/expr_tree.cpp src/evaluator.cpp src/optimizer.cpp src/bytecode.cpp src/jit.cpp src/expr_cache.cpp src/session.cpp src/snapshot.cpp src/formulas.cpp src/fast_io.cpp src/stats.cpp
+#include "sweep.hpp"
+#include "session.hpp"
+#include "check.hpp"
+#include <cstring>
+using namespace std;
+
+static Program compileText(const string& s){
+    ShuntingYard sy; Optimizer opt; Compiler comp; ExprTree t; Error e;
+    sy.parse(s.data(), s.size(), t, e);
+    if(e) e.raise();
+    ExprTree o; opt.run(t, o);
+    return comp.compile(o);
+}
+
+static SweepRange range(const string& name, double from, double step, uint64_t count){
+    SweepRange g; g.slot=Symbols::intern(name); g.from=from; g.step=step; g.count=count; return g;
+}
+
+static bool same(double a, double b){ return memcmp(&a, &b, sizeof a)==0; }
+
+// la misma tabla, armada con un solo VM recorriendo los puntos en orden
+static string sequential(const Program& p, VarEnv env, const vector<SweepRange>& rg){
+    VM vm(&env); string out; char buf[kFixed10Max];
+    uint64_t total=1; for(const SweepRange& g: rg) total*=g.count;
+    for(uint64_t i=0;i<total;++i){
+        for(size_t k=0;k<rg.size();++k){ double v=sweepValue(rg, i, k); env.set(rg[k].slot, v); out.append(buf, formatFixed10(v, buf)); out+='\t'; }
+        Error e; double v=vm.run(p, e);
+        if(e) out+="Error: "+e.message(); else out.append(buf, formatFixed10(v, buf));
+        out+='\n';
+    }
+    return out;
+}
+
+int main(){
+    VarEnv env; env.set("k", 3.0);
+    const char* exprs[] = { "sqrt(x) * k - y", "1 / (x - y)", "sin(x) + cos(y)^2", "ln(x*y) / q", "x" };
+    vector<SweepRange> rg = { range("x", -1.5, 0.25, 37), range("y", 2.0, -0.5, 301) };   // 11137 puntos: 3 bloques
+    for(const char* s: exprs){
+        Program p=compileText(s);
+        string want=sequential(p, env, rg);
+        for(unsigned th: {1u, 2u, 3u, 7u}){
+            ostringstream os;
+            SweepResult r=sweep(p, env, rg, Reduction::Table, th, &os);
+            expect(os.str()==want, string("tabla [")+s+"] con "+to_string(th)+" hilos");
+            expect(r.points==11137 && r.valid+r.errors==r.points, string("conteo [")+s+"]");
+        }
+        for(Reduction red: {Reduction::Sum, Reduction::Mean, Reduction::Min, Reduction::Max, Reduction::ArgMin}){
+            SweepResult one=sweep(p, env, rg, red, 1, nullptr);
+            for(unsigned th: {2u, 3u, 7u}){
+                SweepResult r=sweep(p, env, rg, red, th, nullptr);
+                expect(same(r.value, one.value) && r.at==one.at && r.errors==one.errors && r.firstAt==one.firstAt
+                       && r.first.code==one.first.code, string("reduccion [")+s+"] con "+to_string(th)+" hilos");
+            }
+        }
+    }
+
+    // 10^6 veces 0.1: la suma comun se aleja de 10^5, la compensada no
+    {
+        Program p=compileText("0.1");
+        vector<SweepRange> one = { range("i", 0, 1, 1000000) };
+        double naive=0; for(int i=0;i<1000000;++i) naive+=0.1;
+        for(unsigned th: {1u, 4u}){
+            SweepResult r=sweep(p, env, one, Reduction::Sum, th, nullptr);
+            expect(fabs(r.value-100000.0) < 1e-9 && fabs(r.value-100000.0) < fabs(naive-100000.0), "suma compensada: "+to_string(r.value));
+        }
+    }
+
+    // empates: x^2 - 1 en -1, 0, 1 -> max en el primero; errores fuera de la reduccion
+    {
+        vector<SweepRange> g = { range("x", -1, 1, 3) };
+        SweepResult r=sweep(compileText("x^2 - 1"), env, g, Reduction::ArgMax, 2, nullptr);
+        expect(r.at==0 && r.value==0.0, "argmax con empate");
+        r=sweep(compileText("1/x"), env, g, Reduction::Sum, 2, nullptr);
+        expect(r.errors==1 && r.firstAt==1 && r.first.code==ErrCode::DivZero && r.valid==2 && r.value==0.0, "error fuera de la suma");
+        r=sweep(compileText("sqrt(x)"), env, g, Reduction::Min, 2, nullptr);
+        expect(r.errors==1 && r.firstAt==0 && r.first.code==ErrCode::SqrtNeg && r.at==1, "min salta el error");
+        r=sweep(compileText("(x-1)^0.5"), env, g, Reduction::Max, 2, nullptr);
+        expect(r.found && r.errors==0 && r.at==2 && r.value==0.0, "max salta los nan");
+        r=sweep(compileText("(x-2)^0.5"), env, g, Reduction::ArgMin, 2, nullptr);
+        expect(!r.found && r.valid==3, "argmin sin puntos validos (todos nan)");
+        r=sweep(compileText("1/(x-x)"), env, g, Reduction::Min, 2, nullptr);
+        expect(!r.found && r.errors==3, "min sin puntos validos (todos con error)");
+    }
+
+    // el comando: la sesion no cambia y la salida es la esperada
+    {
+        ostringstream out, err;
+        Session s(out, err); s.sweepThreads=3;
+        s.handle("a = 2");
+        s.handle("sweep a*x for x=0:1:0.5");
+        s.handle("sweep sum x for x=1:100");
+        s.handle("sweep argmin (x-1)^2 + y for x=0:2:0.5, y=3:1:-1");
+        s.handle("sweep mean 1/x for x=-1:1");
+        s.handle("sweep argmax (x-2)^0.5 for x=0:1");
+        s.handle("sweep min sqrt(x) for x=-2:-1");
+        s.handle("sweep x for x=1:0");
+        s.handle("sweep x*pi for pi=1:2");
+        s.handle("x");
+        string want =
+            "a -> 2.0000000000\n"
+            "x\ta*x\n0.0000000000\t0.0000000000\n0.5000000000\t1.0000000000\n1.0000000000\t2.0000000000\n"
+            "sum -> 5050.0000000000\n"
+            "x -> 1.0000000000\ny -> 1.0000000000\nmin -> 1.0000000000\n"
+            "mean -> 0.0000000000\n";
+        string wantErr =
+            "Error: 1 de 3 puntos con error; el primero en x = 0.0000000000: division por cero\n"
+            "Error: ningun punto valido para argmax (2 puntos con nan o error)\n"
+            "Error: ningun punto valido para min (2 puntos con nan o error)\n"
+            "Error: 2 de 2 puntos con error; el primero en x = -2.0000000000: sqrt de negativo\n"
+            "Error: rango invalido: x=1:0\n"
+            "Error: variable protegida\n"
+            "Error: Variable no definida: x\n";
+        expect(out.str()==want, "salida del REPL:\n"+out.str());
+        expect(err.str()==wantErr, "errores del REPL:\n"+err.str());
+    }
+
+    cout << "sweep_test: " << fails << " fallas\n";
+    return fails ? 1 : 0;
+}
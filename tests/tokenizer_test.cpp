@@ -0,0 +1,69 @@
+// parseDecimal contra strtod (bit a bit, mismos errores que stod) y tokens de lineas
+// tipicas sin asignar memoria.
+// g++ -std=c++11 -O2 -Iinclude -o tokenizer_test tests/tokenizer_test.cpp src/tokenizer.cpp src/symbols.cpp
+#include "tokenizer.hpp"
+#include "symbols.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+using namespace std;
+
+// cuenta las asignaciones del proceso para revisar que tokenize no pida memoria
+static long allocs=0;
+void* operator new(size_t n){ ++allocs; if(void* p=malloc(n)) return p; throw bad_alloc(); }
+void operator delete(void* p) noexcept { free(p); }
+
+static int fails=0;
+
+static void check(const string& s){
+    const char* kind="ok"; double got=0;
+    try{ got=parseDecimal(s.data(), s.size()); }
+    catch(const invalid_argument&){ kind="invalid"; }
+    catch(const out_of_range&){ kind="range"; }
+    const char* rkind="ok"; double ref=0;
+    try{ ref=stod(s); }
+    catch(const invalid_argument&){ rkind="invalid"; }
+    catch(const out_of_range&){ rkind="range"; }
+    if(strcmp(kind, rkind)!=0 || memcmp(&got, &ref, sizeof got)!=0){
+        if(fails++<10) printf("FAIL \"%s\": %s %.17g vs %s %.17g\n", s.c_str(), kind, got, rkind, ref);
+    }
+}
+
+int main(){
+    mt19937_64 rng(7);
+    long checked=0;
+    const char* special[]={".", "0", "0.", ".0", "1", "1.", ".5", "0.1", "0.3", "9007199254740992",
+        "9007199254740993", "18446744073709551615", "18446744073709551616", "1234567890123456789012",
+        "0.30000000000000004", "2.2250738585072014", "123456789.123456789", "0.0000000000000000000001"};
+    for(const char* s: special){ check(s); ++checked; }
+    check(string(400, '9')); check("0."+string(400, '0')+"1"); check("0."+string(320, '0')+"1"); checked+=3;
+
+    string s;
+    for(int i=0;i<1000000;++i){
+        // cifras al azar con el punto en cualquier lado (a veces ceros al inicio o al final)
+        int len=1+(int)(rng()%25); s.clear();
+        int dot=(int)(rng()%(len+2))-1;
+        for(int k=0;k<len;++k){
+            if(k==dot) s.push_back('.');
+            unsigned r=(unsigned)(rng()%12);
+            s.push_back(r>=10 ? '0' : (char)('0'+r));
+        }
+        check(s); ++checked;
+    }
+
+    // lineas tipicas: con el buffer y los simbolos ya creados, tokenize no asigna
+    Tokenizer tk; vector<Token> out;
+    const char* lines[]={"x * 3.25*(y+2)^2 - sqrt(z)/4", "-(a+b)*-c", "sin(pi/2)+ln(e)", "0.1+0.2"};
+    for(const char* l: lines) tk.tokenize(l, strlen(l), out);
+    long before=allocs;
+    for(int r=0;r<1000;++r) for(const char* l: lines) tk.tokenize(l, strlen(l), out);
+    if(allocs!=before){ ++fails; printf("FAIL tokenize asigno %ld veces\n", allocs-before); }
+    if(sizeof(Token)!=16){ ++fails; printf("FAIL sizeof(Token)=%u\n", (unsigned)sizeof(Token)); }
+    tk.tokenize("foo+foo*bar", out);
+    if(out[0].sym!=out[2].sym || out[0].sym==out[4].sym || Symbols::name(out[4].sym)!="bar"){ ++fails; printf("FAIL simbolos\n"); }
+
+    printf("tokenizer_test: %ld numeros, %d fallas\n", checked, fails);
+    return fails ? 1 : 0;
+}